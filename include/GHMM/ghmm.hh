@@ -36,9 +36,13 @@
 #include <numeric>
 #include <iostream>
 #include <stdio.h>
+#include <time.h>
 
 namespace GHMM {
   class Parse;
+  namespace UTIL {
+    class Alphabet;
+  }
   class Model;
   
   class StateBase : public virtual RefObj {
@@ -49,10 +53,10 @@ namespace GHMM {
     StateBase() {}
     virtual ~StateBase() {}
 
-    virtual void preParse(int, const int *) {
+    virtual void preParse(int, const Symbol *) {
     }
 
-    virtual void nextToken(int, const int *) {
+    virtual void nextToken(int, const Symbol *) {
     }
 
     virtual void      delta(int j, const Model &model, const Parse &parse, int max_len, double &delta, int &prev_state, int &state_length) const = 0;
@@ -60,7 +64,15 @@ namespace GHMM {
     virtual void alphaDelta(int j, const Model &model, const Parse &parse, int max_len, double &alpha, double &delta, int &prev_state, int &state_length) const = 0;
     virtual void       beta(int j, const Model &model, const Parse &parse, int max_len, double &beta) const = 0;
 
-    virtual int generate(std::vector<int> &result) const = 0;
+    // append a random segment to result, returning its length.
+    virtual int generate(std::vector<int> &result, MATH::Random &rng) const = 0;
+
+    // a silent state emits nothing: it is entered and left at the same
+    // position, and reads its predecessors (and, for beta, its
+    // successors) in the current column (see Silent).
+    virtual bool silent() const {
+      return false;
+    }
   };
 
   class Traceback {
@@ -71,6 +83,8 @@ namespace GHMM {
 
     friend class RefCounter<Traceback>;
 
+    // tracebacks belong to the Parse that built them and are never
+    // shared between threads, so their counts need not be atomic.
     mutable int __refcount;
 
     inline int refcount() const {
@@ -113,7 +127,11 @@ namespace GHMM {
     std::vector<StateBase::Ptr> states;
     double *state_trans;
     double *state_log_trans;
+    std::vector<MATH::AliasTable> trans_alias;
     int state_count;
+    int first_silent;
+    Ref<UTIL::Alphabet> symbol_alphabet;
+    std::string error_message;
 
   public:
     static const std::string BEGIN;
@@ -121,9 +139,21 @@ namespace GHMM {
 
     typedef Ref<Model> Ptr;
 
-    Model(const std::vector<std::pair<std::string, StateBase::Ptr> > &, const std::map<std::pair<int, int>, double> &);
+    Model(const std::vector<std::pair<std::string, StateBase::Ptr> > &, const std::map<std::pair<int, int>, double> &, const Ref<UTIL::Alphabet> &alphabet = Ref<UTIL::Alphabet>());
     virtual ~Model();
 
+    // the alphabet the emissions are over, if the builder was given
+    // one: sequences should be encoded with it.
+    const Ref<UTIL::Alphabet> &alphabet() const {
+      return symbol_alphabet;
+    }
+
+    // why the states and transitions given do not make a model, or
+    // empty if they do. a model with an error must not be used.
+    const std::string &error() const {
+      return error_message;
+    }
+
     int stateNumber(const std::string &s) const {
       std::map<std::string, int>::const_iterator i = state_name_map.find(s);
       if (i != state_name_map.end()) {
@@ -141,13 +171,38 @@ namespace GHMM {
     int stateCount() const {
       return states.size();
     }
-    const std::vector<int> predStates(int n) const {
+    // states [1, firstSilent()) emit; the silent states follow, up to
+    // END, each after the silent states that lead into it.
+    int firstSilent() const {
+      return first_silent;
+    }
+    const std::vector<int> &predStates(int n) const {
       return pred_states[n];
     }
-    const std::vector<int> succStates(int n) const {
+    const std::vector<int> &succStates(int n) const {
       return succ_states[n];
     }
 
+    // freeze the model and its states for read only use from several
+    // threads (see RefObj); thaw it before it is released. a state's
+    // length distribution and emitter are part of the state object,
+    // but the tables a PositionSpecific emitter holds Refs to are not
+    // frozen: parsing only reads them through those Refs, and never
+    // copies them. like RefObj::freeze(), only call these while no
+    // other thread uses the model.
+    void freeze() const {
+      RefObj::freeze();
+      for (int i = 0; i < (int)states.size(); i++) {
+        if (states[i] != NULL) states[i]->freeze();
+      }
+    }
+    void thaw() const {
+      for (int i = 0; i < (int)states.size(); i++) {
+        if (states[i] != NULL) states[i]->thaw();
+      }
+      RefObj::thaw();
+    }
+
     double &logp(int s, int t) {
       return state_log_trans[s * state_count + t];
     }
@@ -163,27 +218,30 @@ namespace GHMM {
     }
 
     int randomTransition(int s) const {
-      double *tp = state_trans + s * state_count;
-      double r = random() / double(RAND_MAX);
-      for (int i = 0; i < state_count; i++) {
-        r -= tp[i];
-        if (r <= 0.0) {
-          return i;
-        }
-      }
-      return state_count - 1;
+      return trans_alias[s].sample(random() / (RAND_MAX + 1.0));
+    }
+    int randomTransition(int s, MATH::Random &rng) const {
+      return trans_alias[s].sample(rng);
     }
 
+    // generate a sequence, drawing from the global random() (which
+    // seeds a generator for the whole sequence) or from rng.
     std::vector<int> generate() const {
+      uint64_t seed = random();
+      MATH::Random rng((seed << 31) ^ random());
+      return generate(rng);
+    }
+
+    std::vector<int> generate(MATH::Random &rng) const {
       int state = 0;
       std::vector<int> result;
       while (1) {
-        state = randomTransition(state);
+        state = randomTransition(state, rng);
         if (state == state_count - 1) {
           break;
         }
 
-        int d = states[state]->generate(result);
+        int d = states[state]->generate(result, rng);
         DEBUG(5,
               std::cerr << "(" << state << "," << d << ")";);
       }
@@ -193,6 +251,119 @@ namespace GHMM {
     }
   };
 
+  // Evaluates the emitting states of one column of a Parse in
+  // parallel. column() must call parse.columnState(model, j, max_len)
+  // once for each j in [1, model.firstSilent()), and return once all of
+  // them are done; the parse evaluates the silent states after it.
+  class ColumnTeam {
+  public:
+    virtual ~ColumnTeam() {}
+    virtual void column(Parse &parse, const Model &model, int max_len) = 0;
+  };
+
+  // Further counts, such as hardware events, read along with the clock
+  // around each parse and each state's kernel when a Profile has a
+  // counter. read() gives count() running totals for the calling
+  // thread, so they are only read for work done on the thread that
+  // runs the parse: with a ColumnTeam, per state counts are left out.
+  class EventCounter {
+  public:
+    enum { MAX_EVENTS = 4 };
+    virtual ~EventCounter() {}
+    virtual int count() const = 0;
+    virtual void read(uint64_t *values) = 0;
+  };
+
+  // Work done by each state of a model, as counted by a Parse given a
+  // Profile (see Parse::setProfile). A cell is one state at one
+  // position; for each cell the state generates its candidate segment
+  // lengths (durations), skipping those whose emission and length
+  // probability is zero, and looks at each of its predecessors for the
+  // others. A Profile is only updated by the parse using it, so give
+  // each thread its own and merge() them afterwards.
+  //
+  // A cell takes little longer than reading the clock, so states are
+  // only timed in one column of every Profile::SAMPLE_COLUMNS, less
+  // the cost of the clock itself; nanoseconds / timed is the time per
+  // cell, and the counts above are exact.
+  struct StateProfile {
+    uint64_t cells;
+    uint64_t durations;
+    uint64_t predecessors;
+    uint64_t zero_durations;
+    uint64_t zero_cells;
+    // calls that were timed, and the time they took.
+    uint64_t timed;
+    uint64_t nanoseconds;
+    // calls whose events were counted, and the counts.
+    uint64_t counted;
+    uint64_t events[EventCounter::MAX_EVENTS];
+
+    StateProfile() : cells(0), durations(0), predecessors(0), zero_durations(0), zero_cells(0), timed(0), nanoseconds(0), counted(0) {
+      std::fill(events, events + EventCounter::MAX_EVENTS, 0);
+    }
+  };
+
+  struct Profile {
+    enum { SAMPLE_COLUMNS = 16 };
+
+    std::vector<StateProfile> states;
+    uint64_t sequences;
+    uint64_t residues;
+    // the whole of each parse, and what counter counts.
+    StateProfile parses;
+    EventCounter *counter;
+
+    Profile() : states(), sequences(0), residues(0), parses(), counter(NULL) {
+    }
+
+    void reserve(int n) {
+      if ((int)states.size() < n) states.resize(n);
+    }
+
+    static void add(StateProfile &s, const StateProfile &t) {
+      s.cells += t.cells;
+      s.durations += t.durations;
+      s.predecessors += t.predecessors;
+      s.zero_durations += t.zero_durations;
+      s.zero_cells += t.zero_cells;
+      s.timed += t.timed;
+      s.nanoseconds += t.nanoseconds;
+      s.counted += t.counted;
+      for (int e = 0; e < EventCounter::MAX_EVENTS; e++) s.events[e] += t.events[e];
+    }
+
+    void merge(const Profile &o) {
+      reserve(o.states.size());
+      for (int j = 0; j < (int)o.states.size(); j++) add(states[j], o.states[j]);
+      add(parses, o.parses);
+      sequences += o.sequences;
+      residues += o.residues;
+    }
+
+    static uint64_t clock() {
+      struct timespec ts;
+      clock_gettime(CLOCK_MONOTONIC, &ts);
+      return (uint64_t)ts.tv_sec * 1000000000 + ts.tv_nsec;
+    }
+
+    // the least time between two reads of clock(), measured once.
+    static uint64_t clockCost() {
+      static uint64_t cost = measureClock();
+      return cost;
+    }
+
+  private:
+    static uint64_t measureClock() {
+      uint64_t least = clock();
+      for (int i = 0; i < 100; i++) {
+        uint64_t t = clock(), u = clock();
+        if (u - t < least) least = u - t;
+      }
+      return least;
+    }
+  };
+
   class Parse : public virtual RefObj {
     Parse(const Parse &);
     Parse &operator=(const Parse &);
@@ -200,15 +371,46 @@ namespace GHMM {
   protected:
     double *a, *b, *d;
     Traceback::Ptr *p;
-    int *s;
+    Symbol *s;
     int parse_length;
     int state_count;
     int offset;
+    int cell_capacity;
+    int seq_capacity;
+    std::vector<int> col_prev, col_length;
+    Profile *profile;
+
+    // grow the workspace if needed; a Parse is reused across
+    // sequences and models, so only reallocate when it is too small.
+    void reserve(int length, int states) {
+      if (length * states > cell_capacity) {
+        if (a) delete [] a;
+        if (b) delete [] b;
+        if (d) delete [] d;
+        if (p) delete [] p;
+        cell_capacity = length * states;
+        a = new double[cell_capacity];
+        b = new double[cell_capacity];
+        d = new double[cell_capacity];
+        p = new Traceback::Ptr[cell_capacity];
+      } else {
+        std::fill(p, p + length * states, Traceback::Ptr());
+      }
+      if (length > seq_capacity) {
+        if (s) delete [] s;
+        seq_capacity = length;
+        s = new Symbol[seq_capacity];
+      }
+      if ((int)col_prev.size() < states) {
+        col_prev.resize(states);
+        col_length.resize(states);
+      }
+    }
 
   public:
     typedef Ref<Parse> Ptr;
 
-    Parse() : a(NULL), b(NULL), d(NULL), p(NULL), s(NULL), parse_length(0), state_count(0), offset(0) {
+    Parse() : a(NULL), b(NULL), d(NULL), p(NULL), s(NULL), parse_length(0), state_count(0), offset(0), cell_capacity(0), seq_capacity(0), col_prev(), col_length(), profile(NULL) {
     }
 
     ~Parse() {
@@ -219,6 +421,49 @@ namespace GHMM {
       if (s) delete [] s;
     }
 
+    // count the work done by each state of the models parsed from now
+    // on in p, which must only be used with models of the same shape;
+    // NULL stops counting.
+    void setProfile(Profile *p) {
+      profile = p;
+    }
+    StateProfile *stateProfile(int j) const {
+      return profile ? &profile->states[j] : NULL;
+    }
+
+  protected:
+    // the clock and event counts when something profiled started.
+    struct Mark {
+      uint64_t time;
+      uint64_t events[EventCounter::MAX_EVENTS];
+
+      Mark() : time(0) {
+      }
+    };
+
+    void mark(Mark &m, bool events) const {
+      if (events && profile->counter) profile->counter->read(m.events);
+      m.time = Profile::clock();
+    }
+
+    void charge(const Mark &m, StateProfile &sp, bool events) const {
+      uint64_t elapsed = Profile::clock() - m.time, cost = Profile::clockCost();
+      sp.nanoseconds += elapsed > cost ? elapsed - cost : 0;
+      sp.timed++;
+      if (events && profile->counter) {
+        uint64_t now[EventCounter::MAX_EVENTS];
+        profile->counter->read(now);
+        for (int e = 0; e < profile->counter->count(); e++) sp.events[e] += now[e] - m.events[e];
+        sp.counted++;
+      }
+    }
+
+    // whether the states of the current column are timed.
+    bool sampled() const {
+      return profile && offset % Profile::SAMPLE_COLUMNS == 0;
+    }
+
+  public:
     int idx(int state, int pos) const {
       return (pos + offset) * state_count + state;
     }
@@ -227,13 +472,13 @@ namespace GHMM {
     double &beta(int state, int pos)                    { return b[idx(state, pos)]; }
     double &delta(int state, int pos)                   { return d[idx(state, pos)]; }
     Traceback::Ptr &psi(int state, int pos)             { return p[idx(state, pos)]; }
-    int &seq(int pos)                                   { return s[pos + offset];    }
+    Symbol &seq(int pos)                                { return s[pos + offset];    }
 
     const double &alpha(int state, int pos) const       { return a[idx(state, pos)]; }
     const double &beta(int state, int pos) const        { return b[idx(state, pos)]; }
     const double &delta(int state, int pos) const       { return d[idx(state, pos)]; }
     const Traceback::Ptr &psi(int state, int pos) const { return p[idx(state, pos)]; }
-    const int &seq(int pos) const                       { return s[pos + offset];    }
+    const Symbol &seq(int pos) const                    { return s[pos + offset];    }
 
     void traceback() {
       std::cerr << "final result:" << std::endl;
@@ -260,24 +505,62 @@ namespace GHMM {
       return result;
     }
 
+    // evaluate state j of the current column, leaving its traceback
+    // to be linked once the whole column is done. a state only reads
+    // earlier columns, so the states of a column may be evaluated
+    // concurrently (see ColumnTeam).
+    void columnState(const Model &model, int j, int max_len) {
+      double alpha_j, delta_j;
+      Mark start;
+      bool timed = sampled();
+      if (timed) mark(start, false);
+
+      model.state(j)->alphaDelta(j, model, *this, max_len, alpha_j, delta_j, col_prev[j], col_length[j]);
+      if (timed) charge(start, profile->states[j], false);
+      delta(j, 0) = delta_j;
+      alpha(j, 0) = alpha_j;
+    }
+
+    // evaluate the silent states of the current column, in order, once
+    // its emitting states are done. a silent state takes the traceback
+    // of the state it was entered from, so tracebacks only hold
+    // emitting states.
+    void silentColumn(const Model &model, int max_len) {
+      bool timed = sampled();
+      for (int j = model.firstSilent(); j < state_count - 1; ++j) {
+        double alpha_j, delta_j;
+        int prev_state_j, state_length_j;
+        Mark start;
+        if (timed) mark(start, true);
+
+        model.state(j)->alphaDelta(j, model, *this, max_len, alpha_j, delta_j, prev_state_j, state_length_j);
+        if (timed) charge(start, profile->states[j], true);
+        if (delta_j == MATH::LOG_ZERO) {
+          psi(j, 0) = NULL;
+        } else {
+          psi(j, 0) = psi(prev_state_j, 0);
+        }
+        delta(j, 0) = delta_j;
+        alpha(j, 0) = alpha_j;
+      }
+    }
+
     template<typename RandomAccessIterator>
-    void parse(const Model::Ptr &model, RandomAccessIterator begin, RandomAccessIterator end) {
+    void parse(const Model::Ptr &model, RandomAccessIterator begin, RandomAccessIterator end, ColumnTeam *team = NULL) {
       RandomAccessIterator pos;
       const Model &modelRef(*model);
       parse_length = (end - begin) + 1;
       state_count = model->stateCount();
-
-      if (a) delete [] a;
-      if (b) delete [] b;
-      if (d) delete [] d;
-      if (p) delete [] p;
-      if (s) delete [] s;
-
-      a = new double[parse_length * state_count];
-      b = new double[parse_length * state_count];
-      d = new double[parse_length * state_count];
-      p = new Traceback::Ptr[parse_length * state_count];
-      s = new int[parse_length];
+      int first_silent = model->firstSilent();
+
+      reserve(parse_length, state_count);
+      Mark parse_start;
+      if (profile) {
+        profile->reserve(state_count);
+        profile->sequences++;
+        profile->residues += end - begin;
+        mark(parse_start, true);
+      }
 
       offset = 0;
 
@@ -288,6 +571,7 @@ namespace GHMM {
       alpha(0, 0) = 0.0;
       for (int i = 1; i < state_count; i++) alpha(i, 0) = MATH::LOG_ZERO;
       for (int i = 1; i < parse_length; i++) alpha(0, i) = MATH::LOG_ZERO;
+      silentColumn(modelRef, 0);
 
       for (pos = begin; pos != end;) {
         ++offset;
@@ -295,20 +579,34 @@ namespace GHMM {
 
         DEBUG(8,
               std::cerr << std::endl << std::endl << "POS: " << pos - begin - 1 << std::endl;
-              std::cerr << "offset=" << offset << " ch=" << seq(0) << std::endl;);
-
-        for (int j = 1; j < state_count - 1; ++j) {
-          const StateBase *js(model->state(j).ptr());
-          double alpha_j, delta_j;
-          int prev_state_j, state_length_j;
+              std::cerr << "offset=" << offset << " ch=" << *pos << std::endl;);
 
-          js->alphaDelta(j, modelRef, *this, pos - begin, alpha_j, delta_j, prev_state_j, state_length_j);
-          DEBUG(9,
-                std::cerr << "delta_j=" << delta_j << " prev_state_j=" << prev_state_j << " state_length_j=" << state_length_j << std::endl;);
-          psi(j, 0) = linkState(j, state_length_j, prev_state_j);
-          delta(j, 0) = delta_j;
-          alpha(j, 0) = alpha_j;
+        if (team != NULL) {
+          // tracebacks are linked here rather than by the team, so
+          // their reference counts are only touched by this thread.
+          team->column(*this, modelRef, pos - begin);
+          for (int j = 1; j < first_silent; ++j) {
+            psi(j, 0) = linkState(j, col_length[j], col_prev[j]);
+          }
+        } else {
+          bool timed = sampled();
+          for (int j = 1; j < first_silent; ++j) {
+            const StateBase *js(model->state(j).ptr());
+            double alpha_j, delta_j;
+            int prev_state_j, state_length_j;
+            Mark start;
+            if (timed) mark(start, true);
+
+            js->alphaDelta(j, modelRef, *this, pos - begin, alpha_j, delta_j, prev_state_j, state_length_j);
+            if (timed) charge(start, profile->states[j], true);
+            DEBUG(9,
+                  std::cerr << "delta_j=" << delta_j << " prev_state_j=" << prev_state_j << " state_length_j=" << state_length_j << std::endl;);
+            psi(j, 0) = linkState(j, state_length_j, prev_state_j);
+            delta(j, 0) = delta_j;
+            alpha(j, 0) = alpha_j;
+          }
         }
+        silentColumn(modelRef, pos - begin);
         DEBUG(8,
               std::cerr << std::flush;
               for (int j = 1; j < state_count - 1; ++j) {
@@ -324,18 +622,42 @@ namespace GHMM {
               std::cerr << std::endl;);
       }
 
-#if 0
+      if (profile) {
+        profile->parses.cells += (uint64_t)(end - begin) * (state_count - 2);
+        charge(parse_start, profile->parses, true);
+      }
+
+      DEBUG(3,
+            traceback(););
+    }
+
+    // after parse() over the same sequence, fill in beta(j, pos): the
+    // log probability of the residues from pos on, given that a
+    // segment of state j starts at pos. this leaves the Parse
+    // positioned at the start of the sequence, so that alpha and beta
+    // are both indexed by the number of residues before pos.
+    template<typename RandomAccessIterator>
+    void backward(const Model::Ptr &model, RandomAccessIterator begin, RandomAccessIterator end) {
+      RandomAccessIterator pos;
+      const Model &modelRef(*model);
+
+      offset = end - begin;
+
       for (int i = 0; i < state_count - 1; i++) beta(i, 0) = MATH::LOG_ZERO;
       beta(state_count - 1, 0) = 0.0;
+      silentBeta(modelRef, 0);
 
       for (pos = end; pos != begin;) {
         --offset;
         seq(0) = *--pos;
+        beta(0, 0) = MATH::LOG_ZERO;
+        beta(state_count - 1, 0) = MATH::LOG_ZERO;
+
         DEBUG(8,
               std::cerr << std::endl << std::endl << "POS: " << pos - begin << std::endl;
               std::cerr << "offset=" << offset << " ch=" << *pos << std::endl;);
 
-        for (int j = 1; j < state_count - 1; ++j) {
+        for (int j = 1; j < model->firstSilent(); ++j) {
           const StateBase *js(model->state(j).ptr());
           double beta_j;
 
@@ -344,13 +666,18 @@ namespace GHMM {
                 std::cerr << "beta_j=" << beta_j << std::endl;);
           beta(j, 0) = beta_j;
         }
+        silentBeta(modelRef, end - pos);
       }
+    }
 
-      offset = end - begin;
-#endif
-
-      DEBUG(3,
-            traceback(););
+    // the silent states of the current column, last first, once its
+    // emitting states are done.
+    void silentBeta(const Model &model, int max_len) {
+      for (int j = state_count - 2; j >= model.firstSilent(); --j) {
+        double beta_j;
+        model.state(j)->beta(j, model, *this, max_len, beta_j);
+        beta(j, 0) = beta_j;
+      }
     }
   };
 
@@ -362,6 +689,8 @@ namespace GHMM {
     std::vector<std::pair<std::string, StateBase::Ptr> > states;
     std::map<std::string, int> state_name_map;
     std::map<std::pair<int, int>, double> state_trans_map;
+    Ref<UTIL::Alphabet> alphabet;
+    std::string error_message;
 
     int stateNum(const std::string &s);
   public:
@@ -373,7 +702,14 @@ namespace GHMM {
     virtual void addState(const std::string &, const StateBase::Ptr &);
     virtual void removeState(const std::string &);
     virtual void addStateTransition(const std::string &, const std::string &, double);
+    virtual void setAlphabet(const Ref<UTIL::Alphabet> &);
+    // the model, or NULL if the states and transitions do not make
+    // one; error() then says why.
     virtual Model::Ptr make();
+
+    const std::string &error() const {
+      return error_message;
+    }
   };
 
   template<typename Distrib, typename Emitter>
@@ -412,9 +748,9 @@ namespace GHMM {
     virtual void alphaDelta(int j, const Model &model, const Parse &parse, int max_len, double &alpha, double &delta, int &prev_state, int &state_length) const;
     virtual void       beta(int j, const Model &model, const Parse &parse, int max_len, double &alpha) const;
 
-    virtual int generate(std::vector<int> &result) const {
+    virtual int generate(std::vector<int> &result, MATH::Random &rng) const {
       int d;
-      Emitter::randSequence(result, d = Distrib::randLength());
+      Emitter::randSequence(result, d = Distrib::randLength(rng), rng);
       return d;
     }
   };
@@ -438,7 +774,7 @@ namespace GHMM {
     typename Emitter::template Generator<-1> g(static_cast<const Emitter *>(this), &(parse.seq(0)), lmin, lmax);
 
     while (g.gen(d, eprob)) {
-      dprob = State<Distrib, Emitter>::logpLength(d);
+      dprob = State<Distrib, Emitter>::logpLengthInRange(d);
 
       DEBUG(10,
             std::cerr << "  d=" << d << " eprob=" << eprob << " dprob=" << dprob << std::endl;);
@@ -490,7 +826,7 @@ namespace GHMM {
     typename Emitter::template Generator<-1> g(static_cast<const Emitter *>(this), &(parse.seq(0)), lmin, lmax);
 
     while (g.gen(d, eprob)) {
-      dprob = State<Distrib, Emitter>::logpLength(d);
+      dprob = State<Distrib, Emitter>::logpLengthInRange(d);
 
       DEBUG(10,
             std::cerr << "  d=" << d << " eprob=" << eprob << " dprob=" << dprob << std::endl;);
@@ -534,6 +870,7 @@ namespace GHMM {
     int lmax = std::min(max_len + 1, State<Distrib, Emitter>::maxLength());
     int d;
     double dprob, eprob, sprob;
+    uint64_t durations = 0, zero_durations = 0;
 
     alpha = MATH::LOG_ZERO;
     delta = MATH::LOG_ZERO;
@@ -546,11 +883,15 @@ namespace GHMM {
     typename Emitter::template Generator<-1> g(static_cast<const Emitter *>(this), &(parse.seq(0)), lmin, lmax);
 
     while (g.gen(d, eprob)) {
-      dprob = State<Distrib, Emitter>::logpLength(d);
+      dprob = State<Distrib, Emitter>::logpLengthInRange(d);
       DEBUG(10,
             std::cerr << "  d=" << d << " eprob=" << eprob << " dprob=" << dprob << std::endl;);
       sprob = eprob + dprob;
-      if (sprob == MATH::LOG_ZERO) continue;
+      durations++;
+      if (sprob == MATH::LOG_ZERO) {
+        zero_durations++;
+        continue;
+      }
 
       for (int _i = pred.size() - 1; _i >= 0; --_i) {
         int i = pred[_i];
@@ -598,6 +939,14 @@ namespace GHMM {
       state_length = 0;
     }
 
+    if (StateProfile *sp = parse.stateProfile(j)) {
+      sp->cells++;
+      sp->durations += durations;
+      sp->zero_durations += zero_durations;
+      sp->predecessors += (durations - zero_durations) * pred.size();
+      if (delta == MATH::LOG_ZERO) sp->zero_cells++;
+    }
+
     DEBUG(9,
           std::cerr << "  delta=" << delta
                     << " alpha=" << alpha
@@ -623,7 +972,7 @@ namespace GHMM {
     typename Emitter::template Generator<+1> g(static_cast<const Emitter *>(this), &(parse.seq(0)), lmin, lmax);
 
     while (g.gen(d, eprob)) {
-      dprob = State<Distrib, Emitter>::logpLength(d);
+      dprob = State<Distrib, Emitter>::logpLengthInRange(d);
 
       DEBUG(10,
             std::cerr << "  d=" << d << " eprob=" << eprob << " dprob=" << dprob << std::endl;);
@@ -658,6 +1007,82 @@ namespace GHMM {
           std::cerr << " beta=" << beta << std::endl;);
   }
 
+  // A state that emits nothing, used to join several states to several
+  // others through one state rather than with a transition for every
+  // pair. A path through it neither starts nor ends a segment: it is
+  // entered and left at the same position, and shows up in a traceback
+  // as a transition straight from the state before it to the state
+  // after it. Silent states may follow one another, but must not form a
+  // loop; ModelBuilder::make() reports one as an error.
+  class Silent : public StateBase {
+  public:
+    typedef Ref<Silent> Ptr;
+
+    Silent() : StateBase() {
+    }
+
+    virtual void delta(int j, const Model &model, const Parse &parse, int, double &delta, int &prev_state, int &state_length) const {
+      const std::vector<int> &pred(model.predStates(j));
+
+      delta = MATH::LOG_ZERO;
+      prev_state = j;
+      state_length = 0;
+      for (int _i = pred.size() - 1; _i >= 0; --_i) {
+        int i = pred[_i];
+        double dp = model.logp(i, j) + parse.delta(i, 0);
+        if (dp >= delta) {
+          delta = dp;
+          prev_state = i;
+        }
+      }
+      if (delta <= MATH::LOG_ZERO) {
+        delta = MATH::LOG_ZERO;
+        prev_state = j;
+      }
+    }
+
+    virtual void alpha(int j, const Model &model, const Parse &parse, int, double &alpha) const {
+      const std::vector<int> &pred(model.predStates(j));
+
+      alpha = MATH::LOG_ZERO;
+      for (int _i = pred.size() - 1; _i >= 0; --_i) {
+        int i = pred[_i];
+        double ap = model.logp(i, j) + parse.alpha(i, 0);
+        if (ap != MATH::LOG_ZERO) alpha = MATH::logAdd(ap, alpha);
+      }
+    }
+
+    virtual void alphaDelta(int j, const Model &model, const Parse &parse, int max_len, double &alpha, double &delta, int &prev_state, int &state_length) const {
+      Silent::delta(j, model, parse, max_len, delta, prev_state, state_length);
+      Silent::alpha(j, model, parse, max_len, alpha);
+
+      if (StateProfile *sp = parse.stateProfile(j)) {
+        sp->cells++;
+        sp->predecessors += model.predStates(j).size();
+        if (delta == MATH::LOG_ZERO) sp->zero_cells++;
+      }
+    }
+
+    virtual void beta(int j, const Model &model, const Parse &parse, int, double &beta) const {
+      const std::vector<int> &succ(model.succStates(j));
+
+      beta = MATH::LOG_ZERO;
+      for (int _i = succ.size() - 1; _i >= 0; --_i) {
+        int i = succ[_i];
+        double bp = model.logp(j, i) + parse.beta(i, 0);
+        if (bp != MATH::LOG_ZERO) beta = MATH::logAdd(bp, beta);
+      }
+    }
+
+    virtual int generate(std::vector<int> &, MATH::Random &) const {
+      return 0;
+    }
+
+    virtual bool silent() const {
+      return true;
+    }
+  };
+
 }
 
 #include <GHMM/ghmm_util.hh>
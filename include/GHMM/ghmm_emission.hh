@@ -39,9 +39,15 @@ namespace GHMM {
       virtual ~Base() {}
     };
 
+    // every possible Symbol, the range emission tables are padded to
+    // so that generators can look symbols up without a range check.
+    enum { SYMBOLS = 1 << (8 * sizeof(Symbol)) };
+
     class PositionSpecific : public EMISSION::Base {
     protected:
       std::vector<MATH::DPDF::Ptr> pssm;
+      // padded copies of pssm, taken when it is set.
+      std::vector<MATH::DPDF::Ptr> padded;
 
     public:
       typedef Ref<PositionSpecific> Ptr;
@@ -54,20 +60,20 @@ namespace GHMM {
 
       protected:
         const std::vector<MATH::DPDF::Ptr> &pssm;
-        const int *seq;
+        const Symbol *seq;
         bool emitted;
 
       public:
-        Generator(const PositionSpecific *p, const int *s, int d_min, int d_max) : pssm(p->pssm), seq(s), emitted(true) {
+        Generator(const PositionSpecific *p, const Symbol *s, int d_min, int d_max) : pssm(p->padded), seq(s), emitted(true) {
           emitted = !((int)pssm.size() >= d_min && (int)pssm.size() < d_max);
         }
         bool gen(int &d, double &logp) {
           if (!emitted) {
             d = pssm.size();
-            const int *p = DIR == +1 ? seq : seq - d + 1;
+            const Symbol *p = DIR == +1 ? seq : seq - d + 1;
             logp = 0.0;
             for (int i = 0; i < d; i++) {
-              logp += pssm[i]->logp(*p++);
+              logp += pssm[i]->logpPadded(*p++);
             }
             emitted = true;
             return true;
@@ -79,21 +85,31 @@ namespace GHMM {
       PositionSpecific &operator=(const PositionSpecific &ps) {
         if (this != &ps) {
           pssm = ps.pssm;
+          padded = ps.padded;
         }
         return *this;
       }
-      PositionSpecific() : EMISSION::Base(), pssm() {
+      PositionSpecific() : EMISSION::Base(), pssm(), padded() {
       }
-      PositionSpecific(const PositionSpecific &ps) : EMISSION::Base(), pssm() {
+      PositionSpecific(const PositionSpecific &ps) : EMISSION::Base(), pssm(), padded() {
         *this = ps;
       }
-      PositionSpecific(const std::vector<MATH::DPDF::Ptr> &p) : EMISSION::Base(), pssm() {
+      PositionSpecific(const std::vector<MATH::DPDF::Ptr> &p) : EMISSION::Base(), pssm(), padded() {
         setEmissionDistrib(p);
       }
       bool setEmissionDistrib(const std::vector<MATH::DPDF::Ptr> &p) {
         pssm = p;
+        padded.clear();
+        for (size_t i = 0; i < p.size(); i++) {
+          MATH::DPDF::Ptr d = new MATH::DPDF(*p[i]);
+          d->pad(0, SYMBOLS);
+          padded.push_back(d);
+        }
         return true;
       }
+      const std::vector<MATH::DPDF::Ptr> &emissionDistrib() const {
+        return pssm;
+      }
 
       void randSequence(std::vector<int> &result, int d) const {
         assert(d == (int)pssm.size());
@@ -101,6 +117,12 @@ namespace GHMM {
           result.push_back(pssm[i]->randZ());
         }
       }
+      void randSequence(std::vector<int> &result, int d, MATH::Random &rng) const {
+        assert(d == (int)pssm.size());
+        for (int i = 0; i < d; i++) {
+          result.push_back(pssm[i]->randZ(rng));
+        }
+      }
 
       virtual ~PositionSpecific() {
       }
@@ -108,6 +130,9 @@ namespace GHMM {
 
     class Stateless : public EMISSION::Base, protected MATH::DPDF {
     protected:
+      void padSymbols() {
+        pad(0, SYMBOLS);
+      }
 
     public:
       typedef Ref<Stateless> Ptr;
@@ -120,25 +145,25 @@ namespace GHMM {
 
       protected:
         const Stateless *emit;
-        const int *seq;
+        const Symbol *seq;
         int cur;
         int end;
         double accum;
 
       public:
-        Generator(const Stateless *e, const int *s, int d_min, int d_max) : emit(e), seq(s), cur(0), end(d_max - 1), accum(0.0) {
+        Generator(const Stateless *e, const Symbol *s, int d_min, int d_max) : emit(e), seq(s), cur(0), end(d_max - 1), accum(0.0) {
           if (d_min == d_max) {
             cur = end;
           } else {
             while (cur < d_min - 1) {
-              accum += emit->logp(seq[DIR * cur]);
+              accum += emit->logpPadded(seq[DIR * cur]);
               cur++;
             }
           }
         }
         bool gen(int &d, double &logp) {
           if (cur < end) {
-            accum += emit->logp(seq[DIR * cur]);
+            accum += emit->logpPadded(seq[DIR * cur]);
             cur++;
             d = cur;
             logp = accum;
@@ -152,6 +177,7 @@ namespace GHMM {
         if (this != &d) {
           EMISSION::Base::operator=(d);
           MATH::DPDF::operator=(d);
+          padSymbols();
         }
         return *this;
       }
@@ -159,15 +185,21 @@ namespace GHMM {
         *this = d;
       }
       Stateless() : EMISSION::Base(), MATH::DPDF() {
+        padSymbols();
       }
       Stateless(const MATH::DPDF::Ptr &dpdf) : EMISSION::Base(), MATH::DPDF(*dpdf) {
+        padSymbols();
       }
 
       bool setEmissionDistrib(int l, double *d) {
-        return setDistrib(0, l, d);
+        bool ok = setDistrib(0, l, d);
+        padSymbols();
+        return ok;
       }
       bool setEmissionDistrib(int l, double d) {
-        return setDistrib(0, l, d);
+        bool ok = setDistrib(0, l, d);
+        padSymbols();
+        return ok;
       }
       bool setEmissionProb(int i, double d) {
         return setp(i, d);
@@ -175,12 +207,26 @@ namespace GHMM {
       bool normalizeEmissionDistrib() {
         return normalize();
       }
+      double emissionProb(int i) const {
+        return p(i);
+      }
+      double logEmissionProb(int i) const {
+        return logp(i);
+      }
+      int emissionSize() const {
+        return distribMax();
+      }
 
       void randSequence(std::vector<int> &result, int d) const {
         for (int i = 0; i < d; i++) {
           result.push_back(randZ());
         }
       }
+      void randSequence(std::vector<int> &result, int d, MATH::Random &rng) const {
+        for (int i = 0; i < d; i++) {
+          result.push_back(randZ(rng));
+        }
+      }
 
       virtual ~Stateless() {
       }
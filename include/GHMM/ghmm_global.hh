@@ -29,4 +29,10 @@
 
 #define DEBUG(level, stmt...) do { if((level) <= DEBUGLEV) { stmt } } while(0)
 
+namespace GHMM {
+  // an alphabet index, as held by a Parse. one byte per residue, so an
+  // alphabet may have at most 256 tokens.
+  typedef unsigned char Symbol;
+}
+
 #endif
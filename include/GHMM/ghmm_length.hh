@@ -109,6 +109,9 @@ namespace GHMM {
       void setPSelf(double p) {
         p_self = p;
       }
+      double pSelf() const {
+        return p_self;
+      }
       void setMean(double mean) {
         p_self = mean / (1 + mean);
       }
@@ -120,6 +123,11 @@ namespace GHMM {
       double logpLength(int l) const {
         return log(p_self) * l;
       }
+      // logpLength() for minLength() <= l < maxLength(), as the parse
+      // asks for; the same for each length class.
+      double logpLengthInRange(int l) const {
+        return log(p_self) * l;
+      }
 
       virtual double pdf(double z) const {
         return 0.0; // XXX
@@ -137,6 +145,9 @@ namespace GHMM {
       int randLength() const {
         return 1;
       }
+      int randLength(MATH::Random &) const {
+        return 1;
+      }
 
       virtual ~Geometric() {
       }
@@ -167,6 +178,11 @@ namespace GHMM {
       Discrete(const MATH::DPDF::Ptr &dpdf) : LENGTH::Base(), DISTRIBUTION::Discrete(), MATH::DPDF(*dpdf) {
       }
 
+      // wrap static tables over [a, b); see MATH::DPDF::setStaticDistrib.
+      Discrete(int a, int b, const double *d, const double *log_d) : LENGTH::Base(), DISTRIBUTION::Discrete(), MATH::DPDF() {
+        setStaticDistrib(a, b, d, log_d);
+      }
+
       virtual ~Discrete() {
       }
 
@@ -177,11 +193,29 @@ namespace GHMM {
       double logpLength(int l) const {
         return logp(l);
       }
+      double logpLengthInRange(int l) const {
+        return logpPadded(l);
+      }
 
       bool setLengthDistrib(int a, int b, double *d) {
         return setDistrib(a, b, d);
       }
 
+      // drop the longest lengths whose probabilities add up to at most
+      // max_tail, keeping at least one, and renormalize. returns the
+      // probability dropped, which is also the total variation
+      // distance from the old distribution.
+      double truncate(double max_tail) {
+        int a = distribMin(), b = distribMax();
+        double tail = 0.0;
+        while (b - 1 > a && tail + p(b - 1) <= max_tail) tail += p(--b);
+        if (b == distribMax()) return 0.0;
+        std::vector<double> kept;
+        for (int l = a; l < b; l++) kept.push_back(p(l));
+        setDistrib(a, b, &kept[0]);
+        return tail;
+      }
+
       int minLength() const {
         return distribMin();
       }
@@ -191,6 +225,9 @@ namespace GHMM {
       int randLength() const {
         return MATH::DPDF::randZ();
       }
+      int randLength(MATH::Random &rng) const {
+        return MATH::DPDF::randZ(rng);
+      }
 
       std::ostream &dump(std::ostream &o) {
         return MATH::DPDF::dump(o);
@@ -226,6 +263,9 @@ namespace GHMM {
       double logpLength(int l) const {
         return length == l ? 0.0 : MATH::LOG_ZERO;
       }
+      double logpLengthInRange(int) const {
+        return 0.0;
+      }
 
       bool setLength(int l) {
         length = l;
@@ -241,6 +281,9 @@ namespace GHMM {
       int randLength() const {
         return length;
       }
+      int randLength(MATH::Random &) const {
+        return length;
+      }
 
       virtual ~Fixed() {
       }
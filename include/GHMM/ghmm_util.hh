@@ -25,28 +25,66 @@
 #include <map>
 #include <vector>
 #include <sstream>
+#include <algorithm>
+#include <ctype.h>
 #include <GHMM/string_funcs.hh>
 
 namespace GHMM {
   namespace UTIL {
+    // Tokens are numbered in the order they are added. Single
+    // character tokens numbered below SKIP are also compiled into a
+    // byte lookup table, so that text can be encoded without a map
+    // lookup per symbol: letters stand for either case unless the
+    // other case is a token itself, whitespace is skipped, and any
+    // other byte gets the unknown code (skipped too, unless
+    // setUnknown() was called).
     class Alphabet : public virtual RefObj {
       std::map<std::string, int> token_map;
       std::vector<std::string> tokens;
+      int unknown;
+      // the length of the longest token.
+      size_t longest;
+      unsigned char lut[256];
+
+      void compile() {
+        for (int c = 0; c < 256; c++) {
+          lut[c] = (isspace(c) || unknown < 0) ? SKIP : (unsigned char)unknown;
+        }
+        for (int pass = 0; pass < 2; pass++) {
+          for (int i = 0; i < (int)tokens.size() && i < SKIP; i++) {
+            if (tokens[i].size() != 1) continue;
+            unsigned char c = tokens[i][0];
+            if (pass == 0) {
+              // the other case first, so that an exact token wins.
+              if (isupper(c)) lut[tolower(c)] = i;
+              else if (islower(c)) lut[toupper(c)] = i;
+            } else {
+              lut[c] = i;
+            }
+          }
+        }
+      }
 
     public:
       static const std::string NO_TOKEN;
+      static const unsigned char SKIP = 0xff;
 
       typedef Ref<Alphabet> Ptr;
 
-      Alphabet() : token_map() {
+      Alphabet() : token_map(), tokens(), unknown(-1), longest(0) {
+        compile();
       }
       Alphabet &operator=(const Alphabet &a) {
         if (this != &a) {
           token_map = a.token_map;
+          tokens = a.tokens;
+          unknown = a.unknown;
+          longest = a.longest;
+          compile();
         }
         return *this;
       }
-      Alphabet(const Alphabet &a) : token_map() {
+      Alphabet(const Alphabet &a) : token_map(), tokens(), unknown(-1), longest(0) {
         *this = a;
       }
       ~Alphabet() {
@@ -59,6 +97,8 @@ namespace GHMM {
         int idx = tokens.size();
         token_map[t] = idx;
         tokens.push_back(t);
+        longest = std::max(longest, t.size());
+        if (t.size() == 1) compile();
         return idx;
       }
       void addCharTokenRange(char a, char b) {
@@ -66,6 +106,12 @@ namespace GHMM {
           addToken(std::string(1, a++));
         }
       }
+      // the code given to bytes that are neither whitespace nor a
+      // single character token; -1 skips them.
+      void setUnknown(int idx) {
+        unknown = (idx >= 0 && idx < SKIP) ? idx : -1;
+        compile();
+      }
       int size() {
         return token_map.size();
       }
@@ -80,6 +126,50 @@ namespace GHMM {
         }
         return -1;
       }
+
+      // same tokens, with the same codes.
+      bool operator==(const Alphabet &a) const {
+        return tokens == a.tokens && unknown == a.unknown;
+      }
+      bool operator!=(const Alphabet &a) const {
+        return !(*this == a);
+      }
+      // true if every token is a single character, so that encode()
+      // gives one code per byte it keeps.
+      bool singleChar() const {
+        return longest <= 1;
+      }
+
+      // byte -> token index, or SKIP, for single character tokens.
+      const unsigned char *codes() const {
+        return lut;
+      }
+      // encode len bytes of text, dropping skipped bytes. out must
+      // have room for len codes. returns the number of codes written.
+      // with longer tokens, the longest token (matched exactly) that
+      // starts at each position wins, and other bytes are encoded
+      // one at a time as usual.
+      size_t encode(const char *text, size_t len, unsigned char *out) const {
+        size_t n = 0;
+        if (longest > 1) {
+          for (size_t i = 0; i < len; ) {
+            size_t l = std::min(longest, len - i);
+            std::map<std::string, int>::const_iterator t = token_map.end();
+            while (l > 1 && (t = token_map.find(std::string(text + i, l))) == token_map.end()) l--;
+            unsigned char c = t != token_map.end() ? (*t).second : lut[(unsigned char)text[i]];
+            out[n] = c;
+            n += (c != SKIP);
+            i += l;
+          }
+          return n;
+        }
+        for (size_t i = 0; i < len; i++) {
+          unsigned char c = lut[(unsigned char)text[i]];
+          out[n] = c;
+          n += (c != SKIP);
+        }
+        return n;
+      }
     };
 
     class EmissionDistributionParser : public virtual RefObj {
@@ -24,9 +24,11 @@
 #include <GHMM/ref.hh>
 #include <math.h>
 #include <stdlib.h>
+#include <stdint.h>
 
 #include <numeric>
 #include <algorithm>
+#include <vector>
 
 namespace MATH {
   const static double LOG_ZERO = -__builtin_inf(); // -1e15;
@@ -52,17 +54,183 @@ namespace MATH {
     return std::min(std::max(val, val_min), val_max);
   }
 
+  // A pseudo random generator with explicit state (xoshiro256**), so
+  // each thread, or each simulated sequence, can draw from a stream of
+  // its own instead of the global random(). Seeds are spread with
+  // splitmix64, so nearby seeds and streams are unrelated.
+  class Random {
+    uint64_t s[4];
+
+    static uint64_t rotl(uint64_t x, int k) {
+      return (x << k) | (x >> (64 - k));
+    }
+    static uint64_t splitmix(uint64_t &x) {
+      uint64_t z = (x += 0x9e3779b97f4a7c15ULL);
+      z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9ULL;
+      z = (z ^ (z >> 27)) * 0x94d049bb133111ebULL;
+      return z ^ (z >> 31);
+    }
+
+  public:
+    Random(uint64_t seed = 0, uint64_t stream = 0) {
+      setSeed(seed, stream);
+    }
+
+    void setSeed(uint64_t seed, uint64_t stream = 0) {
+      uint64_t x = stream;
+      x = seed ^ splitmix(x);
+      for (int i = 0; i < 4; i++) s[i] = splitmix(x);
+    }
+
+    uint64_t next() {
+      uint64_t result = rotl(s[1] * 5, 7) * 9;
+      uint64_t t = s[1] << 17;
+      s[2] ^= s[0];
+      s[3] ^= s[1];
+      s[1] ^= s[2];
+      s[0] ^= s[3];
+      s[2] ^= t;
+      s[3] = rotl(s[3], 45);
+      return result;
+    }
+
+    // uniform in [0, 1).
+    double uniform() {
+      return (next() >> 11) * (1.0 / 9007199254740992.0);
+    }
+  };
+
+  // Walker's alias method, built with Vose's algorithm: draws from a
+  // discrete distribution over [0, n) in constant time. Weights need
+  // not be normalized; if they are all zero, n - 1 is always drawn.
+  class AliasTable {
+    std::vector<double> prob;
+    std::vector<int> alias;
+
+  public:
+    AliasTable() : prob(), alias() {
+    }
+    AliasTable(const double *p, int n) : prob(), alias() {
+      build(p, n);
+    }
+
+    void build(const double *p, int n) {
+      double sum = 0.0;
+      for (int i = 0; i < n; i++) sum += std::max(p[i], 0.0);
+
+      prob.assign(n, 0.0);
+      alias.assign(n, n - 1);
+      if (sum <= 0.0) return;
+
+      std::vector<double> scaled(n);
+      std::vector<int> small, large;
+      for (int i = 0; i < n; i++) {
+        scaled[i] = std::max(p[i], 0.0) * n / sum;
+        (scaled[i] < 1.0 ? small : large).push_back(i);
+      }
+      while (small.size() && large.size()) {
+        int l = small.back(), g = large.back();
+        small.pop_back();
+        prob[l] = scaled[l];
+        alias[l] = g;
+        scaled[g] = (scaled[g] + scaled[l]) - 1.0;
+        if (scaled[g] < 1.0) {
+          large.pop_back();
+          small.push_back(g);
+        }
+      }
+      // what is left is 1 up to rounding.
+      for (size_t i = 0; i < large.size(); i++) prob[large[i]] = 1.0;
+      for (size_t i = 0; i < small.size(); i++) prob[small[i]] = 1.0;
+    }
+
+    int size() const {
+      return prob.size();
+    }
+
+    // u is uniform in [0, 1).
+    int sample(double u) const {
+      double x = u * prob.size();
+      int i = std::min((int)x, (int)prob.size() - 1);
+      return x - i < prob[i] ? i : alias[i];
+    }
+    int sample(Random &rng) const {
+      return sample(rng.uniform());
+    }
+  };
+
+  // A discrete distribution over [min_d, max_d), kept as probabilities
+  // and log probabilities. Both tables live in one allocation, each
+  // starting on a cache line. pad() widens the tables past [min_d,
+  // max_d) with zeros (LOG_ZERO in the log table), so that callers who
+  // know their arguments fall in the padded range can use the
+  // unchecked pPadded() and logpPadded(). padding survives setp(),
+  // normalize() and copying, but setting a new range drops it.
   class DPDF : public virtual RefObj {
   protected:
+    enum { CACHE_LINE_DOUBLES = 64 / sizeof(double) };
+
     int min_d, max_d;
+    // the padded range; distrib and log_distrib still point at the
+    // entry for min_d.
+    int pad_min, pad_max;
     double *distrib;
     double *log_distrib;
-
+    // the allocation holding both tables, if this DPDF owns them.
+    double *block;
+    // false if distrib and log_distrib point at static tables that
+    // this DPDF must neither modify nor free.
+    bool owned;
+    // for randZ(); built on first use, dropped on any change.
+    mutable AliasTable *alias;
+
+    void dropAlias() {
+      delete alias;
+      alias = NULL;
+    }
+    void freeDistrib() {
+      dropAlias();
+      if (owned) {
+        delete [] block;
+      }
+      block = distrib = log_distrib = NULL;
+      owned = true;
+    }
+    // allocate tables covering [lo, hi) for a distribution starting at
+    // a, zero filled.
+    void allocDistrib(int lo, int hi, int a) {
+      freeDistrib();
+      int stride = (hi - lo + CACHE_LINE_DOUBLES - 1) / CACHE_LINE_DOUBLES * CACHE_LINE_DOUBLES;
+      block = new double[2 * stride + CACHE_LINE_DOUBLES];
+      double *base = block + ((CACHE_LINE_DOUBLES - ((uintptr_t)block / sizeof(double)) % CACHE_LINE_DOUBLES) % CACHE_LINE_DOUBLES);
+      std::fill(base, base + stride, 0.0);
+      std::fill(base + stride, base + 2 * stride, LOG_ZERO);
+      distrib = base + (a - lo);
+      log_distrib = base + stride + (a - lo);
+      pad_min = lo;
+      pad_max = hi;
+    }
+    // fresh, unpadded tables for [min_d, min_d + l).
     void reallocDistrib(int l) {
-      if (distrib) delete [] distrib;
-      if (log_distrib) delete [] log_distrib;
-      distrib = new double[l];
-      log_distrib = new double[l];
+      allocDistrib(min_d, min_d + l, min_d);
+    }
+    // copy [pad_min, pad_max) of d and ld, which start at min_d, into
+    // fresh tables covering [lo, hi).
+    void copyDistrib(const double *d, const double *ld, int lo, int hi) {
+      int a = pad_min, b = pad_max;
+      allocDistrib(std::min(lo, a), std::max(hi, b), min_d);
+      std::copy(d + (a - min_d), d + (b - min_d), distrib + (a - min_d));
+      std::copy(ld + (a - min_d), ld + (b - min_d), log_distrib + (a - min_d));
+    }
+    // take a private copy of static tables before modifying them.
+    void ownDistrib() {
+      dropAlias();
+      if (!owned) {
+        const double *d = distrib, *ld = log_distrib;
+        distrib = log_distrib = NULL;
+        owned = true;
+        copyDistrib(d, ld, pad_min, pad_max);
+      }
     }
     void updateLogDistrib() {
       for (int i = 0; i < max_d - min_d; i++) {
@@ -80,28 +248,68 @@ namespace MATH {
 
     DPDF &operator=(const DPDF &d) {
       if (this != &d) {
-        reallocDistrib(d.max_d - d.min_d);
-        std::copy(d.distrib, d.distrib + d.max_d - d.min_d, distrib);
-        std::copy(d.log_distrib, d.log_distrib + d.max_d - d.min_d, log_distrib);
+        freeDistrib();
         min_d = d.min_d;
         max_d = d.max_d;
+        pad_min = d.pad_min;
+        pad_max = d.pad_max;
+        if (d.owned) {
+          copyDistrib(d.distrib, d.log_distrib, pad_min, pad_max);
+        } else {
+          distrib = d.distrib;
+          log_distrib = d.log_distrib;
+          owned = false;
+        }
       }
       return *this;
     }
 
-    DPDF(const DPDF &d) : RefObj(), min_d(0), max_d(0), distrib(NULL), log_distrib(NULL) {
+    DPDF(const DPDF &d) : RefObj(), min_d(0), max_d(0), pad_min(0), pad_max(0), distrib(NULL), log_distrib(NULL), block(NULL), owned(true), alias(NULL) {
       *this = d;
     }
 
-    DPDF() : RefObj(), min_d(0), max_d(0), distrib(NULL), log_distrib(NULL) {
+    DPDF() : RefObj(), min_d(0), max_d(0), pad_min(0), pad_max(0), distrib(NULL), log_distrib(NULL), block(NULL), owned(true), alias(NULL) {
     }
 
     virtual ~DPDF() {
-      if (distrib) delete [] distrib;
-      if (log_distrib) delete [] log_distrib;
+      freeDistrib();
+    }
+
+    // wrap precomputed, normalized tables covering [a, b) without
+    // copying them. the tables must outlive this DPDF and any copies
+    // of it; they are copied on the first modification.
+    bool setStaticDistrib(int a, int b, const double *d, const double *log_d) {
+      if (b <= a) return false;
+      freeDistrib();
+      min_d = pad_min = a;
+      max_d = pad_max = b;
+      distrib = const_cast<double *>(d);
+      log_distrib = const_cast<double *>(log_d);
+      owned = false;
+      return true;
+    }
+
+    // widen the tables to cover at least [lo, hi). static tables are
+    // copied.
+    void pad(int lo, int hi) {
+      if (lo >= pad_min && hi <= pad_max) return;
+      dropAlias();
+      const double *d = distrib, *ld = log_distrib;
+      double *old = owned ? block : NULL;
+      block = NULL;
+      owned = true;
+      copyDistrib(d, ld, lo, hi);
+      delete [] old;
+    }
+    int padMin() const {
+      return pad_min;
+    }
+    int padMax() const {
+      return pad_max;
     }
 
     bool normalize() {
+      ownDistrib();
       double freq_sum = std::accumulate(distrib, distrib + max_d - min_d, 0.0);
       if (freq_sum <= 0.0) return false;
       for (int i = 0; i < max_d - min_d; i++) {
@@ -118,7 +326,7 @@ namespace MATH {
       min_d = a;
       max_d = b;
       reallocDistrib(b - a);
-      std::copy(freqs, freqs + b - a, log_distrib);
+      std::copy(freqs, freqs + b - a, distrib);
       if (norm) {
         normalize();
       } else {
@@ -141,6 +349,7 @@ namespace MATH {
       reallocDistrib(b - a);
       std::copy(log_freqs, log_freqs + b - a, log_distrib);
       updateDistrib();
+      return true;
     }
 
     template<typename T>
@@ -174,6 +383,7 @@ namespace MATH {
     }
     bool setp(int i, double d) {
       if (i < min_d || i >= max_d) return false;
+      ownDistrib();
       distrib[i - min_d] = d;
       log_distrib[i - min_d] = MATH::logClip(d);
       return true;
@@ -183,9 +393,18 @@ namespace MATH {
       if (l < min_d || l >= max_d) return MATH::LOG_ZERO;
       return log_distrib[l - min_d];
     }
+    // p() and logp() without the range check; l must lie in [padMin(),
+    // padMax()).
+    double pPadded(int l) const {
+      return distrib[l - min_d];
+    }
+    double logpPadded(int l) const {
+      return log_distrib[l - min_d];
+    }
     bool setlogp(int i, double d) {
       d = std::max(std::min(d, MATH::LOG_INF), MATH::LOG_ZERO);
       if (i < min_d || i >= max_d) return false;
+      ownDistrib();
       log_distrib[i - min_d] = d;
       distrib[i - min_d] = exp(d);
       return true;
@@ -198,13 +417,28 @@ namespace MATH {
     int distribMax() const {
       return max_d;
     }
-    int randZ() const {
-      double r = random() / double(RAND_MAX);
-      for (int i = 0; i < max_d - min_d; i++) {
-        r -= distrib[i];
-        if (r <= 0.0) return i + min_d;
+
+    // the table is built lazily; threads sharing a DPDF may race to
+    // build it, and all but the first throw theirs away.
+    const AliasTable &aliasTable() const {
+      if (alias == NULL) {
+        AliasTable *t = new AliasTable(distrib, max_d - min_d);
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+        if (!__sync_bool_compare_and_swap(&alias, (AliasTable *)NULL, t)) delete t;
+#else
+        alias = t;
+#endif
       }
-      return max_d - 1;
+      return *alias;
+    }
+
+    // draw from the distribution, using the global random() or an
+    // explicit generator.
+    int randZ() const {
+      return min_d + aliasTable().sample(random() / (RAND_MAX + 1.0));
+    }
+    int randZ(Random &rng) const {
+      return min_d + aliasTable().sample(rng);
     }
 
     std::ostream &dump(std::ostream &o) const {
@@ -217,7 +451,7 @@ namespace MATH {
     }
   };
 
-  template<int base, int power> struct __pow__          { enum { val = __pow__<base, power >> 1>::val * __pow__<base, power - (power >> 1)>::val }; };
+  template<int base, int power> struct __pow__          { enum { val = __pow__<base, (power >> 1)>::val * __pow__<base, power - (power >> 1)>::val }; };
   template<int base>            struct __pow__<base, 1> { enum { val = base }; };
   template<int base>            struct __pow__<base, 0> { enum { val = 1 }; };
 
@@ -34,19 +34,37 @@ struct RefCounter {
   static T &deref(T * const &t) { return *t; }
 };
 
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+#define REF_ATOMIC_ADD(p, n) __sync_add_and_fetch((p), (n))
+#else
+#define REF_ATOMIC_ADD(p, n) (*(p) += (n))
+#endif
+
+// Reference counts are updated atomically, so Refs to one object may
+// be copied and dropped from several threads. An object that is
+// shared read only can instead be frozen: while frozen, incref and
+// decref do nothing, so readers never write to the object's cache
+// line. Refs taken while an object is frozen must be dropped before
+// it is thawed. The frozen flag itself is a plain variable: freeze()
+// and thaw() may only be called while no other thread is using the
+// object, ie. before the threads that share it are started and after
+// they are joined. Freezing an object does not freeze the objects it
+// holds Refs to.
 class RefObj {
   mutable int __refcount;
+  mutable bool __frozen;
   template<class T> friend class RefCounter;
 
   RefObj(const RefObj &);
   RefObj &operator=(const RefObj &);
 
   void incref() const {
-    __refcount++;
+    if (__frozen) return;
+    REF_ATOMIC_ADD(&__refcount, 1);
   }
   void decref() const {
-    !--__refcount;
-    if (!__refcount) {
+    if (__frozen) return;
+    if (!REF_ATOMIC_ADD(&__refcount, -1)) {
       delete this;
     }
   }
@@ -59,7 +77,16 @@ public:
   int refcount() const {
     return __refcount;
   }
-  RefObj() : __refcount(0) {
+  void freeze() const {
+    __frozen = true;
+  }
+  void thaw() const {
+    __frozen = false;
+  }
+  bool frozen() const {
+    return __frozen;
+  }
+  RefObj() : __refcount(0), __frozen(false) {
   }
 };
 
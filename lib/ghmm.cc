@@ -29,8 +29,9 @@ const std::string Model::BEGIN = "__BEGIN__";
 const std::string Model::END = "__END__";
 
 Model::Model(const std::vector<std::pair<std::string, StateBase::Ptr> > &in_states,
-             const std::map<std::pair<int, int>, double> &in_state_trans_map) :
-  RefObj(), state_names(), state_name_map(), pred_states(), succ_states(), states(), state_trans(NULL), state_count(0) {
+             const std::map<std::pair<int, int>, double> &in_state_trans_map,
+             const Ref<UTIL::Alphabet> &alphabet) :
+  RefObj(), state_names(), state_name_map(), pred_states(), succ_states(), states(), state_trans(NULL), state_log_trans(NULL), trans_alias(), state_count(0), first_silent(0), symbol_alphabet(alphabet), error_message() {
 
   std::vector<bool> reachable(in_states.size(), false);
   {
@@ -60,6 +61,40 @@ Model::Model(const std::vector<std::pair<std::string, StateBase::Ptr> > &in_stat
     delete [] a;
   }
 
+  // emitting states keep their order. silent states follow them, each
+  // after the silent states with a transition into it, so that a
+  // column can be evaluated in state order.
+  std::vector<int> order, silent;
+  for (unsigned i = 0; i < in_states.size(); i++) {
+    if (reachable[i] && in_states[i].second != NULL) {
+      if (in_states[i].second->silent()) {
+        silent.push_back(i);
+      } else {
+        order.push_back(i);
+      }
+    }
+  }
+  first_silent = order.size() + 1;
+  while (silent.size()) {
+    size_t k;
+    for (k = 0; k < silent.size(); k++) {
+      bool ready = true;
+      for (size_t m = 0; ready && m < silent.size(); m++) {
+        std::map<std::pair<int, int>, double>::const_iterator i = in_state_trans_map.find(std::make_pair(silent[m], silent[k]));
+        ready = i == in_state_trans_map.end() || !((*i).second > 0.0);
+      }
+      if (ready) break;
+    }
+    if (k == silent.size()) {
+      // no order evaluates these in one pass over a column.
+      error_message = "model has a loop among the silent states:";
+      for (k = 0; k < silent.size(); k++) error_message += " " + in_states[silent[k]].first;
+      return;
+    }
+    order.push_back(silent[k]);
+    silent.erase(silent.begin() + k);
+  }
+
   std::map<int, int> state_num_remap;
 
   states.push_back(StateBase::Ptr());
@@ -67,15 +102,15 @@ Model::Model(const std::vector<std::pair<std::string, StateBase::Ptr> > &in_stat
   state_num_remap[C_BEGIN] = 0;
 
   for (unsigned i = 0; i < in_states.size(); i++) {
-    if (reachable[i] && in_states[i].second != NULL) {
-      // std::cerr << "REMAP " << i << " : " << in_states[i].first << " -> " << states.size() << std::endl;
-      state_num_remap[i] = states.size();
-      state_name_map[in_states[i].first] = states.size();
-      state_names.push_back(in_states[i].first);
-      states.push_back(in_states[i].second);
-    } else {
-      state_num_remap[i] = -1;
-    }
+    state_num_remap[i] = -1;
+  }
+  for (unsigned k = 0; k < order.size(); k++) {
+    int i = order[k];
+    // std::cerr << "REMAP " << i << " : " << in_states[i].first << " -> " << states.size() << std::endl;
+    state_num_remap[i] = states.size();
+    state_name_map[in_states[i].first] = states.size();
+    state_names.push_back(in_states[i].first);
+    states.push_back(in_states[i].second);
   }
 
   state_num_remap[C_END] = states.size();
@@ -135,6 +170,11 @@ Model::Model(const std::vector<std::pair<std::string, StateBase::Ptr> > &in_stat
     state_log_trans[i] = MATH::logClip(state_trans[i]);
   }
 
+  trans_alias.resize(state_count - 1);
+  for (int s = 0; s < state_count - 1; s++) {
+    trans_alias[s].build(state_trans + s * state_count, state_count);
+  }
+
 //   for (int i = 0; i < state_count; i++) {
 //     for (int j = 0; j < state_count; j++) {
 //       fprintf(stderr, "%9.7f ", state_trans[i * state_count + j]);
@@ -149,7 +189,7 @@ Model::~Model() {
 }
 
 ModelBuilder::ModelBuilder() :
-  RefObj(), states(), state_name_map(), state_trans_map() {
+  RefObj(), states(), state_name_map(), state_trans_map(), alphabet(), error_message() {
   state_name_map[Model::BEGIN] = C_BEGIN;
   state_name_map[Model::END] = C_END;
 }
@@ -195,6 +235,13 @@ void ModelBuilder::addStateTransition(const std::string &src_state, const std::s
   state_trans_map[std::make_pair(stateNum(src_state), stateNum(tgt_state))] = freq;
 }
 
+void ModelBuilder::setAlphabet(const Ref<UTIL::Alphabet> &a) {
+  alphabet = a;
+}
+
 Model::Ptr ModelBuilder::make() {
-  return new Model(states, state_trans_map);
+  Model::Ptr model = new Model(states, state_trans_map, alphabet);
+  error_message = model->error();
+  if (error_message.size()) return Model::Ptr();
+  return model;
 }
@@ -21,6 +21,7 @@
 #include <GHMM/ghmm.hh>
 
 const std::string GHMM::UTIL::Alphabet::NO_TOKEN;
+const unsigned char GHMM::UTIL::Alphabet::SKIP;
 
 #define IFTYPE(klass, p) if (klass *ptr = dynamic_cast<klass *>(p.ptr()))
 
@@ -0,0 +1,514 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+
+#include "predict_pexel.hh"
+
+static const struct option options[] = {
+  { "output",            required_argument,          0,            'o' },
+  { "seed",              required_argument,          0,            's' },
+  { "min-time",          required_argument,          0,            'T' },
+  { "exportpred",        required_argument,          0,            'e' },
+  { "threads",           required_argument,          0,            't' },
+  { "proteome",          required_argument,          0,            'p' },
+  { "scale",             required_argument,          0,            'S' },
+  { "no-end-to-end",     no_argument,                0,            'x' },
+  { 0,                   0,                          0,            0   }
+};
+
+void usage(const char *progname) {
+  std::cout << "Usage: " << progname << " [arguments]" << std::endl;
+  std::cout << "\
+\n\
+Time the GHMM kernels, a parse under each model, and exportpred over\n\
+synthetic proteomes, and write the results as JSON.\n\
+\n\
+--output=file           -o file        write results to file (-:stdout)\n\
+--seed=n                -s n           seed for the synthetic sequences\n\
+                                       (default: 1)\n\
+--min-time=s            -T s           run each kernel and parse benchmark\n\
+                                       for at least s seconds (default: 0.5)\n\
+--exportpred=path       -e path        exportpred binary for the end to end\n\
+                                       runs (default: exportpred next to\n\
+                                       this program)\n\
+--threads=n             -t n           exportpred --threads (default: 1)\n\
+--proteome=name:n:a:b   -p name:n:a:b  end to end run over n sequences of\n\
+                                       a to b residues, drawn from the v2\n\
+                                       model; may be given more than once\n\
+                                       (default: short:2000:50:300\n\
+                                       typical:1000:300:1500\n\
+                                       long:50:2000:10000)\n\
+--scale=f               -S f           multiply proteome sizes by f\n\
+--no-end-to-end         -x             only run the kernel and parse\n\
+                                       benchmarks\n\
+\n\
+";
+}
+
+static double now() {
+  struct timeval tv;
+  gettimeofday(&tv, NULL);
+  return tv.tv_sec + tv.tv_usec * 1e-6;
+}
+
+// keeps the compiler from dropping the work being timed.
+static volatile double sink;
+
+// time op(n) for n doubling until a run takes at least min_time;
+// returns the seconds per operation of the last run.
+template<typename Op>
+static double timeOps(Op &op, double min_time, uint64_t &n) {
+  double t;
+  n = 1;
+  while (1) {
+    double start = now();
+    sink = sink + op(n);
+    t = now() - start;
+    if (t >= min_time || n >= (1ULL << 40)) break;
+    n = (uint64_t)(n * (t > 0.0 ? std::max(2.0, std::min(100.0, 1.5 * min_time / t)) : 100.0));
+  }
+  return t / n;
+}
+
+static MATH::DPDF::Ptr randomDPDF(MATH::Random &rng) {
+  MATH::DPDF::Ptr result = new MATH::DPDF();
+  result->setDistrib(0, 26, 0.0);
+  for (int c = 0; c < 26; c++) result->setp(c, rng.uniform() + 0.01);
+  result->normalize();
+  return result;
+}
+
+static std::vector<GHMM::Symbol> randomResidues(MATH::Random &rng, int n) {
+  std::vector<GHMM::Symbol> result(n);
+  for (int i = 0; i < n; i++) result[i] = rng.next() % 26;
+  return result;
+}
+
+// Stateless::Generator<-1>::gen, as a state with lengths up to 60
+// calls it at every position; one op is one gen() call.
+struct StatelessGen {
+  GHMM::EMISSION::Stateless emit;
+  std::vector<GHMM::Symbol> seq;
+
+  StatelessGen(MATH::Random &rng) : emit(randomDPDF(rng)), seq(randomResidues(rng, 4096)) {
+  }
+  double operator()(uint64_t n) {
+    double s = 0.0, logp;
+    int d;
+    uint64_t ops = 0;
+    while (ops < n) {
+      for (int p = 64; p < (int)seq.size() && ops < n; p++) {
+        GHMM::EMISSION::Stateless::Generator<-1> g(&emit, &seq[p], 1, 61);
+        while (ops < n && g.gen(d, logp)) {
+          s += logp;
+          ops++;
+        }
+      }
+    }
+    return s;
+  }
+};
+
+// PositionSpecific::Generator<-1>::gen over a 7 column motif; one op
+// is one gen() call, scoring all 7 columns.
+struct PositionSpecificGen {
+  GHMM::EMISSION::PositionSpecific emit;
+  std::vector<GHMM::Symbol> seq;
+
+  PositionSpecificGen(MATH::Random &rng) : emit(), seq(randomResidues(rng, 4096)) {
+    std::vector<MATH::DPDF::Ptr> pssm;
+    for (int k = 0; k < 7; k++) pssm.push_back(randomDPDF(rng));
+    emit.setEmissionDistrib(pssm);
+  }
+  double operator()(uint64_t n) {
+    double s = 0.0, logp;
+    int d;
+    for (uint64_t i = 0; i < n; i++) {
+      GHMM::EMISSION::PositionSpecific::Generator<-1> g(&emit, &seq[8 + i % (seq.size() - 8)], 1, 8);
+      if (g.gen(d, logp)) s += logp;
+    }
+    return s;
+  }
+};
+
+struct LogAdd {
+  std::vector<double> x;
+
+  LogAdd(MATH::Random &rng) : x(4096) {
+    for (size_t i = 0; i < x.size(); i++) x[i] = -50.0 * rng.uniform();
+  }
+  double operator()(uint64_t n) {
+    double s = 0.0;
+    for (uint64_t i = 0; i < n; i++) {
+      s += MATH::logAdd(x[i & 4095], x[(i + 1) & 4095]);
+    }
+    return s;
+  }
+};
+
+struct DPDFLogp {
+  MATH::DPDF::Ptr dpdf;
+  std::vector<int> idx;
+
+  DPDFLogp(MATH::Random &rng) : dpdf(randomDPDF(rng)), idx(4096) {
+    for (size_t i = 0; i < idx.size(); i++) idx[i] = rng.next() % 26;
+  }
+  double operator()(uint64_t n) {
+    double s = 0.0;
+    for (uint64_t i = 0; i < n; i++) s += dpdf->logp(idx[i & 4095]);
+    return s;
+  }
+};
+
+// the same lookups in a table padded to every symbol.
+struct DPDFLogpPadded {
+  MATH::DPDF::Ptr dpdf;
+  std::vector<int> idx;
+
+  DPDFLogpPadded(MATH::Random &rng) : dpdf(randomDPDF(rng)), idx(4096) {
+    dpdf->pad(0, GHMM::EMISSION::SYMBOLS);
+    for (size_t i = 0; i < idx.size(); i++) idx[i] = rng.next() % 26;
+  }
+  double operator()(uint64_t n) {
+    double s = 0.0;
+    for (uint64_t i = 0; i < n; i++) s += dpdf->logpPadded(idx[i & 4095]);
+    return s;
+  }
+};
+
+// one op parses every sequence in seqs once.
+struct ParseAll {
+  GHMM::Model::Ptr model;
+  std::vector<std::vector<GHMM::Symbol> > seqs;
+  GHMM::Parse::Ptr parse;
+  uint64_t residues;
+
+  ParseAll(const GHMM::Model::Ptr &m, MATH::Random &rng, uint64_t min_residues) : model(m), seqs(), parse(new GHMM::Parse()), residues(0) {
+    while (residues < min_residues) {
+      std::vector<int> g = model->generate(rng);
+      if (!g.size()) continue;
+      seqs.push_back(std::vector<GHMM::Symbol>(g.begin(), g.end()));
+      residues += g.size();
+    }
+  }
+  double operator()(uint64_t n) {
+    double s = 0.0;
+    for (uint64_t i = 0; i < n; i++) {
+      for (size_t j = 0; j < seqs.size(); j++) {
+        parse->parse(model, seqs[j].begin(), seqs[j].end());
+        s += parse->alpha(1, 0);
+      }
+    }
+    return s;
+  }
+};
+
+// the coin model test_ghmm runs.
+static GHMM::Model::Ptr makeCoinModel() {
+  GHMM::UTIL::Alphabet::Ptr alphabet = new GHMM::UTIL::Alphabet();
+  alphabet->addToken("heads");
+  alphabet->addToken("tails");
+  GHMM::UTIL::EmissionDistributionParser::Ptr ep = new GHMM::UTIL::EmissionDistributionParser(alphabet);
+
+  GHMM::ModelBuilder mb;
+  mb.addState("heads", GHMM::UTIL::makeState(new GHMM::LENGTH::Geometric(10), new GHMM::EMISSION::Stateless(ep->parse("heads: 9 tails: 1"))));
+  mb.addState("tails", GHMM::UTIL::makeState(new GHMM::LENGTH::Fixed(10), new GHMM::EMISSION::Stateless(ep->parse("tails: 9 heads: 1"))));
+
+  mb.addStateTransition(GHMM::Model::BEGIN, "heads",          1);
+  mb.addStateTransition(GHMM::Model::BEGIN, "tails",          1);
+  mb.addStateTransition("heads",            "tails",          9);
+  mb.addStateTransition("heads",            GHMM::Model::END, 1);
+  mb.addStateTransition("tails",            "heads",          9);
+  mb.addStateTransition("tails",            GHMM::Model::END, 1);
+  return mb.make();
+}
+
+// an initial Met and a signal sequence, as simulate_signalseqs draws
+// them.
+static GHMM::Model::Ptr makeSignalModel(bool signalp) {
+  GHMM::UTIL::Alphabet::Ptr alphabet = new GHMM::UTIL::Alphabet();
+  alphabet->addCharTokenRange('A','Z');
+  GHMM::UTIL::EmissionDistributionParser::Ptr ep = new GHMM::UTIL::EmissionDistributionParser(alphabet);
+  GHMM::ModelBuilder mb;
+
+  mb.addState("met", GHMM::UTIL::makeState(NULL, new GHMM::EMISSION::Stateless(ep->parse("M: 1"))));
+  mb.addStateTransition(GHMM::Model::BEGIN, "met", 1);
+
+  std::pair<std::string, std::string> ss_states = signalp ? makeSignalPModel(mb, alphabet) : makeSSModel(mb, alphabet, 2);
+  mb.addStateTransition("met", ss_states.first, 1);
+  mb.addStateTransition(ss_states.second, GHMM::Model::END, 1);
+  return mb.make();
+}
+
+struct Proteome {
+  std::string name;
+  int count, min_len, max_len;
+};
+
+static bool parseProteome(const char *spec, Proteome &p) {
+  char name[256];
+  if (sscanf(spec, "%255[^:]:%d:%d:%d", name, &p.count, &p.min_len, &p.max_len) != 4) return false;
+  p.name = name;
+  return p.count > 0 && p.min_len > 0 && p.max_len >= p.min_len;
+}
+
+// write count sequences from the v2 model, cut or padded (from the
+// background branch) to lengths uniform in [min_len, max_len].
+static uint64_t writeProteome(FILE *fp, const Proteome &p, const GHMM::Model::Ptr &model, MATH::Random &rng) {
+  const GHMM::StateBase &background(*model->state(model->stateNumber("c-tail")));
+  uint64_t residues = 0;
+
+  for (int i = 0; i < p.count; i++) {
+    int len = p.min_len + (int)(rng.uniform() * (p.max_len - p.min_len + 1));
+    std::vector<int> seq = model->generate(rng);
+    while ((int)seq.size() < len) background.generate(seq, rng);
+    seq.resize(len);
+
+    fprintf(fp, ">%s%d\n", p.name.c_str(), i);
+    std::string line(seq.size(), ' ');
+    for (int j = 0; j < len; j++) line[j] = 'A' + seq[j];
+    fprintf(fp, "%s\n", line.c_str());
+    residues += len;
+  }
+  return residues;
+}
+
+// run exportpred over path; returns false if it could not be run.
+static bool runExportpred(const std::string &exportpred, const std::string &path, int threads, double &seconds, long &peak_rss_kb) {
+  char t[32];
+  snprintf(t, sizeof(t), "%d", threads);
+
+  double start = now();
+  pid_t pid = fork();
+  if (pid < 0) return false;
+  if (pid == 0) {
+    int null_fd = open("/dev/null", O_WRONLY);
+    if (null_fd >= 0) dup2(null_fd, 2);
+    execl(exportpred.c_str(), exportpred.c_str(), "-i", path.c_str(), "-o", "/dev/null", "-t", t, (char *)NULL);
+    _exit(127);
+  }
+
+  int status;
+  struct rusage usage;
+  if (wait4(pid, &status, 0, &usage) != pid) return false;
+  seconds = now() - start;
+  peak_rss_kb = usage.ru_maxrss;
+  return WIFEXITED(status) && WEXITSTATUS(status) == 0;
+}
+
+int main(int argc, char **argv) {
+  std::string output = "-";
+  uint64_t seed = 1;
+  double min_time = 0.5;
+  std::string exportpred;
+  int n_threads = 1;
+  std::vector<Proteome> proteomes;
+  double scale = 1.0;
+  bool end_to_end = true;
+
+  int ch;
+
+  while ((ch = getopt_long(argc, argv, "o:s:T:e:t:p:S:xh", options, NULL)) != -1) {
+    switch (ch) {
+    case 'o': {
+      output = optarg;
+      break;
+    }
+    case 's': {
+      seed = strtoull(optarg, NULL, 10);
+      break;
+    }
+    case 'T': {
+      min_time = std::max(0.001, atof(optarg));
+      break;
+    }
+    case 'e': {
+      exportpred = optarg;
+      break;
+    }
+    case 't': {
+      n_threads = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'p': {
+      Proteome p;
+      if (!parseProteome(optarg, p)) {
+        std::cerr << "bad proteome: " << optarg << std::endl;
+        exit(1);
+      }
+      proteomes.push_back(p);
+      break;
+    }
+    case 'S': {
+      scale = atof(optarg);
+      break;
+    }
+    case 'x': {
+      end_to_end = false;
+      break;
+    }
+    case 'h':
+    case '?': {
+      usage(argv[0]);
+      exit(0);
+    }
+    }
+  }
+
+  if (!proteomes.size()) {
+    const char *defaults[] = { "short:2000:50:300", "typical:1000:300:1500", "long:50:2000:10000" };
+    for (int i = 0; i < (int)ARRAYLEN(defaults); i++) {
+      Proteome p;
+      parseProteome(defaults[i], p);
+      proteomes.push_back(p);
+    }
+  }
+  for (size_t i = 0; i < proteomes.size(); i++) {
+    proteomes[i].count = std::max(1, (int)(proteomes[i].count * scale));
+  }
+  if (exportpred.empty()) {
+    std::string self = argv[0];
+    size_t slash = self.rfind('/');
+    exportpred = (slash == std::string::npos ? std::string("./") : self.substr(0, slash + 1)) + "exportpred";
+  }
+
+  FILE *out = stdout;
+  if (output != "-") {
+    out = fopen(output.c_str(), "w");
+    if (out == NULL) {
+      std::cerr << "could not open " << output << std::endl;
+      exit(1);
+    }
+  }
+
+  MATH::Random rng(seed);
+  uint64_t n;
+
+  fprintf(out, "{\n  \"seed\": %llu,\n  \"min_time\": %g,\n", (unsigned long long)seed, min_time);
+
+  fprintf(out, "  \"kernels\": [\n");
+  {
+    StatelessGen stateless(rng);
+    PositionSpecificGen position_specific(rng);
+    LogAdd log_add(rng);
+    DPDFLogp dpdf_logp(rng);
+    DPDFLogpPadded dpdf_logp_padded(rng);
+    const char *names[] = { "Stateless::Generator::gen", "PositionSpecific::Generator::gen", "MATH::logAdd", "DPDF::logp", "DPDF::logpPadded" };
+    for (int k = 0; k < 5; k++) {
+      double t = 0.0;
+      switch (k) {
+      case 0: t = timeOps(stateless, min_time, n); break;
+      case 1: t = timeOps(position_specific, min_time, n); break;
+      case 2: t = timeOps(log_add, min_time, n); break;
+      case 3: t = timeOps(dpdf_logp, min_time, n); break;
+      case 4: t = timeOps(dpdf_logp_padded, min_time, n); break;
+      }
+      fprintf(out, "    { \"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.3f }%s\n", names[k], (unsigned long long)n, t * 1e9, k < 4 ? "," : "");
+      fflush(out);
+    }
+  }
+  fprintf(out, "  ],\n");
+
+  fprintf(out, "  \"parse\": [\n");
+  {
+    const char *names[] = { "coin", "ss", "signalp", "pexel" };
+    for (int k = 0; k < 4; k++) {
+      GHMM::Model::Ptr model;
+      switch (k) {
+      case 0: model = makeCoinModel(); break;
+      case 1: model = makeSignalModel(false); break;
+      case 2: model = makeSignalModel(true); break;
+      case 3: model = makePEXELmodel(PEXELModelOptions()); break;
+      }
+      ParseAll parse(model, rng, 20000);
+      double t = timeOps(parse, min_time, n);
+      double cells = (double)parse.residues * (model->stateCount() - 2);
+      fprintf(out, "    { \"model\": \"%s\", \"states\": %d, \"sequences\": %d, \"residues\": %llu, \"runs\": %llu, "
+              "\"residues_per_sec\": %.1f, \"ns_per_residue\": %.3f, \"ns_per_cell\": %.3f }%s\n",
+              names[k], model->stateCount() - 2, (int)parse.seqs.size(), (unsigned long long)parse.residues, (unsigned long long)n,
+              parse.residues / t, t * 1e9 / parse.residues, t * 1e9 / cells, k < 3 ? "," : "");
+      fflush(out);
+    }
+  }
+  fprintf(out, "  ]");
+
+  if (end_to_end) {
+    GHMM::Model::Ptr model = makePEXELmodel(PEXELModelOptions());
+    const char *tmpdir = getenv("TMPDIR");
+    std::string tmpl = std::string(tmpdir && *tmpdir ? tmpdir : "/tmp") + "/exportpred-bench.XXXXXX";
+
+    fprintf(out, ",\n  \"end_to_end\": [\n");
+    for (size_t i = 0; i < proteomes.size(); i++) {
+      const Proteome &p(proteomes[i]);
+      std::vector<char> path(tmpl.begin(), tmpl.end());
+      path.push_back('\0');
+      int fd = mkstemp(&path[0]);
+      FILE *fp = fd >= 0 ? fdopen(fd, "w") : NULL;
+      if (fp == NULL) {
+        std::cerr << "could not create a temporary file in " << tmpl << std::endl;
+        exit(1);
+      }
+      uint64_t residues = writeProteome(fp, p, model, rng);
+      if (fclose(fp) != 0) {
+        std::cerr << "could not write " << &path[0] << std::endl;
+        exit(1);
+      }
+
+      double seconds;
+      long peak_rss_kb;
+      bool ok = runExportpred(exportpred, &path[0], n_threads, seconds, peak_rss_kb);
+      unlink(&path[0]);
+      if (!ok) {
+        std::cerr << "could not run " << exportpred << std::endl;
+        exit(1);
+      }
+
+      fprintf(out, "    { \"proteome\": \"%s\", \"sequences\": %d, \"residues\": %llu, \"min_length\": %d, \"max_length\": %d, "
+              "\"threads\": %d, \"seconds\": %.3f, \"residues_per_sec\": %.1f, \"sequences_per_sec\": %.1f, \"peak_rss_kb\": %ld }%s\n",
+              p.name.c_str(), p.count, (unsigned long long)residues, p.min_len, p.max_len,
+              n_threads, seconds, residues / seconds, p.count / seconds, peak_rss_kb, i + 1 < proteomes.size() ? "," : "");
+      fflush(out);
+    }
+    fprintf(out, "  ]");
+  }
+  fprintf(out, "\n}\n");
+
+  if (fflush(out) != 0 || (out != stdout && fclose(out) != 0)) {
+    std::cerr << "could not write output" << std::endl;
+    exit(1);
+  }
+}
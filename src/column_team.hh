@@ -0,0 +1,114 @@
+#ifndef COLUMN_TEAM_HH_INCLUDED
+#define COLUMN_TEAM_HH_INCLUDED
+
+#include <sched.h>
+#include <vector>
+#include <GHMM/ghmm.hh>
+#include "pipeline.hh"
+
+// Shares the states of each column between the calling thread and a
+// set of helper threads. A column is only a few microseconds of work,
+// so helpers wait for the next one by spinning, then by yielding, and
+// only go to sleep once nothing has come for a while; this only pays
+// off for long sequences.
+class ThreadedColumnTeam : public GHMM::ColumnTeam {
+  ThreadedColumnTeam(const ThreadedColumnTeam &);
+  ThreadedColumnTeam &operator=(const ThreadedColumnTeam &);
+
+  enum { SPINS = 2000, YIELDS = 200 };
+
+  struct Helper {
+    ThreadedColumnTeam *team;
+    void run() {
+      team->help();
+    }
+  };
+
+  // generation is bumped to start each column; next is the next state
+  // to be taken, and pending the number of helpers still working.
+  volatile int generation, next, pending, sleepers;
+  volatile bool stopping;
+  GHMM::Parse *parse;
+  const GHMM::Model *model;
+  int max_len, state_end;
+
+  Mutex mutex;
+  Condition wake;
+  std::vector<Helper> helpers;
+  std::vector<Thread<Helper> *> threads;
+
+  void work() {
+    int j;
+    while ((j = atomicAdd(&next, 1) - 1) < state_end) {
+      parse->columnState(*model, j, max_len);
+    }
+  }
+
+  void help() {
+    int seen = 0;
+    while (1) {
+      for (int spins = 0; generation == seen && !stopping; spins++) {
+        if (spins < SPINS) continue;
+        if (spins < SPINS + YIELDS) {
+          sched_yield();
+          continue;
+        }
+        Lock l(mutex);
+        atomicAdd(&sleepers, 1);
+        while (generation == seen && !stopping) wake.wait(mutex);
+        atomicAdd(&sleepers, -1);
+      }
+      if (stopping) return;
+      memoryBarrier();
+      seen = generation;
+      work();
+      atomicAdd(&pending, -1);
+    }
+  }
+
+public:
+  // size is the number of threads sharing a column, the caller
+  // included.
+  ThreadedColumnTeam(int size) : generation(0), next(0), pending(0), sleepers(0), stopping(false), parse(NULL), model(NULL), max_len(0), state_end(0), helpers(size > 1 ? size - 1 : 0), threads() {
+  }
+  ~ThreadedColumnTeam() {
+    stopping = true;
+    memoryBarrier();
+    {
+      Lock l(mutex);
+      wake.broadcast();
+    }
+    for (size_t t = 0; t < threads.size(); t++) delete threads[t];
+  }
+
+  bool start() {
+    for (size_t t = 0; t < helpers.size(); t++) {
+      helpers[t].team = this;
+      threads.push_back(new Thread<Helper>);
+      if (!threads.back()->start(&helpers[t])) return false;
+    }
+    return true;
+  }
+
+  void column(GHMM::Parse &p, const GHMM::Model &m, int len) {
+    parse = &p;
+    model = &m;
+    max_len = len;
+    state_end = m.firstSilent();
+    next = 1;
+    pending = helpers.size();
+    atomicAdd(&generation, 1);
+    if (sleepers) {
+      Lock l(mutex);
+      wake.broadcast();
+    }
+
+    work();
+    for (int spins = 0; pending; spins++) {
+      if (spins >= SPINS) sched_yield();
+    }
+    memoryBarrier();
+  }
+};
+
+#endif
@@ -0,0 +1,408 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <getopt.h>
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <ctype.h>
+
+#include "predict_pexel.hh"
+#include "model_file.hh"
+#include "fasta_reader.hh"
+#include "column_team.hh"
+
+static const struct option options[] = {
+  { "input",             required_argument,          0,            'i' },
+  { "output",            required_argument,          0,            'o' },
+  { "model",             required_argument,          0,            'm' },
+  { "candidate",         required_argument,          0,            'c' },
+  { "column-threads",    required_argument,          0,            'C' },
+  { "round",             required_argument,          0,            'd' },
+  { "RLE-threshold",     required_argument,          0,            'R' },
+  { "KLD-threshold",     required_argument,          0,            'K' },
+  { "tolerance",         required_argument,          0,            'e' },
+  { 0,                   0,                          0,            0   }
+};
+
+void usage(const char *progname) {
+  std::cout << "Usage: " << progname << " [arguments]" << std::endl;
+  std::cout << "\
+\n\
+Score sequences with the reference engine (one thread, the exact\n\
+model) and with a candidate configuration, and report how far the\n\
+candidate's alpha values for a-tail, b-tail and c-tail stray, whether\n\
+it makes the same RLE and KLD calls and Viterbi parses, and how much\n\
+faster it is, as JSON.\n\
+\n\
+--input=file            -i file        sequences to score (required, may\n\
+                                       be given more than once)\n\
+--output=file           -o file        write the report to file\n\
+                                       (-:stdout)\n\
+--model=spec            -m spec        reference model variant, as for\n\
+                                       exportpred --model (default: v2)\n\
+--candidate=spec        -c spec        candidate model variant (default:\n\
+                                       the reference)\n\
+--column-threads=n      -C n           the candidate shares each column\n\
+                                       between n threads (default: 1)\n\
+--round=n               -d n           round the candidate's parameters to\n\
+                                       n significant digits\n\
+--RLE-threshold=x       -R x           RLE call threshold (default: 4.3)\n\
+--KLD-threshold=x       -K x           KLD call threshold (default: 0.0)\n\
+--tolerance=x           -e x           exit with status 1 unless alpha\n\
+                                       stays within x of the reference and\n\
+                                       every call and parse agrees\n\
+\n\
+";
+}
+
+static double now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static double roundDigits(double x, int digits) {
+  char buf[64];
+  snprintf(buf, sizeof(buf), "%.*g", digits, x);
+  return strtod(buf, NULL);
+}
+
+// the model with every probability and weight rounded, as if read
+// from a model file written with that many digits.
+static GHMM::Model::Ptr roundModel(const GHMM::Model::Ptr &model, int digits) {
+  ModelFile mf;
+  std::string err;
+  if (!mf.describe(*model, err)) {
+    std::cerr << "cannot round the candidate model: " << err << std::endl;
+    exit(1);
+  }
+  for (size_t s = 0; s < mf.states.size(); s++) {
+    ModelFile::State &st(mf.states[s]);
+    st.p_self = roundDigits(st.p_self, digits);
+    for (size_t i = 0; i < st.lengths.size(); i++) st.lengths[i] = roundDigits(st.lengths[i], digits);
+    for (size_t r = 0; r < st.emit.size(); r++) {
+      for (size_t i = 0; i < st.emit[r].size(); i++) st.emit[r][i] = roundDigits(st.emit[r][i], digits);
+    }
+  }
+  for (size_t t = 0; t < mf.transitions.size(); t++) {
+    mf.transitions[t].weight = roundDigits(mf.transitions[t].weight, digits);
+  }
+  GHMM::Model::Ptr rounded = mf.make(err);
+  if (rounded == NULL) {
+    std::cerr << "cannot round the candidate model: " << err << std::endl;
+    exit(1);
+  }
+  return rounded;
+}
+
+static const char *TAILS[] = { "a-tail", "b-tail", "c-tail" };
+enum { A_TAIL, B_TAIL, C_TAIL, N_TAILS };
+
+// One way of scoring: a model, a workspace and, if columns are
+// shared, a team. tails are the state numbers of TAILS, or -1.
+struct Engine {
+  GHMM::Model::Ptr model;
+  GHMM::Parse::Ptr parse;
+  ThreadedColumnTeam *team;
+  int tails[N_TAILS];
+  double seconds;
+
+  Engine(const GHMM::Model::Ptr &m, int column_threads) : model(m), parse(new GHMM::Parse()), team(NULL), seconds(0.0) {
+    for (int t = 0; t < N_TAILS; t++) tails[t] = model->stateNumber(TAILS[t]);
+    if (tails[C_TAIL] < 0) {
+      std::cerr << "the model has no c-tail state" << std::endl;
+      exit(1);
+    }
+    if (column_threads > 1) {
+      team = new ThreadedColumnTeam(column_threads);
+      if (!team->start()) {
+        std::cerr << "could not start column threads" << std::endl;
+        exit(1);
+      }
+    }
+  }
+  ~Engine() {
+    delete team;
+  }
+
+  void score(const std::vector<unsigned char> &codes) {
+    double start = now();
+    parse->parse(model, codes.begin(), codes.end(), team);
+    seconds += now() - start;
+  }
+
+  double alpha(int t) const {
+    return tails[t] >= 0 ? parse->alpha(tails[t], 0) : MATH::LOG_ZERO;
+  }
+
+  // the Viterbi parse ending in tail t, last segment first, with
+  // states named so that models numbering them differently compare,
+  // and the parts of states split by tail= joined.
+  void path(int t, std::vector<std::pair<std::string, int> > &segments) const {
+    segments.clear();
+    if (tails[t] < 0) return;
+    for (const GHMM::Traceback *tb = parse->psi(tails[t], 0).ptr(); tb != NULL; tb = tb->prev.ptr()) {
+      std::string name = ModelFile::baseName(model->stateName(tb->state));
+      if (segments.size() && segments.back().first == name) {
+        segments.back().second += tb->length;
+      } else {
+        segments.push_back(std::make_pair(name, (int)tb->length));
+      }
+    }
+  }
+};
+
+struct AlphaStats {
+  uint64_t compared, finite_mismatches;
+  double max_diff, sum_diff;
+  std::string worst;
+
+  AlphaStats() : compared(0), finite_mismatches(0), max_diff(0.0), sum_diff(0.0), worst() {
+  }
+
+  void add(double ref, double cand, const std::string &name) {
+    bool ref_finite = ref != MATH::LOG_ZERO, cand_finite = cand != MATH::LOG_ZERO;
+    if (ref_finite != cand_finite) {
+      finite_mismatches++;
+      return;
+    }
+    if (!ref_finite) return;
+    double d = fabs(ref - cand);
+    sum_diff += d;
+    if (!compared++ || d > max_diff) {
+      max_diff = d;
+      worst = name;
+    }
+  }
+};
+
+struct CallStats {
+  uint64_t both, reference_only, candidate_only;
+
+  CallStats() : both(0), reference_only(0), candidate_only(0) {
+  }
+
+  void add(bool ref, bool cand) {
+    if (ref && cand) both++;
+    else if (ref) reference_only++;
+    else if (cand) candidate_only++;
+  }
+};
+
+static void writeString(FILE *fp, const std::string &s) {
+  fputc('"', fp);
+  for (size_t i = 0; i < s.size(); i++) {
+    unsigned char c = s[i];
+    if (c == '"' || c == '\\') {
+      fprintf(fp, "\\%c", c);
+    } else if (c < 0x20) {
+      fprintf(fp, "\\u%04x", c);
+    } else {
+      fputc(c, fp);
+    }
+  }
+  fputc('"', fp);
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> inputs;
+  std::string output = "-";
+  PEXELModelOptions ref_opts, cand_opts;
+  bool cand_given = false;
+  int column_threads = 1;
+  int digits = 0;
+  double RLE_threshold = 4.3;
+  double KLD_threshold = 0.0;
+  double tolerance = -1.0;
+
+  int ch;
+
+  while ((ch = getopt_long(argc, argv, "i:o:m:c:C:d:R:K:e:h", options, NULL)) != -1) {
+    switch (ch) {
+    case 'i': {
+      inputs.push_back(optarg);
+      break;
+    }
+    case 'o': {
+      output = optarg;
+      break;
+    }
+    case 'm':
+    case 'c': {
+      PEXELModelOptions &opts(ch == 'm' ? ref_opts : cand_opts);
+      if (!opts.parse(optarg)) {
+        std::cerr << "bad model spec: " << optarg << std::endl;
+        exit(1);
+      }
+      if (ch == 'c') cand_given = true;
+      break;
+    }
+    case 'C': {
+      column_threads = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'd': {
+      digits = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'R': {
+      RLE_threshold = strtod(optarg, NULL);
+      break;
+    }
+    case 'K': {
+      KLD_threshold = strtod(optarg, NULL);
+      break;
+    }
+    case 'e': {
+      tolerance = strtod(optarg, NULL);
+      break;
+    }
+    case 'h':
+    case '?': {
+      usage(argv[0]);
+      exit(0);
+    }
+    }
+  }
+
+  if (!inputs.size()) {
+    usage(argv[0]);
+    exit(1);
+  }
+  if (!cand_given) cand_opts = ref_opts;
+
+  FILE *out = stdout;
+  if (output != "-") {
+    out = fopen(output.c_str(), "w");
+    if (out == NULL) {
+      std::cerr << "could not open " << output << std::endl;
+      exit(1);
+    }
+  }
+
+  GHMM::Model::Ptr cand_model = makePEXELmodel(cand_opts);
+  if (digits) cand_model = roundModel(cand_model, digits);
+  GHMM::Model::Ptr ref_model = makePEXELmodel(ref_opts);
+  if (cand_model->alphabet() == NULL || ref_model->alphabet() == NULL || *cand_model->alphabet() != *ref_model->alphabet()) {
+    std::cerr << "the reference and candidate models have different alphabets" << std::endl;
+    exit(1);
+  }
+  Engine ref(ref_model, 1);
+  Engine cand(cand_model, column_threads);
+
+  AlphaStats alpha[N_TAILS];
+  CallStats rle, kld;
+  uint64_t paths_compared[N_TAILS] = { 0, 0, 0 }, paths_identical[N_TAILS] = { 0, 0, 0 };
+  uint64_t sequences = 0, residues = 0;
+  std::vector<unsigned char> codes;
+  std::vector<std::pair<std::string, int> > ref_path, cand_path;
+
+  for (size_t f = 0; f < inputs.size(); f++) {
+    FastaReader reader;
+    FastaRecord rec;
+    reader.setAlphabet(*cand_model->alphabet());
+    if (!reader.open(inputs[f].c_str())) {
+      std::cerr << "could not open " << inputs[f] << ": " << reader.error() << std::endl;
+      exit(1);
+    }
+    while (reader.next(rec)) {
+      codes.resize(rec.seq_len);
+      codes.resize(reader.encode(rec.seq, rec.seq_len, codes.size() ? &codes[0] : NULL));
+      if (codes.empty()) continue;
+      std::string name = rec.nameString();
+      name = name.substr(0, name.find_first_of(" \t\r"));
+
+      ref.score(codes);
+      cand.score(codes);
+      sequences++;
+      residues += codes.size();
+
+      for (int t = 0; t < N_TAILS; t++) {
+        alpha[t].add(ref.alpha(t), cand.alpha(t), name);
+        if (ref.alpha(t) == MATH::LOG_ZERO) continue;
+        ref.path(t, ref_path);
+        cand.path(t, cand_path);
+        paths_compared[t]++;
+        if (ref_path == cand_path) paths_identical[t]++;
+      }
+      rle.add(ref.alpha(A_TAIL) - ref.alpha(C_TAIL) > RLE_threshold, cand.alpha(A_TAIL) - cand.alpha(C_TAIL) > RLE_threshold);
+      kld.add(ref.alpha(B_TAIL) - ref.alpha(C_TAIL) > KLD_threshold, cand.alpha(B_TAIL) - cand.alpha(C_TAIL) > KLD_threshold);
+    }
+    if (reader.failed()) {
+      std::cerr << "error reading " << inputs[f] << ": " << reader.error() << std::endl;
+      exit(1);
+    }
+  }
+
+  bool ok = rle.reference_only + rle.candidate_only + kld.reference_only + kld.candidate_only == 0;
+  for (int t = 0; t < N_TAILS; t++) {
+    ok = ok && alpha[t].max_diff <= tolerance && !alpha[t].finite_mismatches && paths_identical[t] == paths_compared[t];
+  }
+
+  fprintf(out, "{\n  \"reference\": { \"model\": \"%s\", \"column_threads\": 1, \"seconds\": %.6f },\n",
+          ref_opts.name().c_str(), ref.seconds);
+  fprintf(out, "  \"candidate\": { \"model\": \"%s\", \"column_threads\": %d, \"round_digits\": %d, \"seconds\": %.6f },\n",
+          cand_opts.name().c_str(), column_threads, digits, cand.seconds);
+  fprintf(out, "  \"sequences\": %llu,\n  \"residues\": %llu,\n  \"speedup\": %.3f,\n",
+          (unsigned long long)sequences, (unsigned long long)residues, cand.seconds > 0 ? ref.seconds / cand.seconds : 0.0);
+
+  fprintf(out, "  \"alpha\": [\n");
+  for (int t = 0; t < N_TAILS; t++) {
+    const AlphaStats &a(alpha[t]);
+    fprintf(out, "    { \"state\": \"%s\", \"compared\": %llu, \"finite_mismatches\": %llu, \"max_abs_diff\": %.6g, \"mean_abs_diff\": %.6g, \"worst\": ",
+            TAILS[t], (unsigned long long)a.compared, (unsigned long long)a.finite_mismatches, a.max_diff, a.compared ? a.sum_diff / a.compared : 0.0);
+    if (a.max_diff > 0) {
+      writeString(out, a.worst);
+    } else {
+      fprintf(out, "null");
+    }
+    fprintf(out, " }%s\n", t < N_TAILS - 1 ? "," : "");
+  }
+  fprintf(out, "  ],\n");
+
+  fprintf(out, "  \"calls\": [\n");
+  fprintf(out, "    { \"class\": \"RLE\", \"threshold\": %g, \"both\": %llu, \"reference_only\": %llu, \"candidate_only\": %llu },\n",
+          RLE_threshold, (unsigned long long)rle.both, (unsigned long long)rle.reference_only, (unsigned long long)rle.candidate_only);
+  fprintf(out, "    { \"class\": \"KLD\", \"threshold\": %g, \"both\": %llu, \"reference_only\": %llu, \"candidate_only\": %llu }\n",
+          KLD_threshold, (unsigned long long)kld.both, (unsigned long long)kld.reference_only, (unsigned long long)kld.candidate_only);
+  fprintf(out, "  ],\n");
+
+  fprintf(out, "  \"viterbi\": [\n");
+  for (int t = 0; t < N_TAILS; t++) {
+    fprintf(out, "    { \"state\": \"%s\", \"compared\": %llu, \"identical\": %llu }%s\n", TAILS[t],
+            (unsigned long long)paths_compared[t], (unsigned long long)paths_identical[t], t < N_TAILS - 1 ? "," : "");
+  }
+  fprintf(out, "  ]");
+  if (tolerance >= 0) fprintf(out, ",\n  \"within_tolerance\": %s", ok ? "true" : "false");
+  fprintf(out, "\n}\n");
+
+  if (out != stdout) fclose(out);
+  return tolerance >= 0 && !ok ? 1 : 0;
+}
@@ -0,0 +1,136 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include "fasta_index.hh"
+#include "fasta_reader.hh"
+
+#include <fstream>
+#include <ctype.h>
+#include <stdlib.h>
+#include <sys/stat.h>
+
+void FastaIndex::build(FastaReader &reader) {
+  FastaRecord rec;
+
+  entries.clear();
+  while (reader.next(rec)) {
+    FastaIndexEntry e;
+    size_t n = 0;
+    while (n < rec.name_len && !isspace(rec.name[n])) n++;
+    e.name.assign(rec.name, n);
+    e.offset = rec.offset + (rec.seq - rec.name) + 1;
+
+    e.length = 0;
+    e.line_bases = 0;
+    e.line_width = rec.seq_len;
+    for (size_t i = 0; i < rec.seq_len; i++) {
+      if (rec.seq[i] == '\n') {
+        if (e.line_width == rec.seq_len) {
+          e.line_width = i + 1;
+          e.line_bases = e.length;
+        }
+      } else if (!isspace(rec.seq[i])) {
+        e.length++;
+      }
+    }
+    if (e.line_width == rec.seq_len) e.line_bases = e.length;
+
+    entries.push_back(e);
+  }
+}
+
+bool FastaIndex::read(const std::string &path) {
+  std::ifstream in(path.c_str());
+  std::string line;
+
+  if (!in) return false;
+  entries.clear();
+  while (std::getline(in, line)) {
+    FastaIndexEntry e;
+    size_t tab = line.find('\t');
+    if (tab == std::string::npos) return false;
+    e.name = line.substr(0, tab);
+
+    const char *p = line.c_str() + tab + 1;
+    char *q;
+    e.length     = strtoul(p, &q, 10); if (*q++ != '\t') return false; p = q;
+    e.offset     = strtoll(p, &q, 10); if (*q++ != '\t') return false; p = q;
+    e.line_bases = strtoul(p, &q, 10); if (*q++ != '\t') return false; p = q;
+    e.line_width = strtoul(p, &q, 10);
+
+    entries.push_back(e);
+  }
+  return true;
+}
+
+bool FastaIndex::write(const std::string &path) const {
+  std::ofstream out(path.c_str());
+
+  if (!out) return false;
+  for (size_t i = 0; i < entries.size(); i++) {
+    const FastaIndexEntry &e(entries[i]);
+    out << e.name << '\t'
+        << e.length << '\t'
+        << (long long)e.offset << '\t'
+        << e.line_bases << '\t'
+        << e.line_width << '\n';
+  }
+  return (bool)out;
+}
+
+void FastaIndex::load(const std::string &fasta, FastaReader &reader) {
+  std::string fai = indexPath(fasta);
+  struct stat fa_st, fai_st;
+
+  if (stat(fasta.c_str(), &fa_st) == 0 && stat(fai.c_str(), &fai_st) == 0 &&
+      fai_st.st_mtime >= fa_st.st_mtime && read(fai)) {
+    // an index that does not fit the file is rebuilt.
+    bool ok = true;
+    for (size_t i = 0; ok && i < entries.size(); i++) {
+      ok = entries[i].offset <= fa_st.st_size && reader.recordStart(entries[i].offset) != -1;
+    }
+    if (ok) return;
+  }
+
+  build(reader);
+  write(fai);
+}
+
+void FastaIndex::shard(int i, int n, size_t &first, size_t &last) const {
+  unsigned long long total = 0, cum = 0;
+  for (size_t r = 0; r < entries.size(); r++) total += entries[r].length;
+
+  // record r goes to shard floor(residues before r * n / total).
+  first = last = entries.size();
+  for (size_t r = 0; r < entries.size(); r++) {
+    int s = total ? (int)(cum * n / total) : 0;
+    if (s >= i && first == entries.size()) first = r;
+    if (s >= i + 1) {
+      last = r;
+      break;
+    }
+    cum += entries[r].length;
+  }
+  if (first > last) first = last;
+}
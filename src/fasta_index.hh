@@ -0,0 +1,48 @@
+#ifndef FASTA_INDEX_HH_INCLUDED
+#define FASTA_INDEX_HH_INCLUDED
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+class FastaReader;
+
+// One line of a samtools style .fai index: the first word of the
+// header, the number of residues, the byte offset of the first
+// residue, and the residues and bytes per line of the first sequence
+// line.
+struct FastaIndexEntry {
+  std::string name;
+  size_t length;
+  off_t offset;
+  size_t line_bases;
+  size_t line_width;
+};
+
+class FastaIndex {
+public:
+  std::vector<FastaIndexEntry> entries;
+
+  FastaIndex() : entries() {
+  }
+
+  static std::string indexPath(const std::string &fasta) {
+    return fasta + ".fai";
+  }
+
+  // index every record the reader returns.
+  void build(FastaReader &reader);
+
+  bool read(const std::string &path);
+  bool write(const std::string &path) const;
+
+  // load fasta's index if it exists and is no older than fasta,
+  // otherwise build it from reader and try to save it.
+  void load(const std::string &fasta, FastaReader &reader);
+
+  // split the records into n contiguous shards with about the same
+  // number of residues, and return shard i as the range [first, last).
+  void shard(int i, int n, size_t &first, size_t &last) const;
+};
+
+#endif
@@ -0,0 +1,256 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include "fasta_reader.hh"
+#include "input_source.hh"
+
+#include <GHMM/ghmm.hh>
+
+#include <string.h>
+#include <errno.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if HAVE_MMAP && HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#define USE_MMAP 1
+#endif
+
+#define READ_BLOCK_SIZE (4 * 1024 * 1024)
+
+FastaReader::FastaReader() : fd(-1), close_fd(false), threads(1), source(NULL), err(), map_base(NULL), map_len(0), buf(), data(NULL), pos(0), end(0), data_offset(0), at_eof(true), encoding(&residueAlphabet()) {
+}
+
+FastaReader::~FastaReader() {
+  close();
+}
+
+void FastaReader::reset() {
+  data = NULL;
+  pos = end = 0;
+  data_offset = 0;
+  at_eof = true;
+}
+
+bool FastaReader::open(const char *path) {
+  if (!strcmp(path, "-")) return open(0, false);
+  int f = ::open(path, O_RDONLY);
+  if (f == -1) {
+    err = strerror(errno);
+    return false;
+  }
+  return open(f, true);
+}
+
+bool FastaReader::open(int f, bool c) {
+  close();
+  err.clear();
+  fd = f;
+  close_fd = c;
+  reset();
+  at_eof = false;
+
+#ifdef USE_MMAP
+  struct stat st;
+  char magic[2];
+  if (fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && st.st_size > 0 &&
+      !(pread(fd, magic, 2, 0) == 2 && isGzipMagic(magic, 2))) {
+    void *m = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m != MAP_FAILED) {
+      map_base = (char *)m;
+      map_len = st.st_size;
+      madvise(map_base, map_len, MADV_SEQUENTIAL);
+      data = map_base;
+      end = map_len;
+      at_eof = true;
+      return true;
+    }
+  }
+#endif
+
+  source = openInputSource(fd, threads, err);
+  if (source == NULL) {
+    close();
+    return false;
+  }
+  return true;
+}
+
+void FastaReader::close() {
+#ifdef USE_MMAP
+  if (map_base) munmap(map_base, map_len);
+#endif
+  map_base = NULL;
+  map_len = 0;
+  delete source;
+  source = NULL;
+  if (fd != -1 && close_fd) ::close(fd);
+  fd = -1;
+  std::vector<char>().swap(buf);
+  reset();
+}
+
+// read another block, keeping the unconsumed tail of the buffer.
+bool FastaReader::fill() {
+  if (at_eof) return false;
+
+  size_t keep = end - pos;
+  if (pos) {
+    memmove(&buf[0], &buf[pos], keep);
+    data_offset += pos;
+    pos = 0;
+    end = keep;
+  }
+  if (buf.size() < keep + READ_BLOCK_SIZE) {
+    buf.resize(keep + READ_BLOCK_SIZE);
+  }
+
+  ssize_t r = source->read(&buf[end], buf.size() - end);
+  if (r < 0) err = source->error();
+
+  if (r <= 0) {
+    at_eof = true;
+    data = buf.size() ? &buf[0] : NULL;
+    return false;
+  }
+  end += r;
+  data = &buf[0];
+  return true;
+}
+
+bool FastaReader::next(FastaRecord &rec) {
+  while (1) {
+    // find the start of a record.
+    const char *gt = data ? (const char *)memchr(data + pos, '>', end - pos) : NULL;
+    if (gt == NULL) {
+      pos = end;
+      if (!fill()) return false;
+      continue;
+    }
+    pos = gt - data;
+
+    // find the end of the header line.
+    const char *nl = (const char *)memchr(data + pos, '\n', end - pos);
+    if (nl == NULL && !at_eof) {
+      fill();
+      continue;
+    }
+    size_t name_end = nl ? nl - data : end;
+    size_t seq_start = nl ? name_end + 1 : end;
+
+    // the record ends at the next '>' that starts a line.
+    size_t scan = seq_start;
+    size_t rec_end = end;
+    bool found = false;
+    while (scan < end) {
+      const char *n = (const char *)memchr(data + scan, '>', end - scan);
+      if (n == NULL) break;
+      if (n[-1] == '\n') {
+        rec_end = n - data;
+        found = true;
+        break;
+      }
+      scan = n - data + 1;
+    }
+    if (!found && !at_eof) {
+      fill();
+      continue;
+    }
+
+    rec.name = data + pos + 1;
+    rec.name_len = name_end - pos - 1;
+    rec.seq = data + seq_start;
+    rec.seq_len = rec_end - seq_start;
+    rec.offset = data_offset + pos;
+    pos = rec_end;
+
+    // records without residues are skipped, as they always were.
+    for (size_t i = 0; i < rec.seq_len; i++) {
+      if (!isspace(rec.seq[i])) return true;
+    }
+  }
+}
+
+bool FastaReader::setRange(off_t begin, off_t e) {
+  if (!map_base || begin < 0 || begin > e || e > (off_t)map_len) return false;
+  data = map_base;
+  pos = begin;
+  end = e;
+  data_offset = 0;
+  at_eof = true;
+  return true;
+}
+
+off_t FastaReader::recordStart(off_t seq_offset) const {
+  if (!map_base || seq_offset <= 0 || seq_offset > (off_t)map_len) return -1;
+  if (map_base[seq_offset - 1] != '\n') return -1;
+
+  // header lines hold no newlines, so the first '>' at the start of a
+  // line going backwards is the one we want.
+  for (off_t i = seq_offset - 1; i >= 0; i--) {
+    if (map_base[i] == '>' && (i == 0 || map_base[i - 1] == '\n')) return i;
+  }
+  return -1;
+}
+
+namespace {
+  struct ResidueAlphabet : public GHMM::UTIL::Alphabet {
+    ResidueAlphabet() {
+      addCharTokenRange('A', 'Z');
+      setUnknown('X' - 'A');
+    }
+  };
+
+  const ResidueAlphabet residue_alphabet;
+}
+
+const GHMM::UTIL::Alphabet &FastaReader::residueAlphabet() {
+  return residue_alphabet;
+}
+
+const unsigned char *FastaReader::residueCodes() {
+  return residue_alphabet.codes();
+}
+
+size_t FastaReader::encode(const char *raw, size_t len, unsigned char *codes) const {
+  return encoding->encode(raw, len, codes);
+}
+
+size_t FastaReader::strip(const char *raw, size_t len, char *out) {
+  const unsigned char *lut = residueCodes();
+  size_t n = 0;
+  for (size_t i = 0; i < len; i++) {
+    out[n] = raw[i];
+    n += (lut[(unsigned char)raw[i]] != SKIP);
+  }
+  return n;
+}
+
+void FastaReader::decode(const unsigned char *codes, size_t len, char *out) {
+  for (size_t i = 0; i < len; i++) {
+    out[i] = 'A' + codes[i];
+  }
+}
@@ -0,0 +1,128 @@
+#ifndef FASTA_READER_HH_INCLUDED
+#define FASTA_READER_HH_INCLUDED
+
+#include <string>
+#include <vector>
+#include <sys/types.h>
+
+class InputSource;
+
+namespace GHMM {
+  namespace UTIL {
+    class Alphabet;
+  }
+}
+
+// A FASTA record as a view into the reader's buffer. name runs up to
+// (not including) the end of the header line; seq is the raw
+// sequence text, newlines and all.
+struct FastaRecord {
+  const char *name;
+  size_t name_len;
+  const char *seq;
+  size_t seq_len;
+  off_t offset;
+
+  std::string nameString() const {
+    return std::string(name, name_len);
+  }
+};
+
+// Reads FASTA records without copying them. Regular files are
+// mmap()ed, and record views stay valid until the reader is closed.
+// Anything else (pipes, terminals, gzip and BGZF compressed input) is
+// read in large blocks, and views are only valid until the next call
+// to next().
+class FastaReader {
+  FastaReader(const FastaReader &);
+  FastaReader &operator=(const FastaReader &);
+
+protected:
+  int fd;
+  bool close_fd;
+  int threads;
+  InputSource *source;
+  std::string err;
+  char *map_base;
+  size_t map_len;
+
+  std::vector<char> buf;
+  const char *data;
+  size_t pos, end;
+  off_t data_offset;
+  bool at_eof;
+  const GHMM::UTIL::Alphabet *encoding;
+
+  bool fill();
+  void reset();
+
+public:
+  FastaReader();
+  ~FastaReader();
+
+  // open a file by name; "-" means stdin.
+  bool open(const char *path);
+  bool open(int fd, bool close_fd);
+  void close();
+
+  bool next(FastaRecord &rec);
+
+  // for mmap()ed input only: restrict reading to the records starting
+  // in [begin, end), and find the start of the header of the record
+  // whose first residue is at seq_offset (-1 if there is none).
+  bool setRange(off_t begin, off_t end);
+  off_t recordStart(off_t seq_offset) const;
+  off_t size() const {
+    return map_len;
+  }
+
+  // number of threads used to inflate BGZF input opened after this
+  // call. 0 inflates in line, as for plain gzip.
+  void setThreads(int n) {
+    threads = n;
+  }
+
+  // true if reading stopped because of an error rather than the end
+  // of input.
+  bool failed() const {
+    return err.size() != 0;
+  }
+  const std::string &error() const {
+    return err;
+  }
+
+  // true if record views remain valid after the next call to next().
+  bool stable() const {
+    return map_base != NULL;
+  }
+
+  // residue codes, as used by the PEXEL models: A..Z -> 0..25 (case
+  // insensitive), whitespace is dropped, anything else maps to X.
+  // these are the codes of residueAlphabet().
+  static const unsigned char SKIP = 0xff;
+  static const GHMM::UTIL::Alphabet &residueAlphabet();
+  static const unsigned char *residueCodes();
+
+  // the alphabet encode() uses; residueAlphabet() unless set, usually
+  // to that of the model the sequences are for. a must outlive the
+  // reader.
+  void setAlphabet(const GHMM::UTIL::Alphabet &a) {
+    encoding = &a;
+  }
+  const GHMM::UTIL::Alphabet &alphabet() const {
+    return *encoding;
+  }
+
+  // strip whitespace from raw sequence text and encode it in one
+  // pass. codes must have room for len entries. returns the number
+  // of codes.
+  size_t encode(const char *raw, size_t len, unsigned char *codes) const;
+
+  // strip whitespace only, for output.
+  static size_t strip(const char *raw, size_t len, char *out);
+
+  // residue codes back to (upper case) text.
+  static void decode(const unsigned char *codes, size_t len, char *out);
+};
+
+#endif
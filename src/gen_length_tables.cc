@@ -0,0 +1,149 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+// Smooths the raw state length samples used by the exportpred models
+// and writes the normalized tables out as C++ source (length_tables.cc),
+// so that the smoothing is done once at build time rather than at
+// every startup.
+
+#include "predict_pexel.hh"
+
+#include <stdio.h>
+
+static int a_spacer_raw_distrib_v1[] = {
+  1, 2, 3, 6, 8, 8, 9, 10, 10, 11, 11, 12, 13, 13, 13, 13, 14, 14,
+  14, 14, 15, 15, 15, 16, 16, 17, 17, 17, 17, 17, 17, 18, 18, 18, 18,
+  18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19,
+  19, 19, 19, 19, 19, 19, 19, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20,
+  20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 21, 21, 21, 21, 21, 21, 21,
+  21, 22, 22, 22, 22, 22, 22, 22, 23, 23, 23, 23, 23, 23, 23, 24, 24,
+  24, 24, 24, 24, 24, 24, 24, 25, 25, 25, 25, 25, 25, 25, 25, 26, 26,
+  26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 27, 27,
+  27, 28, 29, 29, 29, 29, 29, 30, 31, 31, 31, 31, 31, 32, 32, 33, 35,
+  37, 41, 43, 48, 53, 61, 89, 110, 129, 166, 182, 202, 209, 324, 495
+};
+
+static int a_spacer_raw_distrib_v2[] = {
+  9, 12, 13, 13, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 15, 15, 16,
+  16, 16, 17, 17, 17, 17, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18,
+  18, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19,
+  19, 19, 19, 19, 19, 19, 19, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20,
+  20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 21,
+  21, 21, 21, 21, 21, 22, 22, 22, 23, 23, 23, 23, 23, 23, 23, 23, 23,
+  24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 25, 25, 25, 25, 25, 25,
+  25, 25, 25, 25, 25, 25, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
+  26, 26, 26, 26, 26, 26, 26, 26, 27, 27, 27, 29, 31, 31, 31, 31, 33,
+  33
+};
+
+static int b_leader_raw_distrib[] = {
+  9, 10, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 13, 13,
+  13, 13, 14, 14, 14, 14, 14, 14, 15, 15, 15, 16, 16, 16, 16, 16, 17,
+  17, 17, 17, 17, 17, 17, 17, 18, 19, 19, 19, 19, 19, 19, 20, 20, 20,
+  21, 21, 21, 22, 23, 24, 25
+};
+
+static int b_hydrophobic_raw_distrib[] = {
+  22, 22, 23, 23, 23, 23, 23, 23, 25, 25, 25, 25, 25, 25, 25, 25, 25,
+  25, 25, 25, 25, 25, 25, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 27,
+  27, 27, 27, 27, 28, 29, 29, 29, 29, 29, 29, 29, 32, 37
+};
+
+static int leader_raw_distrib_v1[] = {
+  1, 1, 1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 4,
+  4, 4, 4, 4, 4, 4, 4, 5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+  6, 6, 6, 6, 6, 6, 6, 7, 7, 7, 7, 7, 7, 8, 8, 8, 9, 9, 10, 10, 11,
+  11, 11, 12, 12, 12, 12, 13, 13, 14, 14, 15, 15, 15, 15, 16, 16, 16,
+  17, 17, 19, 19, 20, 20, 20, 20, 23, 24, 25, 27, 27, 27, 28, 28, 28,
+  29, 29, 29, 29, 29, 29, 29, 30, 30, 30, 30, 32, 33, 35, 37, 37, 38,
+  39, 42, 42, 43, 43, 43, 44, 44, 47, 47, 48, 48, 48, 49, 49, 49, 49,
+  49, 49, 50, 50, 50, 50, 51, 51, 51, 51, 51, 51, 52, 52, 52, 52, 52,
+  52, 52, 52, 52, 53, 53, 53, 53, 53, 55, 55, 56, 56, 59, 63, 78, 92,
+  118, 143
+};
+
+static int leader_raw_distrib_v2[] = {
+  1, 1, 1, 1, 1, 1, 1, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 2, 3, 3, 4, 4,
+  5, 5, 5, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6, 6,
+  6, 6, 7, 7, 7, 7, 7, 7, 7, 7, 8, 8, 9, 10, 10, 11, 11, 12, 12, 12,
+  12, 13, 13, 13, 13, 14, 15, 16, 16, 16, 17, 18, 19, 20, 20, 21, 23,
+  24, 25, 26, 26, 28, 28, 28, 28, 28, 28, 29, 29, 29, 29, 29, 30, 35,
+  37, 37, 39, 39, 40, 42, 43, 43, 43, 43, 44, 44, 45, 46, 47, 47, 48,
+  48, 48, 48, 49, 49, 49, 49, 49, 49, 49, 50, 50, 50, 50, 50, 50, 51,
+  51, 51, 51, 51, 51, 51, 51, 52, 52, 52, 52, 52, 52, 52, 53, 53, 54,
+  54, 54, 57, 58, 63
+};
+
+static int hydrophobic_raw_distrib[] = {
+  10, 10, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 11, 12, 12, 12,
+  12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 12, 13, 13, 13,
+  13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 13, 14, 14, 14,
+  14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14,
+  14, 14, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 15, 16, 16, 16, 16,
+  16, 16, 16, 16, 16, 16, 16, 16, 16, 16, 17, 17, 17, 17, 17, 17, 17,
+  17, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19,
+  19, 19, 19, 19, 19, 19, 19, 19, 19, 20, 20, 20, 20, 20, 20, 20, 20,
+  20, 20, 20, 20, 21, 22, 23, 23, 23, 23, 24, 24, 24, 24, 24, 24, 25,
+  25
+};
+
+static void printArray(const char *name, const double *v, int n) {
+  printf("static const double %s[] = {\n", name);
+  for (int i = 0; i < n; i++) {
+    if (v[i] == MATH::LOG_ZERO) {
+      printf("  -__builtin_inf(),\n");
+    } else {
+      printf("  %.17g,\n", v[i]);
+    }
+  }
+  printf("};\n\n");
+}
+
+template<typename InputIterator>
+static void genTable(const char *name, double sigma, InputIterator begin, InputIterator end, int distrib_min, int distrib_max) {
+  GHMM::LENGTH::Discrete l(MATH::smooth(MATH::GaussianKernel(sigma), begin, end, distrib_min, distrib_max));
+  int a = l.minLength(), b = l.maxLength();
+  std::vector<double> p, logp;
+
+  for (int i = a; i < b; i++) {
+    p.push_back(l.pLength(i));
+    logp.push_back(l.logpLength(i));
+  }
+
+  printArray((std::string(name) + "_p").c_str(), &p[0], b - a);
+  printArray((std::string(name) + "_logp").c_str(), &logp[0], b - a);
+  printf("const LengthTable %s = { %d, %d, %s_p, %s_logp };\n\n", name, a, b, name, name);
+}
+
+int main(int argc, char **argv) {
+  printf("// Generated by gen_length_tables; do not edit.\n\n");
+  printf("#include \"length_tables.hh\"\n\n");
+
+  genTable("a_spacer_lengths_v1",      1.0, a_spacer_raw_distrib_v1,   ENDOF(a_spacer_raw_distrib_v1),    1, 60);
+  genTable("a_spacer_lengths_v2",      1.0, a_spacer_raw_distrib_v2,   ENDOF(a_spacer_raw_distrib_v2),    1, 60);
+  genTable("b_leader_lengths",         1.0, b_leader_raw_distrib,      ENDOF(b_leader_raw_distrib),      -1, 30);
+  genTable("b_hydrophobic_lengths_v2", 1.0, b_hydrophobic_raw_distrib, ENDOF(b_hydrophobic_raw_distrib), 20, 35);
+  genTable("leader_lengths_v1",        2.0, leader_raw_distrib_v1,     ENDOF(leader_raw_distrib_v1),      1, 80);
+  genTable("leader_lengths_v2",        2.0, leader_raw_distrib_v2,     ENDOF(leader_raw_distrib_v2),      1, 80);
+  genTable("hydrophobic_lengths_v2",   1.0, hydrophobic_raw_distrib,   ENDOF(hydrophobic_raw_distrib),   10, 25);
+
+  return 0;
+}
@@ -0,0 +1,232 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include "hit_writer.hh"
+#include "run_stats.hh"
+
+#include <algorithm>
+#include <functional>
+#include <iostream>
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+// approximate per hit overhead beyond the line itself.
+#define HIT_OVERHEAD (sizeof(HitWriter::Hit) + 32)
+
+#define OUTPUT_BUFFER_SIZE (1024 * 1024)
+
+HitWriter::HitWriter(FILE *o, int n_buckets, Mode m, size_t n, size_t limit) : out(o), buf(OUTPUT_BUFFER_SIZE), mode(m), top_n(n), mem_limit(limit), mem_used(0), buckets(n_buckets), clock(NULL) {
+}
+
+HitWriter::~HitWriter() {
+  for (size_t b = 0; b < buckets.size(); b++) {
+    for (size_t r = 0; r < buckets[b].runs.size(); r++) fclose(buckets[b].runs[r]);
+  }
+}
+
+void HitWriter::emit(const char *line, size_t len) {
+  buf.append(line, len);
+  buf.append('\n');
+  if (buf.size() >= OUTPUT_BUFFER_SIZE) flush();
+}
+
+void HitWriter::add(int bucket, double score, const char *line, size_t len) {
+  Bucket &b(buckets[bucket]);
+
+  switch (mode) {
+  case UNSORTED: {
+    emit(line, len);
+    break;
+  }
+  case TOP: {
+    // min-heap on (score, line), so the order matches a full sort.
+    if (!top_n) break;
+    if (b.hits.size() == top_n) {
+      const Hit &worst(b.hits.front());
+      if (score < worst.first || (score == worst.first && worst.second.compare(0, std::string::npos, line, len) >= 0)) break;
+      std::pop_heap(b.hits.begin(), b.hits.end(), std::greater<Hit>());
+      b.hits.pop_back();
+    }
+    b.hits.push_back(Hit(score, std::string(line, len)));
+    std::push_heap(b.hits.begin(), b.hits.end(), std::greater<Hit>());
+    break;
+  }
+  case SORTED: {
+    mem_used += len + HIT_OVERHEAD;
+    b.hits.push_back(Hit(score, std::string(line, len)));
+    if (mem_limit && mem_used > mem_limit) spill();
+    break;
+  }
+  }
+}
+
+// runs are stored in descending order as (score, length, text)
+// records.
+void HitWriter::writeRun(FILE *fp, const std::vector<Hit> &hits) {
+  for (std::vector<Hit>::const_reverse_iterator i = hits.rbegin(); i != hits.rend(); ++i) {
+    unsigned len = (*i).second.size();
+    if (fwrite(&(*i).first, sizeof(double), 1, fp) != 1 ||
+        fwrite(&len, sizeof(len), 1, fp) != 1 ||
+        fwrite((*i).second.data(), 1, len, fp) != len) {
+      std::cerr << "could not write temporary file" << std::endl;
+      exit(1);
+    }
+  }
+  if (fflush(fp) || fseek(fp, 0, SEEK_SET)) {
+    std::cerr << "could not write temporary file" << std::endl;
+    exit(1);
+  }
+}
+
+static FILE *tempFile() {
+  const char *dir = getenv("TMPDIR");
+  std::string path = std::string(dir && *dir ? dir : "/tmp") + "/exportpred.XXXXXX";
+  std::vector<char> buf(path.begin(), path.end());
+  buf.push_back('\0');
+
+  int fd = mkstemp(&buf[0]);
+  if (fd == -1) {
+    std::cerr << "could not create temporary file in " << (dir && *dir ? dir : "/tmp") << std::endl;
+    exit(1);
+  }
+  unlink(&buf[0]);
+  FILE *fp = fdopen(fd, "w+b");
+  if (fp == NULL) {
+    std::cerr << "could not open temporary file: " << strerror(errno) << std::endl;
+    close(fd);
+    exit(1);
+  }
+  return fp;
+}
+
+void HitWriter::spill() {
+  for (size_t b = 0; b < buckets.size(); b++) {
+    Bucket &bucket(buckets[b]);
+    if (!bucket.hits.size()) continue;
+    std::sort(bucket.hits.begin(), bucket.hits.end());
+    FILE *fp = tempFile();
+    writeRun(fp, bucket.hits);
+    bucket.runs.push_back(fp);
+    std::vector<Hit>().swap(bucket.hits);
+  }
+  mem_used = 0;
+}
+
+namespace {
+  struct RunReader {
+    FILE *fp;
+    HitWriter::Hit head;
+    bool valid;
+
+    RunReader(FILE *f) : fp(f), head(), valid(false) {
+      next();
+    }
+
+    void next() {
+      unsigned len;
+      valid = false;
+      if (fread(&head.first, sizeof(double), 1, fp) != 1) return;
+      if (fread(&len, sizeof(len), 1, fp) != 1) return;
+      head.second.resize(len);
+      if (len && fread(&head.second[0], 1, len, fp) != len) return;
+      valid = true;
+    }
+  };
+
+  struct RunLess {
+    const std::vector<RunReader *> &runs;
+    RunLess(const std::vector<RunReader *> &r) : runs(r) {
+    }
+    bool operator()(int a, int b) const {
+      return runs[a]->head < runs[b]->head;
+    }
+  };
+}
+
+// k-way merge of the spilled runs and the in memory remainder, best
+// first.
+void HitWriter::mergeBucket(Bucket &b) {
+  std::sort(b.hits.begin(), b.hits.end());
+  if (b.hits.size()) {
+    FILE *fp = tempFile();
+    writeRun(fp, b.hits);
+    b.runs.push_back(fp);
+    std::vector<Hit>().swap(b.hits);
+  }
+
+  std::vector<RunReader *> runs;
+  std::vector<int> heap;
+  for (size_t r = 0; r < b.runs.size(); r++) {
+    runs.push_back(new RunReader(b.runs[r]));
+    if (runs.back()->valid) heap.push_back(r);
+  }
+
+  RunLess less(runs);
+  std::make_heap(heap.begin(), heap.end(), less);
+  while (heap.size()) {
+    std::pop_heap(heap.begin(), heap.end(), less);
+    RunReader *r = runs[heap.back()];
+    emit(r->head.second.data(), r->head.second.size());
+    r->next();
+    if (r->valid) {
+      std::push_heap(heap.begin(), heap.end(), less);
+    } else {
+      heap.pop_back();
+    }
+  }
+
+  for (size_t r = 0; r < runs.size(); r++) {
+    delete runs[r];
+    fclose(b.runs[r]);
+  }
+  b.runs.clear();
+}
+
+void HitWriter::flush() {
+  PhaseClock::Phase prev = clock ? clock->enter(PhaseClock::WRITE) : PhaseClock::IDLE;
+  if (!buf.write(out) || fflush(out)) {
+    std::cerr << "could not write output" << std::endl;
+    exit(1);
+  }
+  if (clock) clock->enter(prev);
+}
+
+void HitWriter::finish() {
+  for (size_t i = 0; i < buckets.size(); i++) {
+    Bucket &b(buckets[i]);
+    if (mode == UNSORTED) continue;
+    if (b.runs.size()) {
+      mergeBucket(b);
+      continue;
+    }
+    std::sort(b.hits.begin(), b.hits.end());
+    for (std::vector<Hit>::const_reverse_iterator h = b.hits.rbegin(); h != b.hits.rend(); ++h) {
+      emit((*h).second.data(), (*h).second.size());
+    }
+    std::vector<Hit>().swap(b.hits);
+  }
+  flush();
+}
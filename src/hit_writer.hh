@@ -0,0 +1,70 @@
+#ifndef HIT_WRITER_HH_INCLUDED
+#define HIT_WRITER_HH_INCLUDED
+
+#include <stdio.h>
+#include <string>
+#include <vector>
+#include <utility>
+
+#include "output_buffer.hh"
+
+class PhaseClock;
+
+// Collects formatted hits in a number of buckets (one per model
+// variant and motif class) and writes them out, bucket by bucket, in
+// descending score order. Output is gathered in a buffer and written
+// with large fwrite() calls.
+//
+//   SORTED    every hit, sorted. once the buffered hits exceed the
+//             memory limit each bucket is sorted and spilled to a
+//             temporary file as a run; runs are merged at the end.
+//   TOP       the best top_n hits of each bucket, kept in a heap.
+//   UNSORTED  hits in the order they are added, written whenever the
+//             buffer fills and at the end.
+class HitWriter {
+  HitWriter(const HitWriter &);
+  HitWriter &operator=(const HitWriter &);
+
+public:
+  enum Mode { SORTED, TOP, UNSORTED };
+
+  typedef std::pair<double, std::string> Hit;
+
+protected:
+  struct Bucket {
+    std::vector<Hit> hits;
+    std::vector<FILE *> runs;
+  };
+
+  FILE *out;
+  OutputBuffer buf;
+  Mode mode;
+  size_t top_n;
+  size_t mem_limit;
+  size_t mem_used;
+  std::vector<Bucket> buckets;
+  PhaseClock *clock;
+
+  void spill();
+  void writeRun(FILE *fp, const std::vector<Hit> &hits);
+  void mergeBucket(Bucket &b);
+  void emit(const char *line, size_t len);
+
+public:
+  HitWriter(FILE *o, int n_buckets, Mode m, size_t n = 0, size_t limit = 0);
+  ~HitWriter();
+
+  void add(int bucket, double score, const char *line, size_t len);
+
+  // charge writing the output to the WRITE phase of c.
+  void setClock(PhaseClock *c) {
+    clock = c;
+  }
+
+  // write out what has been emitted so far.
+  void flush();
+
+  void finish();
+};
+
+#endif
@@ -0,0 +1,366 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include "input_source.hh"
+#include "pipeline.hh"
+
+#include <errno.h>
+#include <string.h>
+#include <unistd.h>
+
+#if HAVE_LIBZ && HAVE_ZLIB_H
+#include <zlib.h>
+#define USE_ZLIB 1
+#endif
+
+#define GZIP_BUFFER_SIZE (256 * 1024)
+// the most a BGZF block may inflate to.
+#define BGZF_MAX_BLOCK 65536
+
+static ssize_t readFd(int fd, char *buf, size_t n) {
+  ssize_t r;
+  do {
+    r = ::read(fd, buf, n);
+  } while (r == -1 && errno == EINTR);
+  return r;
+}
+
+const std::vector<char> &FdSource::peek(size_t n) {
+  while (peeked.size() - peek_pos < n) {
+    size_t have = peeked.size();
+    peeked.resize(peek_pos + n);
+    ssize_t r = readFd(fd, &peeked[have], peeked.size() - have);
+    peeked.resize(have + (r > 0 ? r : 0));
+    if (r <= 0) break;
+  }
+  return peeked;
+}
+
+ssize_t FdSource::read(char *buf, size_t n) {
+  if (peek_pos < peeked.size()) {
+    size_t c = std::min(n, peeked.size() - peek_pos);
+    memcpy(buf, &peeked[peek_pos], c);
+    peek_pos += c;
+    if (peek_pos == peeked.size()) {
+      std::vector<char>().swap(peeked);
+      peek_pos = 0;
+    }
+    return c;
+  }
+  ssize_t r = readFd(fd, buf, n);
+  if (r == -1) err = strerror(errno);
+  return r;
+}
+
+bool isGzipMagic(const char *p, size_t n) {
+  return n >= 2 && (unsigned char)p[0] == 0x1f && (unsigned char)p[1] == 0x8b;
+}
+
+#ifdef USE_ZLIB
+
+// BGZF is gzip with a "BC" extra subfield holding the block size.
+static bool isBGZF(const std::vector<char> &h) {
+  const unsigned char *p = (const unsigned char *)&h[0];
+  return h.size() >= 18 && isGzipMagic(&h[0], h.size()) &&
+    (p[3] & 4) && p[12] == 'B' && p[13] == 'C' && p[14] == 2 && p[15] == 0;
+}
+
+// A single or multi member gzip stream, inflated in line.
+class GzipSource : public InputSource {
+  FdSource *in;
+  z_stream zs;
+  std::vector<char> ibuf;
+  bool at_end;
+
+public:
+  GzipSource(FdSource *i) : InputSource(), in(i), zs(), ibuf(GZIP_BUFFER_SIZE), at_end(false) {
+    inflateInit2(&zs, 15 + 16);
+  }
+  virtual ~GzipSource() {
+    inflateEnd(&zs);
+    delete in;
+  }
+
+  virtual ssize_t read(char *buf, size_t n) {
+    zs.next_out = (Bytef *)buf;
+    zs.avail_out = n;
+    while (zs.avail_out && !at_end) {
+      if (!zs.avail_in) {
+        ssize_t r = in->read(&ibuf[0], ibuf.size());
+        if (r < 0) {
+          err = in->error();
+          return -1;
+        }
+        if (r == 0) {
+          // a truncated member is an error; a clean end is not.
+          if (zs.total_in) {
+            err = "unexpected end of compressed data";
+            return -1;
+          }
+          at_end = true;
+          break;
+        }
+        zs.next_in = (Bytef *)&ibuf[0];
+        zs.avail_in = r;
+      }
+      int z = inflate(&zs, Z_NO_FLUSH);
+      if (z == Z_STREAM_END) {
+        // concatenated members are read as one stream.
+        inflateReset(&zs);
+        zs.total_in = 0;
+      } else if (z != Z_OK && z != Z_BUF_ERROR) {
+        err = zs.msg ? zs.msg : "corrupt compressed data";
+        return -1;
+      }
+    }
+    return n - zs.avail_out;
+  }
+};
+
+// BGZF blocks are independent, so they are inflated by a pool of
+// workers while the caller consumes the output in file order.
+class BgzfSource : public InputSource {
+  struct Block {
+    std::vector<char> in, out;
+    size_t out_pos;
+    bool done, ok;
+  };
+
+  class Worker {
+    BgzfSource &src;
+    z_stream zs;
+
+  public:
+    Worker(BgzfSource &s) : src(s), zs() {
+      inflateInit2(&zs, -15);
+    }
+    ~Worker() {
+      inflateEnd(&zs);
+    }
+
+    void run() {
+      Block *b;
+      while (src.work.pop(b)) {
+        inflateBlock(b);
+        Lock l(src.mutex);
+        b->done = true;
+        src.block_done.broadcast();
+      }
+    }
+
+    void inflateBlock(Block *b) {
+      const unsigned char *p = (const unsigned char *)&b->in[0];
+      size_t len = b->in.size();
+      size_t xlen = p[10] | (p[11] << 8);
+      size_t hlen = 12 + xlen;
+      uLong crc = p[len - 8] | (p[len - 7] << 8) | (p[len - 6] << 16) | ((uLong)p[len - 5] << 24);
+      size_t isize = p[len - 4] | (p[len - 3] << 8) | (p[len - 2] << 16) | ((size_t)p[len - 1] << 24);
+
+      b->ok = false;
+      if (hlen + 8 > len || isize > BGZF_MAX_BLOCK) return;
+
+      // zlib wants somewhere to write, even for the empty EOF block.
+      b->out.resize(isize + 1);
+      inflateReset(&zs);
+      zs.next_in = (Bytef *)&b->in[hlen];
+      zs.avail_in = len - hlen - 8;
+      zs.next_out = (Bytef *)&b->out[0];
+      zs.avail_out = isize + 1;
+      if (inflate(&zs, Z_FINISH) != Z_STREAM_END || zs.avail_out != 1) return;
+      if (crc32(crc32(0L, Z_NULL, 0), (Bytef *)&b->out[0], isize) != crc) return;
+      b->out.resize(isize);
+      b->ok = true;
+    }
+  };
+
+  FdSource *in;
+  BoundedQueue<Block *> work;
+  std::vector<Worker *> workers;
+  std::vector<Thread<Worker> *> threads;
+  std::deque<Block *> pending;
+  size_t depth;
+  bool in_eof;
+  Mutex mutex;
+  Condition block_done;
+
+  // read the next whole block. returns false at end of input.
+  bool readBlock(Block *b) {
+    char h[18];
+    ssize_t r = readAll(h, 18);
+    if (r <= 0) return false;
+    const unsigned char *p = (const unsigned char *)h;
+    if (r != 18 || !isGzipMagic(h, 18) || !(p[3] & 4)) {
+      err = "not a BGZF block";
+      return false;
+    }
+    size_t xlen = p[10] | (p[11] << 8);
+    size_t bsize = 0;
+    b->in.assign(h, h + 18);
+    b->in.resize(12 + xlen);
+    if (xlen > 6 && !readRest(&b->in[18], xlen - 6)) return false;
+    for (size_t x = 12; x + 4 <= 12 + xlen;) {
+      const unsigned char *f = (const unsigned char *)&b->in[x];
+      size_t slen = f[2] | (f[3] << 8);
+      if (f[0] == 'B' && f[1] == 'C' && slen == 2) bsize = (f[4] | (f[5] << 8)) + 1;
+      x += 4 + slen;
+    }
+    if (bsize < 12 + xlen + 8) {
+      err = "not a BGZF block";
+      return false;
+    }
+    size_t have = b->in.size();
+    b->in.resize(bsize);
+    if (!readRest(&b->in[have], bsize - have)) return false;
+
+    // the trailer's input size decides what the workers allocate.
+    p = (const unsigned char *)&b->in[bsize - 4];
+    size_t isize = p[0] | (p[1] << 8) | (p[2] << 16) | ((size_t)p[3] << 24);
+    if (isize > BGZF_MAX_BLOCK) {
+      err = "BGZF block inflates to more than 64 KiB";
+      return false;
+    }
+    return true;
+  }
+
+  // read the n bytes the block still needs.
+  bool readRest(char *buf, size_t n) {
+    ssize_t r = readAll(buf, n);
+    if (r == (ssize_t)n) return true;
+    // readAll() has set err on a read error.
+    if (r >= 0) err = "unexpected end of compressed data";
+    return false;
+  }
+
+  ssize_t readAll(char *buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+      ssize_t r = in->read(buf + got, n - got);
+      if (r < 0) {
+        err = in->error();
+        return -1;
+      }
+      if (r == 0) break;
+      got += r;
+    }
+    return got;
+  }
+
+  void readAhead() {
+    while (!in_eof && pending.size() < depth) {
+      Block *b = new Block;
+      b->out_pos = 0;
+      b->done = b->ok = false;
+      if (!readBlock(b)) {
+        delete b;
+        in_eof = true;
+        break;
+      }
+      pending.push_back(b);
+      work.push(b);
+    }
+  }
+
+public:
+  BgzfSource(FdSource *i, int n_threads) : InputSource(), in(i), work(4 * n_threads + 4), workers(), threads(), pending(), depth(4 * n_threads + 4), in_eof(false), mutex(), block_done() {
+    for (int t = 0; t < n_threads; t++) {
+      Worker *worker = new Worker(*this);
+      Thread<Worker> *thread = new Thread<Worker>;
+      if (!thread->start(worker)) {
+        delete thread;
+        delete worker;
+        break;
+      }
+      workers.push_back(worker);
+      threads.push_back(thread);
+    }
+  }
+  // false if no thread could be started to inflate blocks, so reads
+  // would wait forever.
+  bool running() const {
+    return threads.size() > 0;
+  }
+
+  virtual ~BgzfSource() {
+    work.close();
+    for (size_t t = 0; t < threads.size(); t++) {
+      threads[t]->join();
+      delete threads[t];
+      delete workers[t];
+    }
+    for (size_t b = 0; b < pending.size(); b++) delete pending[b];
+    delete in;
+  }
+
+  virtual ssize_t read(char *buf, size_t n) {
+    size_t got = 0;
+    while (got < n) {
+      readAhead();
+      if (!pending.size()) break;
+
+      Block *b = pending.front();
+      {
+        Lock l(mutex);
+        while (!b->done) block_done.wait(mutex);
+      }
+      if (!b->ok) {
+        err = "corrupt BGZF block";
+        return -1;
+      }
+      size_t c = std::min(n - got, b->out.size() - b->out_pos);
+      if (c) memcpy(buf + got, &b->out[b->out_pos], c);
+      b->out_pos += c;
+      got += c;
+      if (b->out_pos == b->out.size()) {
+        pending.pop_front();
+        delete b;
+      }
+    }
+    if (!got && err.size()) return -1;
+    return got;
+  }
+};
+
+#endif
+
+InputSource *openInputSource(int fd, int threads, std::string &error) {
+  FdSource *fs = new FdSource(fd);
+  const std::vector<char> &head = fs->peek(18);
+
+  if (!isGzipMagic(head.size() ? &head[0] : NULL, head.size())) return fs;
+
+#ifdef USE_ZLIB
+  if (isBGZF(head) && threads > 0) {
+    BgzfSource *bgzf = new BgzfSource(fs, threads);
+    if (bgzf->running()) return bgzf;
+    delete bgzf;
+    error = "could not start a thread to decompress BGZF input";
+    return NULL;
+  }
+  return new GzipSource(fs);
+#else
+  delete fs;
+  error = "compressed input is not supported (built without zlib)";
+  return NULL;
+#endif
+}
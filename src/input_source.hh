@@ -0,0 +1,58 @@
+#ifndef INPUT_SOURCE_HH_INCLUDED
+#define INPUT_SOURCE_HH_INCLUDED
+
+#include <string>
+#include <vector>
+#include <deque>
+#include <sys/types.h>
+
+// A stream of bytes for FastaReader: a plain file descriptor, or a
+// decompressor layered over one. read() returns the number of bytes
+// read, 0 at end of input and -1 on error (see error()).
+class InputSource {
+  InputSource(const InputSource &);
+  InputSource &operator=(const InputSource &);
+
+protected:
+  std::string err;
+
+public:
+  InputSource() : err() {
+  }
+  virtual ~InputSource() {
+  }
+
+  virtual ssize_t read(char *buf, size_t n) = 0;
+
+  const std::string &error() const {
+    return err;
+  }
+};
+
+class FdSource : public InputSource {
+protected:
+  int fd;
+  std::vector<char> peeked;
+  size_t peek_pos;
+
+public:
+  FdSource(int f) : InputSource(), fd(f), peeked(), peek_pos(0) {
+  }
+
+  // read up to n bytes ahead without consuming them.
+  const std::vector<char> &peek(size_t n);
+
+  virtual ssize_t read(char *buf, size_t n);
+};
+
+// Opens a source over fd, recognising gzip and BGZF input by their
+// magic numbers. BGZF blocks are inflated by a pool of up to the given
+// number of threads. Returns NULL, with a message in error, if fd holds
+// compressed data that cannot be read, or no thread could be started
+// to inflate BGZF blocks.
+InputSource *openInputSource(int fd, int threads, std::string &error);
+
+// true if the bytes look like the start of a gzip member.
+bool isGzipMagic(const char *p, size_t n);
+
+#endif
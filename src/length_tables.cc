@@ -0,0 +1,728 @@
+// Generated by gen_length_tables; do not edit.
+
+#include "length_tables.hh"
+
+static const double a_spacer_lengths_v1_p[] = {
+  0.0043117673366941962,
+  0.0054529120846854131,
+  0.0043493974090868231,
+  0.0023241133621632725,
+  0.0020180603316904454,
+  0.0032516310709434148,
+  0.005023924519636869,
+  0.0075605354047536145,
+  0.0093371553650142616,
+  0.010683509548039313,
+  0.011518426029091153,
+  0.013979612972506706,
+  0.019310079685757681,
+  0.021747322396308815,
+  0.020610337001340146,
+  0.024703992507306798,
+  0.041636030315016503,
+  0.069416968714815522,
+  0.09469162334270613,
+  0.094722152407881594,
+  0.070610376587093751,
+  0.051755721756934846,
+  0.048725029917678735,
+  0.054095655978562848,
+  0.062954892898337736,
+  0.061967673383881601,
+  0.039956968939622688,
+  0.021945760121919306,
+  0.018867298981004772,
+  0.018938612587184541,
+  0.018941732562806655,
+  0.014553442383025191,
+  0.0077855040709256468,
+  0.0040318144575471043,
+  0.0032544738863198312,
+  0.0030826512632640391,
+  0.0027936589728574843,
+  0.001596275223034799,
+  0.0007654682127843722,
+  0.0015962537242134635,
+  0.0027921734886712925,
+  0.0030420515328054274,
+  0.002790752378435317,
+  0.001560066140382293,
+  0.00042034274033694744,
+  0.00041892163060555735,
+  0.0015224576847825244,
+  0.0024094818416051877,
+  0.0015224575655493385,
+  0.00041890037126056693,
+  0.00041890037100827471,
+  0.0015224574463157503,
+  0.0024094605820079054,
+  0.0015210151964731593,
+  0.00038129179667990479,
+  3.7629953159240427e-05,
+  2.8847386569437587e-06,
+  3.7629953159039233e-05,
+  0.0003812917964274114,
+  0.0015210150772397718,
+};
+
+static const double a_spacer_lengths_v1_logp[] = {
+  -5.4464074039985757,
+  -5.2116054855438598,
+  -5.4377179701239537,
+  -6.0644166622822651,
+  -6.2056184607233646,
+  -5.7285985405515181,
+  -5.2935438738867298,
+  -4.8848132705637601,
+  -4.673753637904289,
+  -4.5390538900633439,
+  -4.4638072624682117,
+  -4.2701552269297416,
+  -3.9471280558926582,
+  -3.8282646372415692,
+  -3.8819625328626435,
+  -3.700790408438603,
+  -3.1787893732329051,
+  -2.6676239353789244,
+  -2.3571297373729232,
+  -2.3568073842038486,
+  -2.6505781681287219,
+  -2.9612202875971585,
+  -3.0215624195778497,
+  -2.9170013924984732,
+  -2.765336794771478,
+  -2.7811424269459133,
+  -3.2199521804405147,
+  -3.8191813188514994,
+  -3.9703250681084752,
+  -3.9665524469598994,
+  -3.9663877190189676,
+  -4.2299277234489736,
+  -4.8554917267973563,
+  -5.5135387667453424,
+  -5.7277246488525648,
+  -5.7819652525112435,
+  -5.8804030825555911,
+  -6.4400823493110124,
+  -7.1750228685041906,
+  -6.4400958175186256,
+  -5.8809349582362316,
+  -5.7952231448528142,
+  -5.88144404981312,
+  -6.463027060938491,
+  -7.7744401310520352,
+  -7.7778266946636831,
+  -6.4874293520127511,
+  -6.0283435580794604,
+  -6.4874294303290103,
+  -7.7778774437367506,
+  -7.7778774443390235,
+  -6.4874295086455396,
+  -6.0283523814250888,
+  -6.4883772746482782,
+  -7.8719456054158359,
+  -10.187710198131416,
+  -12.756076248955365,
+  -10.187710198136763,
+  -7.8719456060780413,
+  -6.4883773530389428,
+};
+
+const LengthTable a_spacer_lengths_v1 = { 1, 61, a_spacer_lengths_v1_p, a_spacer_lengths_v1_logp };
+
+static const double a_spacer_lengths_v2_p[] = {
+  2.0726566206476141e-16,
+  2.6057186711367114e-13,
+  1.2304806812718148e-10,
+  2.1939503858309017e-08,
+  1.4885158837838103e-06,
+  3.8812047251418416e-05,
+  0.0003935126813428162,
+  0.0015712111415879283,
+  0.0025285340679320001,
+  0.002055721261876801,
+  0.003141311577247858,
+  0.0096817759928695766,
+  0.023150629064045011,
+  0.032891566378375349,
+  0.028279163764804476,
+  0.026545052380610123,
+  0.044737753197900687,
+  0.083960911791643389,
+  0.12102244404416164,
+  0.11659837255743673,
+  0.073948470351167972,
+  0.046968602658233972,
+  0.05322254520152498,
+  0.069360335612140153,
+  0.081777946182318095,
+  0.075510349499039939,
+  0.042845174300458103,
+  0.014392635589408651,
+  0.0059994671344467928,
+  0.0080709936249290602,
+  0.011131457240657741,
+  0.0094569451789658157,
+  0.0065485018044500942,
+  0.0032946246669206102,
+  0.00079293517181367205,
+  7.7711605635443477e-05,
+  2.9775234380749586e-06,
+  4.3880049588113318e-08,
+  2.460969667588593e-10,
+  5.2114301330330038e-13,
+  4.1525224817148721e-16,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+  0,
+};
+
+static const double a_spacer_lengths_v2_logp[] = {
+  -36.112530311853327,
+  -28.975897690331109,
+  -22.818446039115731,
+  -17.634976995923431,
+  -13.417730985547307,
+  -10.156779863358429,
+  -7.8403972635795496,
+  -6.4559085292563685,
+  -5.9801155639609487,
+  -6.187128513597191,
+  -5.7631148665137708,
+  -4.637509924184509,
+  -3.7657333254262109,
+  -3.4145389951546181,
+  -3.5656300082352161,
+  -3.6289118996724978,
+  -3.1069375432714583,
+  -2.4774039242549017,
+  -2.1117792626178842,
+  -2.1490199626465416,
+  -2.6043867749457146,
+  -3.0582759290507844,
+  -2.9332731904212097,
+  -2.6684401078228812,
+  -2.5037476782969499,
+  -2.5834855526642055,
+  -3.1501622587059948,
+  -4.2410386206208424,
+  -5.1160846246235403,
+  -4.8194786785139518,
+  -4.497980193185386,
+  -4.6610058678392221,
+  -5.0285189876431868,
+  -5.7154630274034135,
+  -7.1397690902214093,
+  -9.4625059470669424,
+  -12.724418664018312,
+  -16.941806071455396,
+  -22.125295483845775,
+  -28.282751893121848,
+  -35.417645511394838,
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+  -__builtin_inf(),
+};
+
+const LengthTable a_spacer_lengths_v2 = { 1, 61, a_spacer_lengths_v2_p, a_spacer_lengths_v2_logp };
+
+static const double b_leader_lengths_p[] = {
+  0.017604379081867155,
+  0.040993195370101494,
+  0.069939177844592929,
+  0.088969867336613717,
+  0.098653158084681711,
+  0.09280641672356893,
+  0.082474638711564005,
+  0.088166196132368438,
+  0.0888275372330391,
+  0.074486696610275321,
+  0.068902445277075466,
+  0.060790787686724655,
+  0.044349205281673194,
+  0.028380499735027688,
+  0.019589433091454396,
+  0.016420917514315028,
+  0.012015463052363414,
+  0.0053579335517730357,
+  0.0011601209583230329,
+  0.00010783207123759089,
+  4.039650092058908e-06,
+  5.9001267615674271e-08,
+};
+
+static const double b_leader_lengths_logp[] = {
+  -4.0396075964167464,
+  -3.194349192634697,
+  -2.6601293025690889,
+  -2.4194575358290376,
+  -2.3161450340032959,
+  -2.3772394958523244,
+  -2.4952644424583053,
+  -2.4285316532390815,
+  -2.4210585730806469,
+  -2.5971347385315564,
+  -2.6750636113589716,
+  -2.8003170198005245,
+  -3.1156604896278397,
+  -3.5620529987009841,
+  -3.9327649861144347,
+  -4.1091992986678658,
+  -4.421560871013785,
+  -5.2291769096213851,
+  -6.759231004883655,
+  -9.1349354368935458,
+  -12.419352480618661,
+  -16.645706908260063,
+};
+
+const LengthTable b_leader_lengths = { 9, 31, b_leader_lengths_p, b_leader_lengths_logp };
+
+static const double b_hydrophobic_lengths_v2_p[] = {
+  0.0033389786709125428,
+  0.018075842056423333,
+  0.049055500259649568,
+  0.079716755094071903,
+  0.12398094570467269,
+  0.18802905484570934,
+  0.1870796445660661,
+  0.1255652111113757,
+  0.084576749287278222,
+  0.070014564839395541,
+  0.039222686235952174,
+  0.01430458880773451,
+  0.0090327087565399301,
+  0.0051764799083731409,
+  0.001415395043427169,
+  0.0014148948124183566,
+};
+
+static const double b_hydrophobic_lengths_v2_logp[] = {
+  -5.7020903059078858,
+  -4.0131789252217027,
+  -3.0148029634848386,
+  -2.5292754882533215,
+  -2.0876273888565664,
+  -1.6711587810417077,
+  -1.6762208460296875,
+  -2.0749300449118535,
+  -2.4700958812625955,
+  -2.6590519894419362,
+  -3.2384999690766541,
+  -4.2471748975465013,
+  -4.7069029834974074,
+  -5.2636300080805922,
+  -6.5603466042171137,
+  -6.5607000881636353,
+};
+
+const LengthTable b_hydrophobic_lengths_v2 = { 20, 36, b_hydrophobic_lengths_v2_p, b_hydrophobic_lengths_v2_logp };
+
+static const double leader_lengths_v1_p[] = {
+  0.02864256867520068,
+  0.035465424352074303,
+  0.04038940143010096,
+  0.044253368159834362,
+  0.046821325477234971,
+  0.046250085600312248,
+  0.041309842799354686,
+  0.033440952637376564,
+  0.025841312613706074,
+  0.020818669626065812,
+  0.018509637449145615,
+  0.017758338315935231,
+  0.017488599895020347,
+  0.017137734009050106,
+  0.016380882350687284,
+  0.015067878998739898,
+  0.013440383274733745,
+  0.011954836294744541,
+  0.01072110565274584,
+  0.0094186268322334673,
+  0.0078956508830927349,
+  0.0065427379991567268,
+  0.0059459732050779635,
+  0.0064779928939952018,
+  0.0083263853703349367,
+  0.011494939560511263,
+  0.015394448086577178,
+  0.01859241172196548,
+  0.019468277090815209,
+  0.017448261812954585,
+  0.01353683651126068,
+  0.0094982991203194679,
+  0.0066042244254403398,
+  0.005166609705623988,
+  0.0048691930177853886,
+  0.0051679851670749788,
+  0.0055069114990096407,
+  0.0055666990754404729,
+  0.0055096549753295932,
+  0.0058493218823923261,
+  0.0068697763138148051,
+  0.008170022419536677,
+  0.0089919112467504204,
+  0.0091403462727412312,
+  0.0094638019768744225,
+  0.011241068156133511,
+  0.015074666227979696,
+  0.020410058863435832,
+  0.025955022381951767,
+  0.030279911985804108,
+  0.032084040905984365,
+  0.0305231767692891,
+  0.025863979654900771,
+  0.019645253583888345,
+  0.013723139863816581,
+  0.0091410223664409335,
+  0.0059848565933363403,
+  0.0039413297367155023,
+  0.0026916772072718516,
+  0.0019927555063255537,
+  0.0016672041197301646,
+  0.0015440151725514928,
+  0.0014203448374660397,
+  0.0011549593892452037,
+  0.00077422301994797707,
+  0.00041459465144895431,
+  0.00017512424197144643,
+  5.8068065493613137e-05,
+  1.5141395962373319e-05,
+  3.5536518819923463e-06,
+  3.5532293595610094e-06,
+  1.5135490573685739e-05,
+  5.8007330877479016e-05,
+  0.00017463561879392208,
+  0.00041151640702975556,
+  0.00075901489875793669,
+  0.0010958587687596015,
+  0.0012385695345227912,
+  0.0010958587699544933,
+  0.00075901492422483037,
+};
+
+static const double leader_lengths_v1_logp[] = {
+  -3.5528612525315424,
+  -3.3391970190232638,
+  -3.2091878692714952,
+  -3.1178237938184941,
+  -3.0614165072552724,
+  -3.0736919642078533,
+  -3.1866544829703272,
+  -3.3979740032115848,
+  -3.6557808036138546,
+  -3.8719051166810337,
+  -3.9894637393445986,
+  -4.0309001090873657,
+  -4.0462060448986286,
+  -4.0664725793918839,
+  -4.1116403344446928,
+  -4.1951900195310223,
+  -4.3094914268284406,
+  -4.4266193716206832,
+  -4.5355409894092888,
+  -4.6650659725446761,
+  -4.8414431922290584,
+  -5.0293995468189818,
+  -5.1250410607941239,
+  -5.0393445551778431,
+  -4.7883258461093359,
+  -4.465848378674572,
+  -4.1737483484219222,
+  -3.9850017534435134,
+  -3.9389689539698725,
+  -4.0485152448678674,
+  -4.3023406790279948,
+  -4.6566425363715815,
+  -5.0200457702429908,
+  -5.2655385685037563,
+  -5.3248270603850507,
+  -5.2652723826539853,
+  -5.2017513394665462,
+  -5.1909530263090709,
+  -5.2012532756854117,
+  -5.1414295419971028,
+  -4.9806237331302468,
+  -4.8072836259846543,
+  -4.7114298561252399,
+  -4.6950570088134471,
+  -4.6602810763547948,
+  -4.4881814073473407,
+  -4.1947396773781973,
+  -3.8917274181157513,
+  -3.651390147366512,
+  -3.4972707570946526,
+  -3.439396540513044,
+  -3.4892689898670404,
+  -3.6549040251777503,
+  -3.9299195177379809,
+  -4.288671829819406,
+  -4.6949830434869604,
+  -5.1185229012724127,
+  -5.5362371159831705,
+  -5.9175907825348837,
+  -6.2182369214807576,
+  -6.396607235360916,
+  -6.4733690006457802,
+  -6.5568555935646824,
+  -6.7636900964531996,
+  -7.1636505864110802,
+  -7.7882092585548417,
+  -8.6500148818164195,
+  -9.753894692487842,
+  -11.098078110614093,
+  -12.547534784072566,
+  -12.54765368923433,
+  -11.098468202822248,
+  -9.7549411609656662,
+  -8.6528089331082629,
+  -7.7956616673667618,
+  -7.1834891513042027,
+  -6.8162169593803581,
+  -6.6937981664665225,
+  -6.8162169582899876,
+  -7.183489117751642,
+};
+
+const LengthTable leader_lengths_v1 = { 1, 81, leader_lengths_v1_p, leader_lengths_v1_logp };
+
+static const double leader_lengths_v2_p[] = {
+  0.026798563163250876,
+  0.032677936838109385,
+  0.037068885688879026,
+  0.041768298624516649,
+  0.04666315395888597,
+  0.04857897129613295,
+  0.044638034336375587,
+  0.035958389080681198,
+  0.026856428353314227,
+  0.020873613944003045,
+  0.018396925721534788,
+  0.017594461250943477,
+  0.016658296003906645,
+  0.015050549179726529,
+  0.013189932423332298,
+  0.011546299397650908,
+  0.010248203187852816,
+  0.0092424648931923644,
+  0.0084252179054736046,
+  0.0076610637555925478,
+  0.0069341180816554337,
+  0.0064796565419889063,
+  0.0066445683603704288,
+  0.0076733333034146355,
+  0.0096672309049472202,
+  0.012490356401963131,
+  0.015412815039670692,
+  0.017023124447326551,
+  0.016068832089569957,
+  0.012640839506934011,
+  0.0082760728113728827,
+  0.0047636163222464639,
+  0.0029888387421539513,
+  0.0028016971279213811,
+  0.0035691369125196901,
+  0.0046718838835423252,
+  0.0056924607188477876,
+  0.006443409488699277,
+  0.0069979069047546019,
+  0.007681535765323517,
+  0.0088258821786276805,
+  0.010348211382044182,
+  0.011729072467818713,
+  0.012700707345328339,
+  0.013907880515459024,
+  0.016580989344251111,
+  0.021412943830062776,
+  0.027743991674403664,
+  0.033734941906733339,
+  0.037258794844477007,
+  0.03688002121218445,
+  0.0325081782250701,
+  0.025469213219983616,
+  0.017861944990702421,
+  0.011522523922788007,
+  0.0072636293342142801,
+  0.0048170047770881748,
+  0.0034023898847955363,
+  0.0024283138316670205,
+  0.0017597259302622099,
+  0.0014571551073310235,
+  0.0014295465678900118,
+  0.001409898224500838,
+  0.0011972864947175192,
+  0.00081956866282820477,
+  0.00044286508120561523,
+  0.00018776004404317718,
+  6.2343639696981444e-05,
+  1.6202106401354715e-05,
+  3.2946981844944722e-06,
+  5.2412418632711857e-07,
+  6.5214310472468907e-08,
+  6.3453643340288747e-09,
+  4.8271204510121474e-10,
+  2.870446611544209e-11,
+  1.3339888167045201e-12,
+  4.8440968142687636e-14,
+  1.3737180914249125e-15,
+  3.1442048959044319e-17,
+  0,
+};
+
+static const double leader_lengths_v2_logp[] = {
+  -3.6194070062141055,
+  -3.4210551432320542,
+  -3.2949773219184766,
+  -3.1756176332988733,
+  -3.0648004201836314,
+  -3.0245645310927305,
+  -3.109168995561935,
+  -3.3253928679160505,
+  -3.6172500694273499,
+  -3.8692694083417254,
+  -3.9955717086780442,
+  -4.040171128117926,
+  -4.0948469281523376,
+  -4.196340798105731,
+  -4.3283014355918681,
+  -4.4613902918246735,
+  -4.580652887510408,
+  -4.6839466655710487,
+  -4.7765259389270129,
+  -4.8716044333841113,
+  -4.9713014024937481,
+  -5.0390877728021408,
+  -5.0139555459815934,
+  -4.8700041682555586,
+  -4.6390133698899056,
+  -4.3827984202667274,
+  -4.1725559701704453,
+  -4.0731825976361824,
+  -4.1308737783162188,
+  -4.3708224757810985,
+  -4.7943867212432831,
+  -5.3467481676243631,
+  -5.8128703475693193,
+  -5.8775299283009872,
+  -5.6354314736185058,
+  -5.3661928874589213,
+  -5.1686126605600187,
+  -5.0446974552500956,
+  -4.9621441882467909,
+  -4.8689357823706141,
+  -4.7300667175749291,
+  -4.5709415875337678,
+  -4.4456846929454681,
+  -4.3660975905860369,
+  -4.2752996559390697,
+  -4.0994984601112527,
+  -3.8437596879314051,
+  -3.584735978470424,
+  -3.3892211269515604,
+  -3.2898672588171078,
+  -3.3000853051262182,
+  -3.4262635836074349,
+  -3.6702848809278987,
+  -4.0250828074081753,
+  -4.4634515571914228,
+  -4.9248756667639775,
+  -5.3356029596201635,
+  -5.6832771869908445,
+  -6.0205581589205615,
+  -6.342597203499845,
+  -6.5312693007906848,
+  -6.5503979703841235,
+  -6.5642377584023279,
+  -6.7276975370866694,
+  -7.1067323770447395,
+  -7.7222453914040043,
+  -8.5803457718498617,
+  -9.6828489007130774,
+  -11.030369299403441,
+  -12.623195992234152,
+  -14.461537183897198,
+  -16.545586906323219,
+  -18.875541316777834,
+  -21.451600819976555,
+  -24.273968391491071,
+  -27.342847551750225,
+  -30.658430489995141,
+  -34.221255395796952,
+  -37.998385538002253,
+  -__builtin_inf(),
+};
+
+const LengthTable leader_lengths_v2 = { 1, 81, leader_lengths_v2_p, leader_lengths_v2_logp };
+
+static const double hydrophobic_lengths_v2_p[] = {
+  0.031720959681557324,
+  0.06836353159042495,
+  0.099342020527777894,
+  0.11509348144532679,
+  0.11354300270221451,
+  0.09639537242671084,
+  0.079845545878532778,
+  0.070316085080209603,
+  0.072916525173191665,
+  0.077267465309091149,
+  0.060792397523059642,
+  0.031531317587387704,
+  0.018399830267005222,
+  0.022986412904047952,
+  0.025208622974026904,
+  0.016277428929434973,
+};
+
+static const double hydrophobic_lengths_v2_logp[] = {
+  -3.4507776278951829,
+  -2.682915760418711,
+  -2.3091866299911761,
+  -2.1620105986953564,
+  -2.1755736353833814,
+  -2.339297082390154,
+  -2.5276611869848571,
+  -2.6547547000758063,
+  -2.6184399828963487,
+  -2.5604823006147801,
+  -2.8002905385674115,
+  -3.4567740179256892,
+  -3.9954138390290255,
+  -3.772851980912824,
+  -3.6805691614864959,
+  -4.1179758590470943,
+};
+
+const LengthTable hydrophobic_lengths_v2 = { 10, 26, hydrophobic_lengths_v2_p, hydrophobic_lengths_v2_logp };
+
@@ -0,0 +1,26 @@
+#ifndef LENGTH_TABLES_HH_INCLUDED
+#define LENGTH_TABLES_HH_INCLUDED
+
+#include <GHMM/ghmm.hh>
+
+// Smoothed state length distributions, precomputed by
+// gen_length_tables into length_tables.cc.
+struct LengthTable {
+  int min_d, max_d;
+  const double *p;
+  const double *logp;
+
+  GHMM::LENGTH::Discrete::Ptr make() const {
+    return new GHMM::LENGTH::Discrete(min_d, max_d, p, logp);
+  }
+};
+
+extern const LengthTable a_spacer_lengths_v1;
+extern const LengthTable a_spacer_lengths_v2;
+extern const LengthTable b_leader_lengths;
+extern const LengthTable b_hydrophobic_lengths_v2;
+extern const LengthTable leader_lengths_v1;
+extern const LengthTable leader_lengths_v2;
+extern const LengthTable hydrophobic_lengths_v2;
+
+#endif
@@ -0,0 +1,467 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "model_file.hh"
+
+#include <GHMM/ghmm_util.hh>
+
+#include <stdio.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+using namespace GHMM;
+
+static double rowSum(const std::vector<double> &row) {
+  double s = 0.0;
+  for (size_t i = 0; i < row.size(); i++) s += row[i];
+  return s;
+}
+
+bool ModelFile::describe(const GHMM::Model &model, std::string &err) {
+  states.clear();
+  transitions.clear();
+
+  int n = model.stateCount();
+  for (int j = 1; j < n - 1; j++) {
+    const StateBase *sb = model.state(j).ptr();
+    State s;
+    s.name = model.stateName(j);
+
+    if (sb->silent()) {
+      s.length_kind = SILENT;
+      s.length_min = 0;
+      states.push_back(s);
+      continue;
+    }
+
+    if (const LENGTH::Fixed *f = dynamic_cast<const LENGTH::Fixed *>(sb)) {
+      s.length_kind = FIXED;
+      s.length_min = f->minLength();
+    } else if (const LENGTH::Geometric *g = dynamic_cast<const LENGTH::Geometric *>(sb)) {
+      s.length_kind = GEOMETRIC;
+      s.p_self = g->pSelf();
+    } else if (const LENGTH::Discrete *d = dynamic_cast<const LENGTH::Discrete *>(sb)) {
+      s.length_kind = DISCRETE;
+      s.length_min = d->minLength();
+      for (int l = d->minLength(); l < d->maxLength(); l++) s.lengths.push_back(d->pLength(l));
+    } else {
+      err = "state " + s.name + " has an unsupported length distribution";
+      return false;
+    }
+
+    if (const EMISSION::Stateless *e = dynamic_cast<const EMISSION::Stateless *>(sb)) {
+      s.emit.assign(1, std::vector<double>(SYMBOLS, 0.0));
+      for (int c = 0; c < SYMBOLS; c++) s.emit[0][c] = e->emissionProb(c);
+    } else if (const EMISSION::PositionSpecific *e = dynamic_cast<const EMISSION::PositionSpecific *>(sb)) {
+      const std::vector<MATH::DPDF::Ptr> &pssm(e->emissionDistrib());
+      s.position_specific = true;
+      s.emit.assign(pssm.size(), std::vector<double>(SYMBOLS, 0.0));
+      for (size_t k = 0; k < pssm.size(); k++) {
+        for (int c = 0; c < SYMBOLS; c++) s.emit[k][c] = pssm[k]->p(c);
+      }
+    } else {
+      err = "state " + s.name + " has an unsupported emission distribution";
+      return false;
+    }
+    states.push_back(s);
+  }
+
+  // the model folds the self transitions of geometric states into its
+  // transition table; take them out again.
+  for (int s = 0; s < n - 1; s++) {
+    double scale = 1.0;
+    bool geometric = s > 0 && states[s - 1].length_kind == GEOMETRIC;
+    if (geometric) scale = 1.0 - states[s - 1].p_self;
+    for (int t = 1; t < n; t++) {
+      if (geometric && t == s) continue;
+      double p = model.p(s, t);
+      if (p <= 0.0) continue;
+      Transition tr;
+      tr.from = model.stateName(s);
+      tr.to = model.stateName(t);
+      tr.weight = p / scale;
+      transitions.push_back(tr);
+    }
+  }
+  return true;
+}
+
+static MATH::DPDF::Ptr makeDPDF(int a, const std::vector<double> &p) {
+  MATH::DPDF::Ptr result = new MATH::DPDF();
+  result->setDistrib(a, a + (int)p.size(), 0.0);
+  for (size_t i = 0; i < p.size(); i++) result->setp(a + i, p[i]);
+  result->normalize();
+  return result;
+}
+
+GHMM::UTIL::Alphabet::Ptr ModelFile::alphabet() {
+  GHMM::UTIL::Alphabet::Ptr result = new GHMM::UTIL::Alphabet();
+  result->addCharTokenRange('A', 'A' + SYMBOLS - 1);
+  result->setUnknown('X' - 'A');
+  return result;
+}
+
+GHMM::Model::Ptr ModelFile::make(std::string &err) const {
+  ModelBuilder mb;
+
+  mb.setAlphabet(alphabet());
+
+  for (size_t i = 0; i < states.size(); i++) {
+    const State &s(states[i]);
+    StateBase::Ptr state;
+
+    if (s.length_kind == SILENT) {
+      state = new Silent();
+    } else if (s.position_specific) {
+      std::vector<MATH::DPDF::Ptr> pssm;
+      for (size_t k = 0; k < s.emit.size(); k++) pssm.push_back(makeDPDF(0, s.emit[k]));
+      state = UTIL::makeMotifState(pssm);
+    } else {
+      LENGTH::Base::Ptr length;
+      if (s.length_kind == GEOMETRIC) {
+        LENGTH::Geometric *g = new LENGTH::Geometric();
+        g->setPSelf(s.p_self);
+        length = g;
+      } else if (s.length_kind == DISCRETE) {
+        length = new LENGTH::Discrete(makeDPDF(s.length_min, s.lengths));
+      } else {
+        length = new LENGTH::Fixed(s.length_min);
+      }
+      state = UTIL::makeState(length, new EMISSION::Stateless(makeDPDF(0, s.emit[0])));
+    }
+    mb.addState(s.name, state);
+  }
+
+  for (size_t i = 0; i < transitions.size(); i++) {
+    mb.addStateTransition(transitions[i].from, transitions[i].to, transitions[i].weight);
+  }
+  GHMM::Model::Ptr model = mb.make();
+  if (model == NULL) err = mb.error();
+  return model;
+}
+
+static bool parseEmission(std::istringstream &fields, std::vector<double> &row) {
+  std::string entry;
+  row.assign(ModelFile::SYMBOLS, 0.0);
+  while (fields >> entry) {
+    char c;
+    double p;
+    char tail;
+    if (sscanf(entry.c_str(), "%c:%lf%c", &c, &p, &tail) != 2 || c < 'A' || c > 'Z' || !(p >= 0.0)) return false;
+    row[c - 'A'] = p;
+  }
+  return rowSum(row) > 0.0;
+}
+
+bool ModelFile::read(const std::string &path, std::string &err) {
+  std::ifstream in(path.c_str());
+  if (!in) {
+    err = "could not open " + path;
+    return false;
+  }
+
+  states.clear();
+  transitions.clear();
+
+  std::string line;
+  int version = 0;
+  if (!std::getline(in, line) || sscanf(line.c_str(), "exportpred-model %d", &version) != 1 || version != 1) {
+    err = path + " is not a model file";
+    return false;
+  }
+
+  std::map<std::string, int> names;
+  names[Model::BEGIN] = -1;
+  names[Model::END] = -1;
+
+  int line_no = 1;
+  while (std::getline(in, line)) {
+    line_no++;
+    std::istringstream fields(line);
+    std::string tag;
+    if (!(fields >> tag) || tag[0] == '#') continue;
+
+    std::ostringstream where;
+    where << path << ":" << line_no << ": ";
+
+    if (tag == "state") {
+      State s;
+      if (!(fields >> s.name) || names.count(s.name)) {
+        err = where.str() + "bad or repeated state name";
+        return false;
+      }
+      names[s.name] = states.size();
+      states.push_back(s);
+      continue;
+    }
+
+    if (tag == "transition") {
+      Transition t;
+      if (!(fields >> t.from >> t.to >> t.weight) || !(t.weight >= 0.0)) {
+        err = where.str() + "bad transition";
+        return false;
+      }
+      transitions.push_back(t);
+      continue;
+    }
+
+    if (!states.size()) {
+      err = where.str() + tag + " before the first state";
+      return false;
+    }
+    State &s(states.back());
+
+    if (tag == "silent") {
+      s.length_kind = SILENT;
+      s.length_min = 0;
+    } else if (tag == "length") {
+      std::string kind;
+      fields >> kind;
+      if (kind == "fixed" && fields >> s.length_min && s.length_min > 0) {
+        s.length_kind = FIXED;
+      } else if (kind == "geometric" && fields >> s.p_self && s.p_self > 0.0 && s.p_self < 1.0) {
+        s.length_kind = GEOMETRIC;
+      } else if (kind == "discrete" && fields >> s.length_min && s.length_min > 0) {
+        double p;
+        s.length_kind = DISCRETE;
+        s.lengths.clear();
+        while (fields >> p && p >= 0.0) s.lengths.push_back(p);
+        if (!fields.eof() || rowSum(s.lengths) <= 0.0) {
+          err = where.str() + "bad length histogram";
+          return false;
+        }
+      } else {
+        err = where.str() + "bad length";
+        return false;
+      }
+    } else if (tag == "emit" || tag == "column") {
+      std::vector<double> row;
+      if (!parseEmission(fields, row)) {
+        err = where.str() + "bad emission distribution";
+        return false;
+      }
+      if ((tag == "column") != s.position_specific && s.emit.size()) {
+        err = where.str() + "state " + s.name + " mixes emit and column";
+        return false;
+      }
+      if (tag == "emit" && s.emit.size()) {
+        err = where.str() + "state " + s.name + " has more than one emit";
+        return false;
+      }
+      s.position_specific = tag == "column";
+      s.emit.push_back(row);
+    } else {
+      err = where.str() + "unknown keyword " + tag;
+      return false;
+    }
+  }
+
+  for (size_t i = 0; i < states.size(); i++) {
+    const State &s(states[i]);
+    if (s.length_kind == SILENT) {
+      if (s.emit.size()) {
+        err = path + ": silent state " + s.name + " has an emission distribution";
+        return false;
+      }
+      continue;
+    }
+    if (!s.emit.size()) {
+      err = path + ": state " + s.name + " has no emission distribution";
+      return false;
+    }
+    if (s.position_specific && s.length_kind != FIXED) {
+      err = path + ": state " + s.name + " has columns, and so a fixed length";
+      return false;
+    }
+  }
+  for (size_t i = 0; i < transitions.size(); i++) {
+    if (!names.count(transitions[i].from) || !names.count(transitions[i].to)) {
+      err = path + ": transition to or from an unknown state";
+      return false;
+    }
+  }
+  return true;
+}
+
+bool ModelFile::write(const std::string &path) const {
+  FILE *fp = path == "-" ? stdout : fopen(path.c_str(), "w");
+  if (fp == NULL) return false;
+
+  fprintf(fp, "exportpred-model 1\n");
+  for (size_t i = 0; i < states.size(); i++) {
+    const State &s(states[i]);
+    fprintf(fp, "state %s\n", s.name.c_str());
+    if (s.length_kind == SILENT) {
+      fprintf(fp, "silent\n");
+    } else if (s.length_kind == GEOMETRIC) {
+      fprintf(fp, "length geometric %.17g\n", s.p_self);
+    } else if (s.length_kind == DISCRETE) {
+      fprintf(fp, "length discrete %d", s.length_min);
+      for (size_t l = 0; l < s.lengths.size(); l++) fprintf(fp, " %.17g", s.lengths[l]);
+      fprintf(fp, "\n");
+    } else if (s.length_min != 1 && !s.position_specific) {
+      fprintf(fp, "length fixed %d\n", s.length_min);
+    }
+    for (size_t k = 0; k < s.emit.size(); k++) {
+      fprintf(fp, s.position_specific ? "column" : "emit");
+      for (int c = 0; c < SYMBOLS; c++) {
+        if (s.emit[k][c] > 0.0) fprintf(fp, " %c:%.17g", 'A' + c, s.emit[k][c]);
+      }
+      fprintf(fp, "\n");
+    }
+  }
+  for (size_t i = 0; i < transitions.size(); i++) {
+    const Transition &t(transitions[i]);
+    fprintf(fp, "transition %s %s %.17g\n", t.from.c_str(), t.to.c_str(), t.weight);
+  }
+  if (fp == stdout) return fflush(fp) == 0;
+  return fclose(fp) == 0;
+}
+
+static bool hasSelfTransition(const std::vector<ModelFile::Transition> &transitions, const std::string &name) {
+  for (size_t i = 0; i < transitions.size(); i++) {
+    if (transitions[i].from == name && transitions[i].to == name) return true;
+  }
+  return false;
+}
+
+std::vector<ModelFile::LengthChange> ModelFile::truncateLengths(double max_tail) {
+  std::vector<LengthChange> changes;
+  for (size_t i = 0; i < states.size(); i++) {
+    State &s(states[i]);
+    if (s.length_kind != DISCRETE || s.lengths.size() < 2) continue;
+
+    LENGTH::Discrete length(makeDPDF(s.length_min, s.lengths));
+    LengthChange c;
+    c.state = s.name;
+    c.durations_before = s.lengths.size();
+    c.error = length.truncate(max_tail);
+    c.durations_after = length.maxLength() - length.minLength();
+    if (c.durations_after == c.durations_before) continue;
+
+    s.lengths.clear();
+    for (int l = length.minLength(); l < length.maxLength(); l++) s.lengths.push_back(length.pLength(l));
+    changes.push_back(c);
+  }
+  return changes;
+}
+
+std::vector<ModelFile::LengthChange> ModelFile::splitLengthTails(int head) {
+  std::vector<LengthChange> changes;
+  if (head < 1) return changes;
+
+  for (size_t i = 0; i < states.size(); i++) {
+    if (states[i].length_kind != DISCRETE || (int)states[i].lengths.size() <= head + 1) continue;
+    if (hasSelfTransition(transitions, states[i].name)) continue;
+
+    State s(states[i]);
+    double sum = rowSum(s.lengths);
+    if (sum <= 0.0) continue;
+
+    // lengths past h, the last one in the head, are h plus a
+    // geometric number of residues with the same mean.
+    int h = s.length_min + head - 1;
+    double tail = 0.0, tail_mean = 0.0;
+    for (size_t k = head; k < s.lengths.size(); k++) {
+      double p = s.lengths[k] / sum;
+      tail += p;
+      tail_mean += p * (s.length_min + (int)k - h);
+    }
+    if (tail <= 0.0) continue;
+    tail_mean /= tail;
+    double p_self = 1.0 - 1.0 / tail_mean;
+
+    LengthChange c;
+    c.state = s.name;
+    c.durations_before = s.lengths.size();
+    c.durations_after = head + 2;
+    // the head is exact; the tail differs over the old lengths, and
+    // puts the rest of its mass past them.
+    c.error = 0.0;
+    double q = 1.0 - p_self, reach = 1.0;
+    for (size_t k = head; k < s.lengths.size(); k++) {
+      c.error += fabs(s.lengths[k] / sum - tail * q * reach);
+      reach *= p_self;
+    }
+    c.error = (c.error + tail * reach) / 2.0;
+    changes.push_back(c);
+
+    State &head_state(states[i]);
+    head_state.lengths.resize(head);
+
+    State long_state(s);
+    long_state.name = s.name + "~long";
+    long_state.length_kind = FIXED;
+    long_state.length_min = h;
+    long_state.lengths.clear();
+
+    // one residue at a time, looping on itself: a GEOMETRIC state
+    // would also charge p_self for its length.
+    State tail_state(s);
+    tail_state.name = s.name + "~tail";
+    tail_state.length_kind = FIXED;
+    tail_state.length_min = 1;
+    tail_state.lengths.clear();
+
+    double out_sum = 0.0;
+    for (size_t t = 0; t < transitions.size(); t++) {
+      if (transitions[t].from == s.name) out_sum += transitions[t].weight;
+    }
+
+    std::vector<Transition> added;
+    for (size_t t = 0; t < transitions.size(); t++) {
+      Transition &tr(transitions[t]);
+      if (tr.to == s.name) {
+        Transition into(tr);
+        into.to = long_state.name;
+        into.weight = tr.weight * tail;
+        tr.weight *= 1.0 - tail;
+        added.push_back(into);
+      } else if (tr.from == s.name) {
+        Transition out(tr);
+        out.from = tail_state.name;
+        out.weight = tr.weight / out_sum * (1.0 - p_self);
+        added.push_back(out);
+      }
+    }
+    Transition link;
+    link.from = long_state.name;
+    link.to = tail_state.name;
+    link.weight = 1.0;
+    added.push_back(link);
+    if (p_self > 0.0) {
+      link.from = link.to = tail_state.name;
+      link.weight = p_self;
+      added.push_back(link);
+    }
+    transitions.insert(transitions.end(), added.begin(), added.end());
+
+    states.insert(states.begin() + i + 1, tail_state);
+    states.insert(states.begin() + i + 1, long_state);
+    i += 2;
+  }
+  return changes;
+}
+
+std::string ModelFile::baseName(const std::string &name) {
+  return name.substr(0, name.find('~'));
+}
@@ -0,0 +1,110 @@
+#ifndef MODEL_FILE_HH_INCLUDED
+#define MODEL_FILE_HH_INCLUDED
+
+#include <string>
+#include <vector>
+#include <GHMM/ghmm.hh>
+
+// A model's states and transitions as plain data, so that a model can
+// be written out, re-estimated by exportpred-train and read back by
+// exportpred in place of the built in variants. A model file looks
+// like:
+//
+//   exportpred-model 1
+//   state a-met
+//   emit M:1
+//   state a-leader
+//   length discrete 10 0.0012 0.0031 ...
+//   emit A:0.031 C:0.012 ...
+//   state a-RLE
+//   column R:0.9 K:0.1
+//   column ...
+//   state a-tail
+//   length geometric 0.99867
+//   emit A:0.031 C:0.012 ...
+//   transition __BEGIN__ a-met 1
+//   ...
+//
+// A state's length is fixed (one residue unless given), geometric
+// (given as the probability of staying for another residue) or a
+// histogram starting at the given length. Emissions are over the
+// residues A..Z, unlisted residues having probability 0; a state
+// emits either from one distribution (emit) or from one per position
+// (column, one line each, in order), in which case its length is the
+// number of columns. A state given as silent has neither a length nor
+// emissions (see GHMM::Silent); the model places such states after
+// the others. Distributions and transition weights need not be
+// normalized. Blank lines and lines starting with # are ignored.
+struct ModelFile {
+  enum { SYMBOLS = 26 };
+  enum LengthKind { FIXED, GEOMETRIC, DISCRETE, SILENT };
+
+  struct State {
+    std::string name;
+    LengthKind length_kind;
+    // FIXED: the length. DISCRETE: the length of lengths[0]. SILENT: 0.
+    int length_min;
+    double p_self;
+    std::vector<double> lengths;
+    bool position_specific;
+    // SYMBOLS probabilities per row; one row, or one per column.
+    std::vector<std::vector<double> > emit;
+
+    State() : name(), length_kind(FIXED), length_min(1), p_self(0.0), lengths(), position_specific(false), emit() {
+    }
+  };
+
+  struct Transition {
+    std::string from, to;
+    double weight;
+  };
+
+  // what truncateLengths() or splitLengthTails() did to one state.
+  struct LengthChange {
+    std::string state;
+    // lengths the parse tries per position, before and after.
+    int durations_before, durations_after;
+    // total variation distance between the old and new length
+    // distributions.
+    double error;
+  };
+
+  std::vector<State> states;
+  std::vector<Transition> transitions;
+
+  // describe a model built from GHMM::State<> objects with Fixed,
+  // Geometric or Discrete lengths, as all the PEXEL models are, and
+  // GHMM::Silent states.
+  // states are listed in the model's order, which make() keeps.
+  bool describe(const GHMM::Model &model, std::string &err);
+  // the model described, or NULL, with err saying why, if the states
+  // and transitions do not make one.
+  GHMM::Model::Ptr make(std::string &err) const;
+
+  bool read(const std::string &path, std::string &err);
+  bool write(const std::string &path) const;
+
+  // drop the longest lengths of each histogram state whose
+  // probabilities add up to at most max_tail.
+  std::vector<LengthChange> truncateLengths(double max_tail);
+
+  // give each histogram state longer than head + 1 lengths an explicit
+  // head of its first head lengths, and model the rest as a fixed run
+  // of the head's last length followed by a geometric tail with the
+  // same mean, one residue per visit to a self looping state. the
+  // head keeps the state's name; the other two are
+  // named name~long and name~tail, and are reached from the state's
+  // predecessors with the probability of a length past the head.
+  // states with a self transition are left alone.
+  std::vector<LengthChange> splitLengthTails(int head);
+
+  // the alphabet of the emissions: A..Z, one symbol each, with X for
+  // any other byte. make() gives models this alphabet.
+  static GHMM::UTIL::Alphabet::Ptr alphabet();
+
+  // the state a segment of state name belongs to, for output: name
+  // up to any ~ added by splitLengthTails().
+  static std::string baseName(const std::string &name);
+};
+
+#endif
@@ -0,0 +1,222 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "null_table.hh"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <fstream>
+#include <sstream>
+#include <map>
+
+#define SCORE_MIN -100.0
+#define SCORE_STEP 0.1
+#define SCORE_BINS 2000
+
+// the exponential tail is fitted to the top 1% of the null scores,
+// given enough of them.
+#define TAIL_FRACTION 0.01
+#define TAIL_MIN_SAMPLES 20
+
+static int scoreBin(double score) {
+  if (!(score > SCORE_MIN)) return 0;
+  double b = (score - SCORE_MIN) / SCORE_STEP;
+  return b >= SCORE_BINS - 1 ? SCORE_BINS - 1 : (int)b;
+}
+
+int NullTable::lengthBin(size_t length) {
+  int b = 0;
+  for (size_t l = length / 64; l && b < LENGTH_BINS - 1; l >>= 1) b++;
+  return b;
+}
+
+NullTable::NullTable() : names(), dists() {
+}
+
+void NullTable::setBuckets(const std::vector<std::string> &n) {
+  names = n;
+  dists.assign(names.size() * LENGTH_BINS, Dist());
+  for (size_t i = 0; i < dists.size(); i++) {
+    dists[i].counts.assign(SCORE_BINS, 0);
+    dists[i].tail_bin = SCORE_BINS;
+    dists[i].tail_lambda = 0.0;
+  }
+}
+
+void NullTable::add(int bucket, size_t length, double score) {
+  dist(bucket, lengthBin(length)).counts[scoreBin(score)]++;
+}
+
+void NullTable::merge(const NullTable &t) {
+  for (size_t i = 0; i < dists.size() && i < t.dists.size(); i++) {
+    for (int j = 0; j < SCORE_BINS; j++) dists[i].counts[j] += t.dists[i].counts[j];
+  }
+}
+
+uint64_t NullTable::samples(int bucket) const {
+  uint64_t n = 0;
+  for (int b = 0; b < LENGTH_BINS; b++) {
+    const std::vector<uint64_t> &c(dist(bucket, b).counts);
+    for (int j = 0; j < SCORE_BINS; j++) n += c[j];
+  }
+  return n;
+}
+
+// only the non-zero bins are written, as bin:count.
+bool NullTable::write(const std::string &path) const {
+  FILE *fp = fopen(path.c_str(), "w");
+  if (fp == NULL) return false;
+
+  fprintf(fp, "exportpred-null 1\n");
+  fprintf(fp, "grid %g %g %d\n", SCORE_MIN, SCORE_STEP, SCORE_BINS);
+  for (int k = 0; k < (int)names.size(); k++) {
+    for (int b = 0; b < LENGTH_BINS; b++) {
+      const std::vector<uint64_t> &c(dist(k, b).counts);
+      fprintf(fp, "dist %s %d", names[k].c_str(), b);
+      for (int j = 0; j < SCORE_BINS; j++) {
+        if (c[j]) fprintf(fp, " %d:%llu", j, (unsigned long long)c[j]);
+      }
+      fprintf(fp, "\n");
+    }
+  }
+  return fclose(fp) == 0;
+}
+
+bool NullTable::read(const std::string &path, const std::vector<std::string> &want, std::string &err) {
+  std::ifstream in(path.c_str());
+  if (!in) {
+    err = "could not open " + path;
+    return false;
+  }
+
+  setBuckets(want);
+  std::map<std::string, int> index;
+  for (int k = 0; k < (int)want.size(); k++) index[want[k]] = k;
+  std::vector<bool> seen(want.size(), false);
+
+  std::string line;
+  int version = 0;
+  if (!std::getline(in, line) || sscanf(line.c_str(), "exportpred-null %d", &version) != 1 || version != 1) {
+    err = path + " is not a null score table";
+    return false;
+  }
+
+  double grid_min = 0, grid_step = 0;
+  int grid_bins = 0;
+  if (!std::getline(in, line) || sscanf(line.c_str(), "grid %lf %lf %d", &grid_min, &grid_step, &grid_bins) != 3 ||
+      fabs(grid_min - SCORE_MIN) > 1e-9 || fabs(grid_step - SCORE_STEP) > 1e-9 || grid_bins != SCORE_BINS) {
+    err = path + " has an unsupported score grid";
+    return false;
+  }
+
+  while (std::getline(in, line)) {
+    std::istringstream fields(line);
+    std::string tag, variant, cls;
+    int b;
+    if (!(fields >> tag >> variant >> cls >> b) || tag != "dist" || b < 0 || b >= LENGTH_BINS) {
+      err = "bad line in " + path + ": " + line;
+      return false;
+    }
+    std::map<std::string, int>::const_iterator i = index.find(variant + " " + cls);
+    if (i == index.end()) continue;
+    seen[(*i).second] = true;
+
+    std::vector<uint64_t> &c(dist((*i).second, b).counts);
+    std::string entry;
+    while (fields >> entry) {
+      int j;
+      unsigned long long n;
+      if (sscanf(entry.c_str(), "%d:%llu", &j, &n) != 2 || j < 0 || j >= SCORE_BINS) {
+        err = "bad line in " + path + ": " + line;
+        return false;
+      }
+      c[j] = n;
+    }
+  }
+
+  for (int k = 0; k < (int)want.size(); k++) {
+    if (!seen[k] || !samples(k)) {
+      err = path + " has no null scores for " + want[k];
+      return false;
+    }
+  }
+
+  prepare();
+  return true;
+}
+
+void NullTable::prepare() {
+  for (int k = 0; k < (int)names.size(); k++) {
+    for (int b = 0; b < LENGTH_BINS; b++) {
+      Dist &d(dist(k, b));
+      d.at_least.assign(SCORE_BINS + 1, 0);
+      for (int j = SCORE_BINS - 1; j >= 0; j--) d.at_least[j] = d.at_least[j + 1] + d.counts[j];
+
+      uint64_t n = d.at_least[0];
+      d.tail_bin = SCORE_BINS;
+      d.tail_lambda = 0.0;
+      if (n * TAIL_FRACTION < TAIL_MIN_SAMPLES) continue;
+
+      int u = SCORE_BINS - 1;
+      while (u > 0 && d.at_least[u] < n * TAIL_FRACTION) u--;
+
+      // maximum likelihood rate: one over the mean excess over the
+      // bin's lower edge, taking scores at their bin's centre.
+      double excess = 0.0;
+      for (int j = u; j < SCORE_BINS; j++) excess += d.counts[j] * (j - u + 0.5) * SCORE_STEP;
+      excess /= d.at_least[u];
+      if (excess > 0.0) {
+        d.tail_bin = u;
+        d.tail_lambda = 1.0 / excess;
+      }
+    }
+
+    // length bins without scores borrow the p-values of the nearest
+    // bin that has some; their counts stay empty.
+    std::vector<uint64_t> n(LENGTH_BINS);
+    for (int b = 0; b < LENGTH_BINS; b++) n[b] = dist(k, b).at_least[0];
+    for (int b = 0; b < LENGTH_BINS; b++) {
+      if (n[b]) continue;
+      for (int o = 1; o < LENGTH_BINS; o++) {
+        int from = b - o >= 0 && n[b - o] ? b - o : b + o < LENGTH_BINS && n[b + o] ? b + o : -1;
+        if (from < 0) continue;
+        Dist &d(dist(k, b));
+        d.at_least = dist(k, from).at_least;
+        d.tail_bin = dist(k, from).tail_bin;
+        d.tail_lambda = dist(k, from).tail_lambda;
+        break;
+      }
+    }
+  }
+}
+
+double NullTable::pValue(int bucket, size_t length, double score) const {
+  const Dist &d(dist(bucket, lengthBin(length)));
+  double n = d.at_least[0];
+  int j = scoreBin(score);
+
+  if (j >= d.tail_bin) {
+    double u = SCORE_MIN + d.tail_bin * SCORE_STEP;
+    return (d.at_least[d.tail_bin] + 1) / (n + 1) * exp(-d.tail_lambda * (score - u));
+  }
+  return (d.at_least[j] + 1) / (n + 1);
+}
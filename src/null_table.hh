@@ -0,0 +1,71 @@
+#ifndef NULL_TABLE_HH_INCLUDED
+#define NULL_TABLE_HH_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Null (background) score distributions, one per bucket (model variant
+// and motif class) and sequence length bin, tabulated on a fixed grid
+// of scores. Calibration runs fill a table per thread, merge them and
+// write the result; scoring runs read it back to turn hit scores into
+// p-values.
+//
+// Length bin b holds sequences of [64 * 2^(b-1), 64 * 2^b) residues;
+// bin 0 is everything shorter than 64, and the last bin everything
+// longer. Above the 99th percentile of a distribution p-values come
+// from an exponential fitted to the tail, so scores beyond anything
+// seen in the null set still get graded p-values.
+class NullTable {
+public:
+  enum { LENGTH_BINS = 10 };
+
+  static int lengthBin(size_t length);
+
+  NullTable();
+
+  // name each bucket, as written to and matched in the table file.
+  void setBuckets(const std::vector<std::string> &names);
+  int buckets() const {
+    return names.size();
+  }
+
+  void add(int bucket, size_t length, double score);
+  void merge(const NullTable &t);
+
+  bool write(const std::string &path) const;
+  // read a table holding (at least) the buckets named; they are
+  // numbered as given.
+  bool read(const std::string &path, const std::vector<std::string> &names, std::string &err);
+
+  // probability of a null sequence of this length scoring at least
+  // score. only valid after read().
+  double pValue(int bucket, size_t length, double score) const;
+
+  // number of null scores behind a bucket.
+  uint64_t samples(int bucket) const;
+
+protected:
+  struct Dist {
+    std::vector<uint64_t> counts;
+    // filled in by prepare(): counts at or above each grid bin, and
+    // the tail fit.
+    std::vector<uint64_t> at_least;
+    int tail_bin;
+    double tail_lambda;
+  };
+
+  std::vector<std::string> names;
+  std::vector<Dist> dists;
+
+  Dist &dist(int bucket, int bin) {
+    return dists[bucket * LENGTH_BINS + bin];
+  }
+  const Dist &dist(int bucket, int bin) const {
+    return dists[bucket * LENGTH_BINS + bin];
+  }
+
+  void prepare();
+};
+
+#endif
@@ -0,0 +1,75 @@
+#ifndef OUTPUT_BUFFER_HH_INCLUDED
+#define OUTPUT_BUFFER_HH_INCLUDED
+
+#include <stdio.h>
+#include <string.h>
+#include <string>
+#include <vector>
+
+// A reusable, growable character buffer for formatting output. It
+// only allocates when it has to grow, so once warmed up formatting a
+// line costs nothing but copies. Contents go out with a single
+// fwrite().
+class OutputBuffer {
+  OutputBuffer(const OutputBuffer &);
+  OutputBuffer &operator=(const OutputBuffer &);
+
+protected:
+  std::vector<char> buf;
+  size_t len;
+
+  void grow(size_t need) {
+    size_t n = buf.size() ? buf.size() : 256;
+    while (n < need) n *= 2;
+    buf.resize(n);
+  }
+
+public:
+  OutputBuffer(size_t reserve = 0) : buf(reserve), len(0) {
+  }
+
+  void clear() {
+    len = 0;
+  }
+  size_t size() const {
+    return len;
+  }
+  const char *data() const {
+    return len ? &buf[0] : "";
+  }
+
+  void append(const char *p, size_t n) {
+    if (len + n > buf.size()) grow(len + n);
+    if (n) memcpy(&buf[len], p, n);
+    len += n;
+  }
+  void append(const std::string &s) {
+    append(s.data(), s.size());
+  }
+  void append(char c) {
+    if (len + 1 > buf.size()) grow(len + 1);
+    buf[len++] = c;
+  }
+  // make room for n more characters, to be filled in by the caller.
+  char *extend(size_t n) {
+    if (len + n > buf.size() || buf.empty()) grow(len + n);
+    char *p = &buf[0] + len;
+    len += n;
+    return p;
+  }
+  // formatted as an ostream with default flags would.
+  void append(double d) {
+    char tmp[32];
+    int n = snprintf(tmp, sizeof(tmp), "%g", d);
+    append(tmp, n);
+  }
+
+  // write everything and empty the buffer.
+  bool write(FILE *fp) {
+    bool ok = !len || fwrite(&buf[0], 1, len, fp) == len;
+    len = 0;
+    return ok;
+  }
+};
+
+#endif
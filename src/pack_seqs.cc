@@ -0,0 +1,127 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "fasta_reader.hh"
+#include "seq_db.hh"
+
+#include <iostream>
+#include <vector>
+#include <string>
+
+#include <getopt.h>
+#include <stdlib.h>
+
+static const struct option options[] = {
+  { "input",             required_argument,          0,            'i' },
+  { "output",            required_argument,          0,            'o' },
+  { 0,                   0,                          0,            0   }
+};
+
+void usage(const char *progname) {
+  std::cout << "Usage: " << progname << " [arguments]" << std::endl;
+  std::cout << "\
+\n\
+Pack FASTA sequences into a database that exportpred can map and\n\
+score without parsing or encoding them again.\n\
+\n\
+--input=file            -i file        read sequences from file (-:stdin);\n\
+                                       may be given more than once\n\
+--output=file           -o file        write the database to file\n\
+\n\
+";
+}
+
+int main(int argc, char **argv) {
+  std::vector<std::string> inputs;
+  std::string output;
+
+  int ch;
+
+  while ((ch = getopt_long(argc, argv, "i:o:h", options, NULL)) != -1) {
+    switch (ch) {
+    case 'i': {
+      inputs.push_back(optarg);
+      break;
+    }
+    case 'o': {
+      output = optarg;
+      break;
+    }
+    case 'h':
+    case '?': {
+      usage(argv[0]);
+      exit(0);
+    }
+    }
+  }
+
+  if (output == "") {
+    usage(argv[0]);
+    exit(1);
+  }
+  if (!inputs.size()) {
+    inputs.push_back("-");
+  }
+
+  SeqDBWriter writer;
+  if (!writer.open(output.c_str())) {
+    std::cerr << "could not open " << output << std::endl;
+    exit(1);
+  }
+
+  std::vector<unsigned char> codes;
+  std::vector<char> text;
+
+  for (int f = 0; f < (int)inputs.size(); f++) {
+    FastaReader reader;
+    FastaRecord rec;
+    int n_read = 0;
+
+    if (!reader.open(inputs[f].c_str())) {
+      std::cerr << "could not open " << inputs[f] << ": " << reader.error() << std::endl;
+      exit(1);
+    }
+
+    while (reader.next(rec)) {
+      n_read++;
+      if (codes.size() < rec.seq_len) {
+        codes.resize(rec.seq_len);
+        text.resize(rec.seq_len);
+      }
+      size_t len = reader.encode(rec.seq, rec.seq_len, &codes[0]);
+      FastaReader::strip(rec.seq, rec.seq_len, &text[0]);
+      if (!writer.add(rec.name, rec.name_len, &codes[0], &text[0], len)) {
+        std::cerr << "could not write " << output << std::endl;
+        exit(1);
+      }
+    }
+    if (reader.failed()) {
+      std::cerr << "error reading " << inputs[f] << ": " << reader.error() << std::endl;
+      exit(1);
+    }
+
+    std::cerr << n_read << " sequences packed from " << (inputs[f] == "-" ? "stdin" : inputs[f]) << std::endl;
+  }
+
+  if (!writer.finish()) {
+    std::cerr << "could not write " << output << std::endl;
+    exit(1);
+  }
+}
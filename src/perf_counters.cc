@@ -0,0 +1,126 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include "perf_counters.hh"
+
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#endif
+
+PerfCounters::PerfCounters() : leader(-1), n_open(0), time_enabled(0), time_running(0), err() {
+  for (int e = 0; e < EVENTS; e++) fds[e] = -1;
+}
+
+PerfCounters::~PerfCounters() {
+  close();
+}
+
+#ifdef HAVE_LINUX_PERF_EVENT_H
+static const uint64_t event_config[PerfCounters::EVENTS] = {
+  PERF_COUNT_HW_CPU_CYCLES,
+  PERF_COUNT_HW_INSTRUCTIONS,
+  PERF_COUNT_HW_CACHE_MISSES,
+  PERF_COUNT_HW_BRANCH_MISSES
+};
+
+bool PerfCounters::open() {
+  close();
+  for (int e = 0; e < EVENTS; e++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = PERF_TYPE_HARDWARE;
+    attr.config = event_config[e];
+    attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    attr.disabled = leader == -1;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+    if (fd == -1) {
+      if (err.empty()) err = std::string(name((Event)e)) + ": " + strerror(errno);
+      continue;
+    }
+    fds[e] = fd;
+    if (leader == -1) leader = fd;
+    opened[n_open++] = (Event)e;
+  }
+  if (leader == -1) return false;
+
+  err.clear();
+  if (ioctl(leader, PERF_EVENT_IOC_ENABLE, 0) == -1) {
+    err = strerror(errno);
+    close();
+    return false;
+  }
+  return true;
+}
+
+void PerfCounters::read(uint64_t *values) {
+  // nr, time enabled, time running, then one value per event.
+  uint64_t buf[3 + EVENTS];
+  if (leader == -1 || ::read(leader, buf, sizeof(buf)) < (ssize_t)(3 * sizeof(uint64_t))) {
+    for (int i = 0; i < n_open; i++) values[i] = 0;
+    return;
+  }
+  time_enabled = buf[1];
+  time_running = buf[2];
+  for (int i = 0; i < n_open; i++) values[i] = buf[3 + i];
+}
+#else
+bool PerfCounters::open() {
+  err = "hardware counters need Linux perf_event_open";
+  return false;
+}
+
+void PerfCounters::read(uint64_t *values) {
+}
+#endif
+
+void PerfCounters::close() {
+  for (int e = 0; e < EVENTS; e++) {
+    if (fds[e] != -1) ::close(fds[e]);
+    fds[e] = -1;
+  }
+  leader = -1;
+  n_open = 0;
+}
+
+int PerfCounters::index(Event e) const {
+  for (int i = 0; i < n_open; i++) {
+    if (opened[i] == e) return i;
+  }
+  return -1;
+}
+
+const char *PerfCounters::name(Event e) {
+  static const char *names[EVENTS] = { "cycles", "instructions", "cache-misses", "branch-misses" };
+  return names[e];
+}
@@ -0,0 +1,61 @@
+#ifndef PERF_COUNTERS_HH_INCLUDED
+#define PERF_COUNTERS_HH_INCLUDED
+
+#include <string>
+#include <GHMM/ghmm.hh>
+
+// Hardware event counts for the calling thread, from Linux
+// perf_event_open(2): cycles, instructions, cache misses and branch
+// misses, in user mode only. The events are opened as one group, so
+// they are counted over the same intervals and read with one system
+// call. Events the kernel or CPU does not offer are left out; when
+// none can be opened (no PMU, a container's seccomp filter,
+// perf_event_paranoid), open() fails with the reason in error() and
+// the counter reads as zero. Counters belong to the thread that opened
+// them.
+class PerfCounters : public GHMM::EventCounter {
+  PerfCounters(const PerfCounters &);
+  PerfCounters &operator=(const PerfCounters &);
+
+public:
+  enum Event { CYCLES, INSTRUCTIONS, CACHE_MISSES, BRANCH_MISSES, EVENTS };
+
+protected:
+  int leader;
+  int fds[EVENTS];
+  // the events opened, in group order.
+  int n_open;
+  Event opened[EVENTS];
+  // time the group was enabled and actually counting, at the last
+  // read; they differ if the kernel had to share the counters.
+  uint64_t time_enabled, time_running;
+  std::string err;
+
+public:
+  PerfCounters();
+  ~PerfCounters();
+
+  bool open();
+  void close();
+
+  int count() const {
+    return n_open;
+  }
+  Event event(int i) const {
+    return opened[i];
+  }
+  // index of e among the counts read, or -1 if it is not counted.
+  int index(Event e) const;
+  void read(uint64_t *values);
+
+  bool multiplexed() const {
+    return time_running < time_enabled;
+  }
+  const std::string &error() const {
+    return err;
+  }
+
+  static const char *name(Event e);
+};
+
+#endif
@@ -0,0 +1,292 @@
+#ifndef PIPELINE_HH_INCLUDED
+#define PIPELINE_HH_INCLUDED
+
+#include <pthread.h>
+#include <stdint.h>
+#include <time.h>
+#include <deque>
+#include <vector>
+
+class Mutex {
+  Mutex(const Mutex &);
+  Mutex &operator=(const Mutex &);
+
+public:
+  pthread_mutex_t m;
+
+  Mutex() { pthread_mutex_init(&m, NULL); }
+  ~Mutex() { pthread_mutex_destroy(&m); }
+
+  void lock() { pthread_mutex_lock(&m); }
+  void unlock() { pthread_mutex_unlock(&m); }
+};
+
+class Lock {
+  Lock(const Lock &);
+  Lock &operator=(const Lock &);
+
+  Mutex &mutex;
+
+public:
+  Lock(Mutex &m) : mutex(m) { mutex.lock(); }
+  ~Lock() { mutex.unlock(); }
+};
+
+class Condition {
+  Condition(const Condition &);
+  Condition &operator=(const Condition &);
+
+public:
+  pthread_cond_t c;
+
+  Condition() { pthread_cond_init(&c, NULL); }
+  ~Condition() { pthread_cond_destroy(&c); }
+
+  void wait(Mutex &m) { pthread_cond_wait(&c, &m.m); }
+  // false if seconds went by first.
+  bool wait(Mutex &m, double seconds) {
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    long ns = ts.tv_nsec + (long)((seconds - (long)seconds) * 1e9);
+    ts.tv_sec += (long)seconds + ns / 1000000000;
+    ts.tv_nsec = ns % 1000000000;
+    return pthread_cond_timedwait(&c, &m.m, &ts) == 0;
+  }
+  void signal() { pthread_cond_signal(&c); }
+  void broadcast() { pthread_cond_broadcast(&c); }
+};
+
+// A fixed capacity FIFO joining two pipeline stages. push() blocks
+// while the queue is full, pop() blocks while it is empty. Once every
+// producer has called done() (or anyone calls close()), pop() drains
+// what is left and then returns false.
+template<typename T>
+class BoundedQueue {
+  BoundedQueue(const BoundedQueue &);
+  BoundedQueue &operator=(const BoundedQueue &);
+
+  std::deque<T> items;
+  size_t capacity;
+  int producers;
+  bool closed;
+  Mutex mutex;
+  Condition not_empty, not_full;
+
+public:
+  BoundedQueue(size_t cap, int prod = 1) : items(), capacity(cap ? cap : 1), producers(prod), closed(false) {
+  }
+
+  void push(const T &t) {
+    Lock l(mutex);
+    while (items.size() >= capacity && !closed) not_full.wait(mutex);
+    items.push_back(t);
+    not_empty.signal();
+  }
+
+  bool pop(T &t) {
+    Lock l(mutex);
+    while (items.empty() && !closed) not_empty.wait(mutex);
+    if (items.empty()) return false;
+    t = items.front();
+    items.pop_front();
+    not_full.signal();
+    return true;
+  }
+
+  void close() {
+    Lock l(mutex);
+    closed = true;
+    not_empty.broadcast();
+    not_full.broadcast();
+  }
+
+  // called by each producer when it has nothing more to push.
+  void done() {
+    Lock l(mutex);
+    if (--producers > 0) return;
+    closed = true;
+    not_empty.broadcast();
+    not_full.broadcast();
+  }
+};
+
+#if defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 1))
+inline int atomicAdd(volatile int *p, int n) {
+  return __sync_add_and_fetch(p, n);
+}
+inline uint64_t atomicAdd(volatile uint64_t *p, uint64_t n) {
+  return __sync_add_and_fetch(p, n);
+}
+inline void memoryBarrier() {
+  __sync_synchronize();
+}
+#else
+inline int atomicAdd(volatile int *p, int n) {
+  static Mutex mutex;
+  Lock l(mutex);
+  return *p += n;
+}
+inline uint64_t atomicAdd(volatile uint64_t *p, uint64_t n) {
+  static Mutex mutex;
+  Lock l(mutex);
+  return *p += n;
+}
+inline void memoryBarrier() {
+  static Mutex mutex;
+  Lock l(mutex);
+}
+#endif
+
+// read a counter that other threads update with atomicAdd().
+inline uint64_t atomicRead(const volatile uint64_t *p) {
+  return atomicAdd(const_cast<volatile uint64_t *>(p), 0);
+}
+
+class Semaphore {
+  Semaphore(const Semaphore &);
+  Semaphore &operator=(const Semaphore &);
+
+  int count;
+  Mutex mutex;
+  Condition available;
+
+public:
+  Semaphore(int n) : count(n) {
+  }
+
+  void acquire() {
+    Lock l(mutex);
+    while (count <= 0) available.wait(mutex);
+    count--;
+  }
+  void release() {
+    Lock l(mutex);
+    count++;
+    available.signal();
+  }
+};
+
+// Tasks spread over one deque per worker. A worker takes from the back
+// of its own deque and, when that is empty, steals from the front of
+// the others, where the oldest (and, if tasks are split in halves,
+// largest) work sits. Workers may push new tasks while running one;
+// each popped task must be matched by a call to finish(). pop()
+// returns false once close() has been called and every task is
+// finished.
+template<typename T>
+class WorkStealingQueue {
+  WorkStealingQueue(const WorkStealingQueue &);
+  WorkStealingQueue &operator=(const WorkStealingQueue &);
+
+  struct Deque {
+    Mutex mutex;
+    std::deque<T> items;
+  };
+
+  std::vector<Deque *> deques;
+  int queued, outstanding;
+  bool closed;
+  Mutex mutex;
+  Condition changed;
+
+  bool take(int w, T &t, bool own) {
+    Deque &d(*deques[w]);
+    Lock l(d.mutex);
+    if (d.items.empty()) return false;
+    if (own) {
+      t = d.items.back();
+      d.items.pop_back();
+    } else {
+      t = d.items.front();
+      d.items.pop_front();
+    }
+    return true;
+  }
+
+public:
+  WorkStealingQueue(int workers) : deques(), queued(0), outstanding(0), closed(false) {
+    for (int w = 0; w < workers; w++) deques.push_back(new Deque);
+  }
+  ~WorkStealingQueue() {
+    for (size_t w = 0; w < deques.size(); w++) delete deques[w];
+  }
+
+  int workers() const {
+    return deques.size();
+  }
+
+  void push(int w, const T &t) {
+    {
+      Lock l(mutex);
+      queued++;
+      outstanding++;
+      changed.signal();
+    }
+    Deque &d(*deques[w]);
+    Lock l(d.mutex);
+    d.items.push_back(t);
+  }
+
+  bool pop(int w, T &t) {
+    while (1) {
+      bool got = take(w, t, true);
+      for (int i = 1; !got && i < (int)deques.size(); i++) {
+        got = take((w + i) % deques.size(), t, false);
+      }
+
+      Lock l(mutex);
+      if (got) {
+        queued--;
+        return true;
+      }
+      // a task counted in queued may not have reached its deque yet,
+      // so only sleep when nothing is queued at all.
+      while (!queued && !(closed && !outstanding)) changed.wait(mutex);
+      if (!queued && closed && !outstanding) return false;
+    }
+  }
+
+  void finish() {
+    Lock l(mutex);
+    if (--outstanding == 0 && closed) changed.broadcast();
+  }
+
+  void close() {
+    Lock l(mutex);
+    closed = true;
+    changed.broadcast();
+  }
+};
+
+// Run obj->run() on a new thread.
+template<typename T>
+class Thread {
+  Thread(const Thread &);
+  Thread &operator=(const Thread &);
+
+  pthread_t thread;
+  bool started;
+
+  static void *start(void *arg) {
+    static_cast<T *>(arg)->run();
+    return NULL;
+  }
+
+public:
+  Thread() : thread(), started(false) {
+  }
+  ~Thread() {
+    join();
+  }
+
+  bool start(T *obj) {
+    started = pthread_create(&thread, NULL, &Thread::start, obj) == 0;
+    return started;
+  }
+  void join() {
+    if (started) pthread_join(thread, NULL);
+    started = false;
+  }
+};
+
+#endif
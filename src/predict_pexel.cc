@@ -19,11 +19,22 @@
 // CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 // WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "predict_pexel.hh"
+#include "fasta_reader.hh"
+#include "pipeline.hh"
+#include "hit_writer.hh"
+#include "fasta_index.hh"
+#include "seq_db.hh"
+#include "output_buffer.hh"
+#include "column_team.hh"
+#include "signal_sim.hh"
+#include "null_table.hh"
+#include "run_stats.hh"
+#include "perf_counters.hh"
+#include "model_file.hh"
 
 #include <iostream>
 #include <sstream>
 #include <vector>
-#include <list>
 #include <fstream>
 
 #include <GHMM/string_funcs.hh>
@@ -38,441 +49,1058 @@
 #include <vector>
 #include <string>
 #include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/stat.h>
 
-#define BLOCK_SIZE 1024
+static const struct option options[] = {
+  { "input",             required_argument,          0,            'i' },
+  { "output",            required_argument,          0,            'o' },
+  { "RLE-threshold",     required_argument,          0,            'R' },
+  { "KLD-threshold",     required_argument,          0,            'K' },
+  { "no-RLD",            no_argument,                0,            'r' },
+  { "no-KLD",            no_argument,                0,            'k' },
+  { "model",             required_argument,          0,            'm' },
+  { "threads",           required_argument,          0,            't' },
+  { "queue-depth",       required_argument,          0,            'Q' },
+  { "unsorted",          no_argument,                0,            'u' },
+  { "top",               required_argument,          0,            'T' },
+  { "sort-memory",       required_argument,          0,            'S' },
+  { "index",             no_argument,                0,            'I' },
+  { "shard",             required_argument,          0,            's' },
+  { "merge",             no_argument,                0,            'M' },
+  { "column-threads",    required_argument,          0,            'C' },
+  { "column-min",        required_argument,          0,            'L' },
+  { "simulate",          required_argument,          0,            'g' },
+  { "seed",              required_argument,          0,            'e' },
+  { "calibrate",         required_argument,          0,            'c' },
+  { "null-model",        required_argument,          0,            'B' },
+  { "null-samples",      required_argument,          0,            'n' },
+  { "null",              required_argument,          0,            'p' },
+  { "db-size",           required_argument,          0,            'z' },
+  { "profile",           optional_argument,          0,            'P' },
+  { "perf",              no_argument,                0,            'H' },
+  { "progress",          optional_argument,          0,            'v' },
+  { "summary",           optional_argument,          0,            'J' },
+  { 0,                   0,                          0,            0   }
+};
 
-template<typename OutputIterator>
-static inline void addSeq(OutputIterator &out,
-                          const std::string &name,
-                          const std::vector<char *> &seq,
-                          int seq_len) {
-  std::string s;
-  s.reserve(seq_len);
+// append the traceback as [state:residues]... segments, first to
+// last, each under the name of shown[state]; runs of segments shown
+// as the same state are joined. segments is scratch space, kept by
+// the caller so it is only allocated once.
+static void genParse(OutputBuffer &out, const char *sequence, size_t length, const GHMM::Model &model, const std::vector<int> &shown, const GHMM::Traceback *tbp, std::vector<const GHMM::Traceback *> &segments) {
+  size_t pos = length;
 
-  for (int i = 0; i < seq_len; i += BLOCK_SIZE) {
-    s.append(seq[i / BLOCK_SIZE], std::min(BLOCK_SIZE, seq_len - i));
+  segments.clear();
+  for (; tbp != NULL; tbp = tbp->prev.ptr()) {
+    segments.push_back(tbp);
+    pos -= tbp->length;
+  }
+  for (int i = segments.size() - 1; i >= 0; i--) {
+    int state = shown[segments[i]->state];
+    size_t len = segments[i]->length;
+    while (i > 0 && shown[segments[i - 1]->state] == state) len += segments[--i]->length;
+    out.append('[');
+    out.append(model.stateName(state));
+    out.append(':');
+    out.append(sequence + pos, len);
+    out.append(']');
+    pos += len;
   }
-  assert(s.size() ==(unsigned int)seq_len);
-  *out++ = std::make_pair(name, s);
 }
 
-static inline void addChar(std::vector<char *> &seq,
-                           int &seq_len,
-                           int &seq_size,
-                           char c) {
-  if (!isspace(c)) {
-    while (seq_len >= seq_size) {
-      seq.push_back(new char[BLOCK_SIZE]);
-      seq_size += BLOCK_SIZE;
+void usage(const char *progname) {
+  std::cout << "Usage: " << progname << " [arguments]" << std::endl;
+  std::cout << "\
+\n\
+--input=file            -i file        read sequences from file (-:stdin);\n\
+                                       gzip and BGZF input is detected and\n\
+                                       decompressed, and databases written\n\
+                                       by exportpred-pack are mapped and\n\
+                                       scored directly\n\
+--output=file           -o file        write results to file (-:stdout)\n\
+--RLE-threshold=float   -R float       RLE threshold for positive prediction\n\
+                                       (default: 4.3)\n\
+--KLD-threshold=float   -K float       KLD threshold for positive prediction\n\
+                                       (default: 0.0)\n\
+--no-RLE                -r             turn off RLE prediction\n\
+--no-KLD                -k             turn off KLD prediction\n\
+--model=spec            -m spec        score with model variant spec; may be\n\
+                                       given more than once to score every\n\
+                                       sequence under several variants in a\n\
+                                       single pass. spec is a comma separated\n\
+                                       list of: v1 v2 ss signalp haldar\n\
+                                       rle no-rle kld no-kld (default: v2),\n\
+                                       or file=path to load a model file\n\
+                                       written by exportpred-train; add\n\
+                                       trim=p to drop the longest lengths\n\
+                                       of histogram states with total\n\
+                                       probability at most p, and tail=n\n\
+                                       to keep n explicit lengths and\n\
+                                       model longer ones with a geometric\n\
+                                       tail. the error these introduce is\n\
+                                       reported on stderr\n\
+--threads=n             -t n           number of predictor threads; reading,\n\
+                                       prediction and output overlap, and\n\
+                                       BGZF blocks are inflated in parallel\n\
+                                       (default: 1)\n\
+--queue-depth=n         -Q n           batches queued between stages; bounds\n\
+                                       memory use (default: 2 * threads)\n\
+--unsorted              -u             write hits in the order they are found,\n\
+                                       rather than sorted by score\n\
+--top=n                 -T n           only write the n best hits of each\n\
+                                       class\n\
+--sort-memory=MB        -S MB          memory for sorting hits before runs\n\
+                                       are spilled to $TMPDIR (default: 256)\n\
+--index                 -I             write a .fai index for each input and\n\
+                                       exit\n\
+--shard=i/N             -s i/N         only score shard i (counting from 0)\n\
+                                       of N residue balanced shards of each\n\
+                                       input; the .fai index is built if it\n\
+                                       is missing or stale\n\
+--merge                 -M             inputs are results from --shard runs;\n\
+                                       combine them as a single run would\n\
+                                       (give the same --model options)\n\
+--column-threads=n      -C n           threads sharing the work of each\n\
+                                       sequence position, per predictor;\n\
+                                       cuts the latency of single long\n\
+                                       sequences (default: 1)\n\
+--column-min=n          -L n           only share sequences of at least n\n\
+                                       residues (default: 2000)\n\
+--simulate=n            -g n           also score n signal sequences,\n\
+                                       simulated in memory from the first\n\
+                                       --model variant and named sim<i>\n\
+                                       (as simulate_signalseqs --fasta\n\
+                                       writes them); --shard splits them\n\
+--seed=n                -e n           seed for --simulate and --calibrate\n\
+                                       (default: taken from the time, and\n\
+                                       reported)\n\
+--calibrate=file        -c file        instead of predicting, score null\n\
+                                       sequences made from the inputs and\n\
+                                       write their score distributions, by\n\
+                                       model variant, class and length, to\n\
+                                       file for use with --null\n\
+--null-model=m          -B m           null sequences for --calibrate:\n\
+                                       shuffle (the residues of each input\n\
+                                       after the first) or background\n\
+                                       (drawn from the model's background\n\
+                                       branch, as long as each input)\n\
+                                       (default: shuffle)\n\
+--null-samples=n        -n n           null sequences per input (default: 1)\n\
+--null=file             -p file        add the p-value of each hit under\n\
+                                       the null distributions in file, after\n\
+                                       its score\n\
+--db-size=n             -z n           give E-values for n sequences rather\n\
+                                       than p-values\n\
+--profile[=file]        -P[file]       count the work done and time spent\n\
+                                       in each model state, and write it by\n\
+                                       variant to file (default: stderr)\n\
+--perf                  -H             with --profile, also count cycles,\n\
+                                       instructions, cache and branch misses\n\
+                                       (Linux hardware counters, if there\n\
+                                       are any); per state counts leave out\n\
+                                       sequences shared by --column-threads\n\
+--progress[=n]          -v[n]          every n seconds (default: 10), report\n\
+                                       progress and an ETA on stderr\n\
+--summary[=file]        -J[file]       at the end, write a JSON summary of\n\
+                                       the run (time by phase, peak memory,\n\
+                                       allocations, slowest sequences) to\n\
+                                       file (default: stderr)\n\
+\n\
+";
+}
+
+struct ModelVariant {
+  PEXELModelOptions opts;
+  std::string label;
+  GHMM::Model::Ptr model;
+  int a_tail, b_tail, c_met, c_tail;
+  // the emissions of c-met and c-tail, for background null sequences;
+  // NULL unless the state draws its symbols independently.
+  const GHMM::EMISSION::Stateless *c_met_emit, *c_tail_emit;
+  // the state each state's segments are written as; the parts of a
+  // state split by tail= are written as the state.
+  std::vector<int> shown;
+  // predictors that share the model. it is frozen from construction
+  // on, so no predictor can exist before it is, and may only be
+  // thawed once they are all gone.
+  volatile int users;
+
+  ModelVariant(const PEXELModelOptions &o) : opts(o), label(o.name()), model(makePEXELmodel(o)), shown(), users(0) {
+    for (int j = 0; j < model->stateCount(); j++) {
+      int base = model->stateNumber(ModelFile::baseName(model->stateName(j)));
+      shown.push_back(base >= 0 ? base : j);
+    }
+    a_tail = model->stateNumber("a-tail");
+    b_tail = model->stateNumber("b-tail");
+    c_met = model->stateNumber("c-met");
+    c_tail = model->stateNumber("c-tail");
+    // scores are relative to the background branch, which model files
+    // must keep.
+    if (c_met < 0 || c_tail < 0) {
+      std::cerr << label << ": the model has no c-met and c-tail states" << std::endl;
+      exit(1);
     }
-    seq[seq_len / BLOCK_SIZE][seq_len % BLOCK_SIZE] = c;
-    seq_len++;
+    c_met_emit = dynamic_cast<const GHMM::EMISSION::Stateless *>(model->state(c_met).ptr());
+    c_tail_emit = dynamic_cast<const GHMM::EMISSION::Stateless *>(model->state(c_tail).ptr());
+    // shared read only by every predictor thread.
+    model->freeze();
   }
-}
+  ~ModelVariant() {
+    if (users) {
+      std::cerr << label << ": model released while " << users << " predictors use it" << std::endl;
+      abort();
+    }
+    model->thaw();
+  }
+};
 
-template<typename OutputIterator>
-void readFasta(std::istream &in,
-               OutputIterator out,
-               std::string (*name_xform)(const std::string &)) {
-  std::string name = "";
-  int c;
-  std::vector<char *> seq;
-
-  std::string l;
-  int seq_len = 0;
-  int seq_size = 0;
-  int state = 0;
-
-  while ((c = in.get()) != EOF) {
-    switch (state) {
-    case 0: {
-      // looking for name
-      if (c == '>') {
-        state = 1;
-        name = "";
-      }
-      break;
+// A batch of records from the reader. If the reader's views would
+// not outlive the next read, the record text is copied into text.
+// Records from a packed database are already encoded, and
+// residue_text holds the text each was packed from; others are
+// encoded by reader, with the models' alphabet. remaining counts the
+// records not yet predicted; whoever finishes the last one frees the
+// batch. first_index numbers the records across the run.
+struct Batch {
+  const FastaReader *reader;
+  int remaining;
+  uint64_t first_index;
+  std::vector<FastaRecord> records;
+  std::vector<char> text;
+  std::vector<const char *> residue_text;
+};
+
+// A range of records in a batch: the unit of work for the predictors.
+// Ranges are split in two, by residue count, until a single record is
+// left, and idle predictors steal the outstanding halves, so one very
+// long sequence does not hold up the records queued behind it.
+struct RecordRange {
+  Batch *batch;
+  size_t begin, end;
+
+  RecordRange() : batch(NULL), begin(0), end(0) {
+  }
+  RecordRange(Batch *b, size_t i, size_t j) : batch(b), begin(i), end(j) {
+  }
+
+  RecordRange split() {
+    size_t total = 0, half = 0, mid = begin + 1;
+    for (size_t r = begin; r < end; r++) total += batch->records[r].seq_len;
+    for (half = batch->records[begin].seq_len; mid < end - 1 && 2 * half < total; mid++) {
+      half += batch->records[mid].seq_len;
     }
-    case 1: {
-      // name
-      if (c == '\n') {
-        state = 2;
-        if (name_xform) name = name_xform(name);
-      } else {
-        name.push_back(c);
-      }
-      break;
+    RecordRange tail(batch, mid, end);
+    end = mid;
+    return tail;
+  }
+};
+
+// Formatted hits on their way to the writer.
+struct Hit {
+  int variant;
+  bool kld;
+  double score;
+  size_t begin, length;
+};
+
+struct HitBatch {
+  std::vector<Hit> hits;
+  OutputBuffer hit_text;
+};
+
+// How far a stage has got: records, their raw sequence bytes (as
+// read, newlines and all) and residues. Updated by the stage's thread
+// and read by the progress reporter, both with atomic operations; the
+// reporter only needs figures that are roughly current, so the three
+// need not agree.
+struct Progress {
+  volatile uint64_t sequences, bytes, residues;
+
+  Progress() : sequences(0), bytes(0), residues(0) {
+  }
+
+  void add(uint64_t n_sequences, uint64_t n_bytes, uint64_t n_residues) {
+    atomicAdd(&sequences, n_sequences);
+    atomicAdd(&bytes, n_bytes);
+    atomicAdd(&residues, n_residues);
+  }
+  // add o, which another thread may be updating, to this.
+  void merge(const Progress &o) {
+    add(atomicRead(&o.sequences), atomicRead(&o.bytes), atomicRead(&o.residues));
+  }
+};
+
+typedef WorkStealingQueue<RecordRange> TaskQueue;
+typedef BoundedQueue<HitBatch *> HitQueue;
+
+#define BATCH_RECORDS 256
+#define BATCH_BYTES (1024 * 1024)
+#define HIT_BATCH_SIZE 256
+
+class ReadStage {
+  const std::vector<std::string> &inputs;
+  const GHMM::UTIL::Alphabet &alphabet;
+  int threads;
+  int shard_i, shard_n;
+  TaskQueue &tasks;
+  Semaphore &in_flight;
+  int next_worker;
+
+  // readers stay open until the pipeline is finished, as batches may
+  // hold views into their mappings.
+  std::vector<FastaReader *> readers;
+  std::vector<SeqDB *> dbs;
+
+  const SignalSimulator *simulator;
+  uint64_t sim_count;
+  uint64_t n_submitted;
+
+  // input sizes, as fractions of the total, for position; empty if
+  // some input's size is unknown.
+  std::vector<double> weights;
+  double weight_done;
+  off_t range_begin, range_end;
+
+  // f is the fraction of the current input read, or -1 if unknown.
+  void setPosition(double f) {
+    position = weights.size() && f >= 0 ? weight_done + weights[current] * f : -1.0;
+  }
+
+  void readDB(const std::string &path) {
+    SeqDB *db = new SeqDB;
+    size_t first = 0, last;
+
+    dbs.push_back(db);
+    if (!db->open(path.c_str())) {
+      std::cerr << "could not open " << path << ": " << db->error() << std::endl;
+      exit(1);
+    }
+    if (alphabet != FastaReader::residueAlphabet()) {
+      std::cerr << path << ": packed sequences are residue codes, which the model does not use" << std::endl;
+      exit(1);
     }
-    case 2: {
-      // sequence, first char of column
-      if (c == '>') {
-        if (seq_len) addSeq(out, name, seq, seq_len);
-        seq_len = 0;
-        state = 1;
-        name = "";
-      } else if (c != '\n') {
-        addChar(seq, seq_len, seq_size, c);
-        state = 3;
+    last = db->size();
+    if (shard_n) db->shard(shard_i, shard_n, first, last);
+
+    Batch *batch = NULL;
+    size_t bytes = 0;
+    for (size_t i = first; i < last; i++) {
+      if (batch == NULL) {
+        batch = new Batch;
+        batch->reader = NULL;
+        bytes = 0;
+      }
+      FastaRecord rec;
+      rec.name = db->name(i, rec.name_len);
+      rec.seq = (const char *)db->residues(i, rec.seq_len);
+      if (!db->verify(i)) {
+        std::cerr << path << ": record " << std::string(rec.name, rec.name_len) << " is corrupt" << std::endl;
+        exit(1);
+      }
+      rec.offset = 0;
+      batch->records.push_back(rec);
+      size_t text_len;
+      batch->residue_text.push_back(db->text(i, text_len));
+      bytes += rec.seq_len;
+      if (batch->records.size() >= BATCH_RECORDS || bytes >= BATCH_BYTES) {
+        setPosition((double)(i + 1 - first) / (last - first));
+        submit(batch);
+        batch = NULL;
       }
-      break;
     }
-    case 3: {
-      // sequence, not first char of column
-      if (c == '\n') {
-        state = 2;
-      } else {
-        addChar(seq, seq_len, seq_size, c);
+    if (batch != NULL) submit(batch);
+
+    std::cerr << last - first << " sequences read from " << path;
+    if (shard_n) std::cerr << " (shard " << shard_i << "/" << shard_n << ")";
+    std::cerr << std::endl;
+  }
+
+  void readSimulated() {
+    uint64_t first = 0, last = sim_count;
+    if (shard_n) {
+      first = sim_count * shard_i / shard_n;
+      last = sim_count * (shard_i + 1) / shard_n;
+    }
+
+    std::vector<unsigned char> codes;
+    OutputBuffer name;
+    Batch *batch = NULL;
+    size_t bytes = 0;
+    for (uint64_t i = first; i < last; i++) {
+      if (batch == NULL) {
+        batch = new Batch;
+        batch->reader = NULL;
+        bytes = 0;
+      }
+      simulator->generate(i, codes);
+      name.clear();
+      SignalSimulator::appendName(name, i);
+
+      // offsets into text for now, as in addRecord().
+      FastaRecord rec;
+      rec.name = (const char *)batch->text.size();
+      rec.name_len = name.size();
+      batch->text.insert(batch->text.end(), name.data(), name.data() + name.size());
+      rec.seq = (const char *)batch->text.size();
+      rec.seq_len = codes.size();
+      batch->text.insert(batch->text.end(), codes.begin(), codes.end());
+      rec.offset = 0;
+      batch->records.push_back(rec);
+      bytes += rec.seq_len;
+      if (batch->records.size() >= BATCH_RECORDS || bytes >= BATCH_BYTES) {
+        if (inputs.empty()) position = (double)(i + 1 - first) / (last - first);
+        resolveText(batch);
+        submit(batch);
+        batch = NULL;
       }
-      break;
     }
+    if (batch != NULL) {
+      resolveText(batch);
+      submit(batch);
     }
+
+    std::cerr << last - first << " sequences simulated";
+    if (shard_n) std::cerr << " (shard " << shard_i << "/" << shard_n << ")";
+    std::cerr << std::endl;
   }
 
-  if (seq_len) addSeq(out, name, seq, seq_len);
+  // hand the batch to the predictors, one worker's deque after
+  // another. at most in_flight batches are held at once.
+  void submit(Batch *batch) {
+    PhaseClock::Phase prev = clock.enter(PhaseClock::IDLE);
+    in_flight.acquire();
+    clock.enter(prev);
+    batch->remaining = batch->records.size();
+    batch->first_index = n_submitted;
+    n_submitted += batch->records.size();
+
+    uint64_t bytes = 0;
+    for (size_t i = 0; i < batch->records.size(); i++) bytes += batch->records[i].seq_len;
+    submitted.add(batch->records.size(), bytes, 0);
+    tasks.push(next_worker, RecordRange(batch, 0, batch->records.size()));
+    next_worker = (next_worker + 1) % tasks.workers();
+  }
 
-  for (std::vector<char *>::iterator i = seq.begin(); i != seq.end(); ++i) {
-    delete [] *i;
+  void addRecord(Batch *batch, const FastaReader &reader, const FastaRecord &rec, size_t &bytes) {
+    batch->records.push_back(rec);
+    bytes += rec.seq_len;
+    if (!reader.stable()) {
+      // store offsets for now; pointers are fixed up in flush().
+      FastaRecord &r(batch->records.back());
+      r.name = (const char *)batch->text.size();
+      batch->text.insert(batch->text.end(), rec.name, rec.name + rec.name_len);
+      r.seq = (const char *)batch->text.size();
+      batch->text.insert(batch->text.end(), rec.seq, rec.seq + rec.seq_len);
+    }
+  }
+
+  // seek the reader to this process's share of the file.
+  void selectShard(FastaReader &reader, const std::string &path) {
+    FastaIndex index;
+    size_t first, last;
+
+    if (!reader.stable()) {
+      std::cerr << "--shard needs an uncompressed regular file: " << path << std::endl;
+      exit(1);
+    }
+    index.load(path, reader);
+    index.shard(shard_i, shard_n, first, last);
+
+    off_t begin = first < index.entries.size() ? reader.recordStart(index.entries[first].offset) : reader.size();
+    off_t end = last < index.entries.size() ? reader.recordStart(index.entries[last].offset) : reader.size();
+    if (begin == -1 || end == -1 || !reader.setRange(begin, end)) {
+      std::cerr << "bad index for " << path << std::endl;
+      exit(1);
+    }
+    range_begin = begin;
+    range_end = end;
   }
-}
 
+  // turn the text offsets of records copied into the batch into
+  // pointers, now that the text will not move.
+  static void resolveText(Batch *batch) {
+    const char *base = batch->text.size() ? &batch->text[0] : NULL;
+    for (size_t i = 0; i < batch->records.size(); i++) {
+      FastaRecord &r(batch->records[i]);
+      r.name = base + (size_t)r.name;
+      r.seq = base + (size_t)r.seq;
+    }
+  }
 
+  void flush(Batch *&batch, const FastaReader &reader) {
+    if (reader.stable() && range_end > range_begin) {
+      const FastaRecord &last(batch->records.back());
+      setPosition((double)(last.offset - range_begin) / (range_end - range_begin));
+    } else {
+      setPosition(-1.0);
+    }
+    if (!reader.stable()) resolveText(batch);
+    submit(batch);
+    batch = NULL;
+  }
 
-#if VERSION == 1
+public:
+  // for the progress reporter: what has been handed to the
+  // predictors, and how far through the inputs that is (-1 if it
+  // cannot be told, as for pipes and compressed input).
+  Progress submitted;
+  volatile double position;
+  volatile bool finished;
+  int current;
+
+  PhaseClock clock;
+  AllocationCounts allocations;
+
+  ReadStage(const std::vector<std::string> &i, const GHMM::UTIL::Alphabet &a, int t, int si, int sn, TaskQueue &q, Semaphore &f, const SignalSimulator *sim, uint64_t n_sim) :
+    inputs(i), alphabet(a), threads(t), shard_i(si), shard_n(sn), tasks(q), in_flight(f), next_worker(0), readers(), dbs(), simulator(sim), sim_count(n_sim), n_submitted(0),
+    weights(), weight_done(0.0), range_begin(0), range_end(0), submitted(), position(-1.0), finished(false), current(0), clock(), allocations() {
+  }
+  ~ReadStage() {
+    for (size_t i = 0; i < readers.size(); i++) delete readers[i];
+    for (size_t i = 0; i < dbs.size(); i++) delete dbs[i];
+  }
 
-static int a_spacer_raw_distrib[] = {
-  1, 2, 3, 6, 8, 8, 9, 10, 10, 11, 11, 12, 13, 13, 13, 13, 14, 14,
-  14, 14, 15, 15, 15, 16, 16, 17, 17, 17, 17, 17, 17, 18, 18, 18, 18,
-  18, 18, 18, 18, 18, 18, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19,
-  19, 19, 19, 19, 19, 19, 19, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20,
-  20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 21, 21, 21, 21, 21, 21, 21,
-  21, 22, 22, 22, 22, 22, 22, 22, 23, 23, 23, 23, 23, 23, 23, 24, 24,
-  24, 24, 24, 24, 24, 24, 24, 25, 25, 25, 25, 25, 25, 25, 25, 26, 26,
-  26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 27, 27,
-  27, 28, 29, 29, 29, 29, 29, 30, 31, 31, 31, 31, 31, 32, 32, 33, 35,
-  37, 41, 43, 48, 53, 61, 89, 110, 129, 166, 182, 202, 209, 324, 495
+  void run() {
+    clock.enter(PhaseClock::READ);
+
+    // inputs are weighted by size, so shards and simulated sequences
+    // leave position unknown.
+    double total = 0.0;
+    for (int f = 0; f < (int)inputs.size(); f++) {
+      struct stat st;
+      if (inputs[f] == "-" || stat(inputs[f].c_str(), &st) != 0 || !S_ISREG(st.st_mode)) {
+        total = 0.0;
+        break;
+      }
+      weights.push_back(st.st_size);
+      total += st.st_size;
+    }
+    if (total > 0 && !shard_n && simulator == NULL) {
+      for (int f = 0; f < (int)weights.size(); f++) weights[f] /= total;
+    } else {
+      weights.clear();
+    }
+
+    for (int f = 0; f < (int)inputs.size(); f++) {
+      current = f;
+      if (f) weight_done += weights.size() ? weights[f - 1] : 0.0;
+      if (inputs[f] != "-" && SeqDB::probe(inputs[f].c_str())) {
+        readDB(inputs[f]);
+        continue;
+      }
+
+      FastaReader *reader = new FastaReader;
+      FastaRecord rec;
+      int n_read = 0;
+      Batch *batch = NULL;
+      size_t bytes = 0;
+
+      readers.push_back(reader);
+      reader->setThreads(threads);
+      reader->setAlphabet(alphabet);
+      if (!reader->open(inputs[f].c_str())) {
+        std::cerr << "could not open " << inputs[f] << ": " << reader->error() << std::endl;
+        exit(1);
+      }
+      range_begin = 0;
+      range_end = reader->size();
+      if (shard_n) selectShard(*reader, inputs[f]);
+
+      while (reader->next(rec)) {
+        n_read++;
+        if (batch == NULL) {
+          batch = new Batch;
+          batch->reader = reader;
+          bytes = 0;
+        }
+        addRecord(batch, *reader, rec, bytes);
+        if (batch->records.size() >= BATCH_RECORDS || bytes >= BATCH_BYTES) {
+          flush(batch, *reader);
+        }
+      }
+      if (batch != NULL) flush(batch, *reader);
+      if (reader->failed()) {
+        std::cerr << "error reading " << inputs[f] << ": " << reader->error() << std::endl;
+        exit(1);
+      }
+
+      std::cerr << n_read << " sequences read from " << (inputs[f] == "-" ? "stdin" : inputs[f]);
+      if (shard_n) std::cerr << " (shard " << shard_i << "/" << shard_n << ")";
+      std::cerr << std::endl;
+    }
+    if (simulator != NULL) readSimulated();
+    tasks.close();
+    position = 1.0;
+    finished = true;
+    clock.enter(PhaseClock::IDLE);
+    allocations = AllocationCounts::thisThread();
+  }
 };
 
-#endif
-
-#if VERSION == 2
-
-static int a_spacer_raw_distrib[] = {
-  9, 12, 13, 13, 14, 14, 14, 14, 14, 14, 14, 14, 14, 14, 15, 15, 16,
-  16, 16, 17, 17, 17, 17, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18, 18,
-  18, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19, 19,
-  19, 19, 19, 19, 19, 19, 19, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20,
-  20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 20, 21,
-  21, 21, 21, 21, 21, 22, 22, 22, 23, 23, 23, 23, 23, 23, 23, 23, 23,
-  24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 24, 25, 25, 25, 25, 25, 25,
-  25, 25, 25, 25, 25, 25, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26,
-  26, 26, 26, 26, 26, 26, 26, 26, 27, 27, 27, 29, 31, 31, 31, 31, 33,
-  33
+// Settings shared by all predictors.
+struct PredictSettings {
+  double RLE_threshold, KLD_threshold;
+  int column_threads;
+  size_t column_min;
+
+  // p-values (or, given db_size, E-values) for hits.
+  const NullTable *null_table;
+  double db_size;
+
+  // calibration: score null_samples null sequences made from each
+  // input instead, and tabulate every score.
+  enum NullModel { SHUFFLE, BACKGROUND };
+  bool calibrate;
+  NullModel null_model;
+  int null_samples;
+  uint64_t seed;
+
+  bool profile;
+  // with profile: hardware events to count per thread, as opened by
+  // the main thread, or NULL.
+  const PerfCounters *perf;
+  // phase times and the slowest sequences, for --summary.
+  bool summary;
 };
 
-static int b_hydrophobic_raw_distrib[] = {
-  22, 22, 23, 23, 23, 23, 23, 23, 25, 25, 25, 25, 25, 25, 25, 25, 25,
-  25, 25, 25, 25, 25, 25, 26, 26, 26, 26, 26, 26, 26, 26, 26, 26, 27,
-  27, 27, 27, 27, 28, 29, 29, 29, 29, 29, 29, 29, 32, 37
+class PredictStage {
+  const std::vector<ModelVariant *> &variants;
+  const PredictSettings &settings;
+  bool label_variants;
+  int worker;
+  TaskQueue &tasks;
+  Semaphore &in_flight;
+  HitQueue &out;
+  HitBatch *hits;
+
+  // one workspace and one encoded copy of the sequence are shared by
+  // all model variants.
+  GHMM::Parse::Ptr parse;
+  std::vector<unsigned char> seq_raw;
+  std::vector<char> seq_text;
+  std::vector<const GHMM::Traceback *> segments;
+  std::vector<unsigned char> null_seq;
+  std::vector<int> null_draw;
+  ThreadedColumnTeam *team;
+
+  void addHit(int m, bool kld, const FastaRecord &rec, const char *sequence, size_t seq_len, double score, int tail) {
+    const ModelVariant &v(*variants[m]);
+    OutputBuffer &line(hits->hit_text);
+    size_t begin = line.size();
+    PhaseClock::Phase prev = clock.enter(PhaseClock::TRACEBACK);
+
+    line.append(rec.name, rec.name_len);
+    line.append('\t');
+    if (label_variants) {
+      line.append(v.label);
+      line.append('\t');
+    }
+    line.append(kld ? "KLD\t" : "RLE\t", 4);
+    line.append(score);
+    line.append('\t');
+    if (settings.null_table != NULL) {
+      double p = settings.null_table->pValue(2 * m + (kld ? 1 : 0), seq_len, score);
+      line.append(settings.db_size > 0 ? p * settings.db_size : p);
+      line.append('\t');
+    }
+    genParse(line, sequence, seq_len, *v.model, v.shown, parse->psi(tail, 0).ptr(), segments);
+
+    hits->hits.push_back(Hit());
+    Hit &hit(hits->hits.back());
+    hit.variant = m;
+    hit.kld = kld;
+    hit.score = score;
+    hit.begin = begin;
+    hit.length = line.size() - begin;
+    clock.enter(prev);
+  }
+
+  const unsigned char *encode(const Batch *batch, const FastaRecord &rec, size_t &seq_len) {
+    seq_len = rec.seq_len;
+    if (batch->reader == NULL) return (const unsigned char *)rec.seq;
+    if (seq_raw.size() < rec.seq_len) seq_raw.resize(rec.seq_len);
+    seq_len = batch->reader->encode(rec.seq, rec.seq_len, &seq_raw[0]);
+    return &seq_raw[0];
+  }
+
+  // RLE and KLD log odds against the background branch.
+  void score(int m, const unsigned char *codes, size_t seq_len, double &rle, double &kld) {
+    const ModelVariant &v(*variants[m]);
+    parse->setProfile(settings.profile ? &profiles[m] : NULL);
+    parse->parse(v.model, codes, codes + seq_len, team != NULL && seq_len >= settings.column_min ? team : NULL);
+
+    double alpha_bkg = parse->alpha(v.c_tail, 0);
+    rle = (v.a_tail >= 0 ? parse->alpha(v.a_tail, 0) : MATH::LOG_ZERO) - alpha_bkg;
+    kld = (v.b_tail >= 0 ? parse->alpha(v.b_tail, 0) : MATH::LOG_ZERO) - alpha_bkg;
+  }
+
+  // null sequence r of input index: the input with all but its first
+  // residue shuffled, or background residues of the same length.
+  void makeNull(const unsigned char *codes, size_t seq_len, uint64_t index, int r) {
+    MATH::Random rng(settings.seed, index * settings.null_samples + r);
+
+    null_seq.resize(seq_len);
+    if (settings.null_model == PredictSettings::SHUFFLE) {
+      std::copy(codes, codes + seq_len, null_seq.begin());
+      for (size_t k = seq_len - 1; k > 1; k--) {
+        size_t j = 1 + (size_t)(rng.uniform() * k);
+        std::swap(null_seq[k], null_seq[j]);
+      }
+    } else {
+      const ModelVariant &v(*variants[0]);
+      null_draw.clear();
+      v.c_met_emit->randSequence(null_draw, 1, rng);
+      v.c_tail_emit->randSequence(null_draw, seq_len - 1, rng);
+      std::copy(null_draw.begin(), null_draw.end(), null_seq.begin());
+    }
+  }
+
+  // both return the number of residues scored.
+  size_t calibrate(Batch *batch, const FastaRecord &rec, uint64_t index) {
+    size_t seq_len;
+    const unsigned char *codes = encode(batch, rec, seq_len);
+    if (!seq_len) return 0;
+
+    for (int r = 0; r < settings.null_samples; r++) {
+      makeNull(codes, seq_len, index, r);
+      for (int m = 0; m < (int)variants.size(); m++) {
+        const ModelVariant &v(*variants[m]);
+        double rle, kld;
+
+        score(m, &null_seq[0], seq_len, rle, kld);
+        if (v.a_tail >= 0) null_scores.add(2 * m, seq_len, rle);
+        if (v.b_tail >= 0) null_scores.add(2 * m + 1, seq_len, kld);
+      }
+    }
+    return seq_len;
+  }
+
+  size_t predict(Batch *batch, size_t r) {
+    const FastaRecord &rec(batch->records[r]);
+    size_t seq_len;
+    const unsigned char *codes = encode(batch, rec, seq_len);
+    const char *sequence = NULL;
+
+    for (int m = 0; m < (int)variants.size(); m++) {
+      const ModelVariant &v(*variants[m]);
+      double rle, kld;
+
+      score(m, codes, seq_len, rle, kld);
+
+      bool rle_hit = rle > settings.RLE_threshold;
+      bool kld_hit = kld > settings.KLD_threshold;
+
+      // names and residue text are only materialized for hits.
+      if ((rle_hit || kld_hit) && sequence == NULL) {
+        if (batch->residue_text.size()) {
+          sequence = batch->residue_text[r];
+        } else {
+          if (seq_text.size() < rec.seq_len) seq_text.resize(rec.seq_len);
+          if (batch->reader == NULL) {
+            FastaReader::decode(codes, seq_len, &seq_text[0]);
+          } else {
+            FastaReader::strip(rec.seq, rec.seq_len, &seq_text[0]);
+          }
+          sequence = &seq_text[0];
+        }
+      }
+
+      if (rle_hit) addHit(m, false, rec, sequence, seq_len, rle, v.a_tail);
+      if (kld_hit) addHit(m, true,  rec, sequence, seq_len, kld, v.b_tail);
+    }
+    return seq_len;
+  }
+
+public:
+  // null scores seen by this predictor, when calibrating.
+  NullTable null_scores;
+  // work done by this predictor, per variant, when profiling.
+  std::vector<GHMM::Profile> profiles;
+  bool perf_multiplexed;
+
+  Progress done;
+  PhaseClock clock;
+  AllocationCounts allocations;
+  SlowSequences slowest;
+
+  PredictStage(const std::vector<ModelVariant *> &v, const PredictSettings &s, int w, TaskQueue &q, Semaphore &f, HitQueue &o) :
+    variants(v), settings(s), label_variants(v.size() > 1),
+    worker(w), tasks(q), in_flight(f), out(o), hits(new HitBatch), parse(new GHMM::Parse()), seq_raw(), seq_text(), segments(), null_seq(), null_draw(),
+    team(s.column_threads > 1 ? new ThreadedColumnTeam(s.column_threads) : NULL), null_scores(), profiles(v.size()), perf_multiplexed(false),
+    done(), clock(), allocations(), slowest() {
+    if (s.summary) clock.enable();
+    for (size_t m = 0; m < variants.size(); m++) atomicAdd(&variants[m]->users, 1);
+  }
+  ~PredictStage() {
+    delete hits;
+    delete team;
+    for (size_t m = 0; m < variants.size(); m++) atomicAdd(&variants[m]->users, -1);
+  }
+
+  bool startTeam() {
+    return team == NULL || team->start();
+  }
+
+  void flushHits() {
+    if (!hits->hits.size()) return;
+    out.push(hits);
+    hits = new HitBatch;
+  }
+
+  void run() {
+    // counted only if this thread gets the same events as the main
+    // thread did.
+    PerfCounters counters;
+    if (settings.perf != NULL && counters.open() && counters.count() == settings.perf->count()) {
+      for (size_t m = 0; m < profiles.size(); m++) profiles[m].counter = &counters;
+    }
+
+    RecordRange task;
+    while (tasks.pop(worker, task)) {
+      // keep the first half, leaving the rest for us or a thief.
+      while (task.end - task.begin > 1) {
+        tasks.push(worker, task.split());
+      }
+      Batch *batch = task.batch;
+      const FastaRecord &rec(batch->records[task.begin]);
+      double start = settings.summary ? PhaseClock::now() : 0.0;
+      size_t residues;
+      clock.enter(PhaseClock::PARSE);
+      if (settings.calibrate) {
+        residues = calibrate(batch, rec, batch->first_index + task.begin);
+      } else {
+        residues = predict(batch, task.begin);
+      }
+      clock.enter(PhaseClock::IDLE);
+      if (settings.summary) {
+        double t = PhaseClock::now() - start;
+        if (slowest.wants(t)) slowest.add(t, rec.name, rec.name_len, residues);
+      }
+      done.add(1, rec.seq_len, residues);
+      tasks.finish();
+
+      if (hits->hits.size() >= HIT_BATCH_SIZE) flushHits();
+      if (atomicAdd(&batch->remaining, -1) == 0) {
+        delete batch;
+        in_flight.release();
+        flushHits();
+      }
+    }
+    flushHits();
+    out.done();
+    allocations = AllocationCounts::thisThread();
+    for (size_t m = 0; m < profiles.size(); m++) profiles[m].counter = NULL;
+    perf_multiplexed = counters.multiplexed();
+  }
 };
 
-#endif
+// Every interval seconds, a line on stderr saying how many sequences
+// and residues have been scored, how fast, and how long the rest
+// should take. The fraction done is the reader's position in its
+// inputs scaled by the share of what it has read that has been
+// scored; until the reader is finished it is unknown for input it
+// cannot measure.
+class ProgressStage {
+  const ReadStage &reader;
+  const std::vector<PredictStage *> &predictors;
+  double interval;
+  bool stopped;
+  Mutex mutex;
+  Condition stop_requested;
+
+  static std::string duration(double t) {
+    char buf[32];
+    long s = (long)(t + 0.5);
+    snprintf(buf, sizeof(buf), "%ld:%02ld:%02ld", s / 3600, s / 60 % 60, s % 60);
+    return buf;
+  }
+
+  void report(const Progress &sum, double elapsed, double rate) {
+    double position = reader.position;
+    uint64_t submitted = atomicRead(&reader.submitted.bytes);
+    double fraction = -1.0;
+    if (position >= 0.0 && submitted > 0) fraction = position * sum.bytes / submitted;
+
+    fprintf(stderr, "progress: %llu sequences, %llu residues, %.0f residues/s",
+            (unsigned long long)sum.sequences, (unsigned long long)sum.residues, rate);
+    if (fraction > 0.0) {
+      fprintf(stderr, ", %.1f%% done, ETA %s\n", 100.0 * fraction, duration(elapsed * (1.0 - fraction) / fraction).c_str());
+    } else {
+      fprintf(stderr, ", ETA unknown\n");
+    }
+  }
+
+  void total(Progress &sum) const {
+    for (size_t p = 0; p < predictors.size(); p++) sum.merge(predictors[p]->done);
+  }
 
-static int b_leader_raw_distrib[] = {
-  9, 10, 11, 11, 11, 11, 11, 11, 12, 12, 12, 12, 13, 13, 13, 13, 13,
-  13, 13, 14, 14, 14, 14, 14, 14, 15, 15, 15, 16, 16, 16, 16, 16, 17,
-  17, 17, 17, 17, 17, 17, 17, 18, 19, 19, 19, 19, 19, 19, 20, 20, 20,
-  21, 21, 21, 22, 23, 24, 25
+public:
+  ProgressStage(const ReadStage &r, const std::vector<PredictStage *> &p, double i) : reader(r), predictors(p), interval(i), stopped(false) {
+  }
+
+  void run() {
+    double start = PhaseClock::now(), last = start;
+    uint64_t last_residues = 0;
+    Lock l(mutex);
+    while (!stopped) {
+      stop_requested.wait(mutex, interval);
+      if (stopped) break;
+      double now = PhaseClock::now();
+      Progress sum;
+      total(sum);
+      report(sum, now - start, now > last ? (sum.residues - last_residues) / (now - last) : 0.0);
+      last = now;
+      last_residues = sum.residues;
+    }
+  }
+
+  void stop() {
+    Lock l(mutex);
+    stopped = true;
+    stop_requested.signal();
+  }
 };
 
-GHMM::Model::Ptr makePEXELmodel() {
-  GHMM::UTIL::Alphabet::Ptr alphabet = new GHMM::UTIL::Alphabet();
-  alphabet->addCharTokenRange('A','Z');
-  GHMM::UTIL::EmissionDistributionParser::Ptr ep = new GHMM::UTIL::EmissionDistributionParser(alphabet);
-
-  GHMM::EMISSION::Base::Ptr background, b_hydrophobic_distrib, met;
-
-#ifdef HALDAR_MOTIF
-  std::vector<MATH::DPDF::Ptr> RLE(11, MATH::DPDF::Ptr());
-#else
-  std::vector<MATH::DPDF::Ptr> RLE(7, MATH::DPDF::Ptr());
-#endif
-
-  std::vector<MATH::DPDF::Ptr> KLD(7, MATH::DPDF::Ptr());
-
-  GHMM::LENGTH::Discrete::Ptr a_leader_length, a_spacer_length, b_leader_length;
-
-  GHMM::LENGTH::Geometric::Ptr a_tail_length, b_spacer_length, b_tail_length, c_tail_length;
-
-#if VERSION == 1
-  GHMM::LENGTH::Uniform::Ptr a_hydrophobic_length, b_hydrophobic_length;
-#endif
-
-#if VERSION == 2
-  GHMM::LENGTH::Discrete::Ptr a_hydrophobic_length, b_hydrophobic_length;
-#endif
-
-  a_spacer_length = new GHMM::LENGTH::Discrete(MATH::smooth(MATH::GaussianKernel(1.0),
-                                                            a_spacer_raw_distrib,
-                                                            ENDOF(a_spacer_raw_distrib),
-                                                            1,
-                                                            60));
-
-  b_leader_length = new GHMM::LENGTH::Discrete(MATH::smooth(MATH::GaussianKernel(1.0),
-                                                            b_leader_raw_distrib,
-                                                            ENDOF(b_leader_raw_distrib),
-                                                            -1,
-                                                            30));
-  background = new GHMM::EMISSION::Stateless(ep->parse("\n\
-             A:  78883 C:  71359 D: 260979 E: 288230\n\
-             F: 175488 G: 114068 H:  97688 I: 373389\n\
-             K: 473828 L: 304967 M:  88773 N: 581084\n\
-             P:  80295 Q: 111860 R: 106760 S: 256676\n\
-             T: 164816 V: 154088 W:  19966 Y: 230362"));
-
-
-#if VERSION == 1
-  b_hydrophobic_length = new GHMM::LENGTH::Uniform(9.5, 25.5);
-
-  b_hydrophobic_distrib = new GHMM::EMISSION::Stateless(ep->parse("\n\
-             A:  34 C:  75 D:   5 E:  10\n\
-             F: 289 G:  57 H:  12 I: 351\n\
-             K:  26 L: 446 M:  30 N:  57\n\
-             P:  18 Q:  12 R:  10 S: 106\n\
-             T:  77 V: 172 W:  14 Y: 104"));
-#endif
-
-#if VERSION == 2
-  b_hydrophobic_length = new GHMM::LENGTH::Discrete(MATH::smooth(MATH::GaussianKernel(1.0),
-                                                                 b_hydrophobic_raw_distrib,
-                                                                 ENDOF(b_hydrophobic_raw_distrib),
-                                                                 20,
-                                                                 35));
-  
-  b_hydrophobic_distrib = new GHMM::EMISSION::Stateless(ep->parse("\n\
-             D:   4 E:   6 Q:   6 R:   6 H:  11 K:  24\n\
-             P:  24 W:  24 M:  27 A:  37 N:  40 G:  70\n\
-             T:  87 C: 106 S: 113 Y: 132 V: 199 F: 396\n\
-             I: 508 L: 559"));
-#endif
-
-  met = new GHMM::EMISSION::Stateless(ep->parse("M: 1"));
-
-#ifdef HALDAR_MOTIF
-
-  RLE[ 0] = ep->parse("\
-    A: 0.016425 C: 0.000540 D: 0.014277 E: 0.027577 F: 0.001233 G: 0.022156 H: 0.002540\n\
-    I: 0.203500 K: 0.104854 L: 0.070546 M: 0.001576 N: 0.062469 P: 0.030850 Q: 0.015745\n\
-    R: 0.235895 S: 0.093319 T: 0.053231 V: 0.041329 W: 0.000384 Y: 0.001552");
-  RLE[ 1] = ep->parse("\
-    A: 0.035110 C: 0.019491 D: 0.032513 E: 0.054565 F: 0.090540 G: 0.012293 H: 0.069190\n\
-    I: 0.077420 K: 0.092437 L: 0.032299 M: 0.011190 N: 0.145192 P: 0.020841 Q: 0.052481\n\
-    R: 0.005220 S: 0.063105 T: 0.014458 V: 0.022206 W: 0.000765 Y: 0.148686");
-  RLE[ 2] = ep->parse("\
-    A: 0.006767 C: 0.010168 D: 0.023768 E: 0.027373 F: 0.087736 G: 0.022124 H: 0.012096\n\
-    I: 0.069334 K: 0.152723 L: 0.080357 M: 0.020839 N: 0.100823 P: 0.030838 Q: 0.015603\n\
-    R: 0.053420 S: 0.218135 T: 0.014804 V: 0.031933 W: 0.000390 Y: 0.020770");
-  RLE[ 3] = ep->parse("\
-    A: 0.000059 C: 0.000034 D: 0.000070 E: 0.000039 F: 0.000041 G: 0.000146 H: 0.000044\n\
-    I: 0.000023 K: 0.000048 L: 0.000068 M: 0.000012 N: 0.000046 P: 0.000085 Q: 0.000041\n\
-    R: 0.999034 S: 0.000061 T: 0.000053 V: 0.000033 W: 0.000024 Y: 0.000038");
-  RLE[ 4] = ep->parse("\
-    A: 0.004727 C: 0.011067 D: 0.000614 E: 0.001160 F: 0.032319 G: 0.001406 H: 0.000859\n\
-    I: 0.400985 K: 0.001370 L: 0.185451 M: 0.032715 N: 0.001157 P: 0.000921 Q: 0.001221\n\
-    R: 0.001350 S: 0.179883 T: 0.062928 V: 0.057912 W: 0.010406 Y: 0.011552");
-  RLE[ 5] = ep->parse("\
-    A: 0.002464 C: 0.000796 D: 0.000626 E: 0.001260 F: 0.012464 G: 0.000814 H: 0.000721\n\
-    I: 0.033532 K: 0.001374 L: 0.896824 M: 0.031588 N: 0.000832 P: 0.001065 Q: 0.001607\n\
-    R: 0.001635 S: 0.001584 T: 0.002179 V: 0.006832 W: 0.000534 Y: 0.001270");
-  RLE[ 6] = ep->parse("\
-    A: 0.418578 C: 0.035794 D: 0.009649 E: 0.002415 F: 0.026626 G: 0.046949 H: 0.017247\n\
-    I: 0.012737 K: 0.018596 L: 0.022344 M: 0.002607 N: 0.001777 P: 0.001035 Q: 0.001720\n\
-    R: 0.010255 S: 0.215815 T: 0.086576 V: 0.034855 W: 0.000586 Y: 0.033838");
-  RLE[ 7] = ep->parse("\
-    A: 0.012139 C: 0.000031 D: 0.075676 E: 0.688634 F: 0.000098 G: 0.010772 H: 0.000417\n\
-    I: 0.000363 K: 0.002178 L: 0.000631 M: 0.000277 N: 0.000983 P: 0.000688 Q: 0.163090\n\
-    R: 0.000773 S: 0.031310 T: 0.001004 V: 0.010732 W: 0.000034 Y: 0.000168");
-  RLE[ 8] = ep->parse("\
-    A: 0.034662 C: 0.030320 D: 0.001834 E: 0.022856 F: 0.100029 G: 0.060467 H: 0.011140\n\
-    I: 0.035027 K: 0.081740 L: 0.065428 M: 0.012476 N: 0.109695 P: 0.079388 Q: 0.031994\n\
-    R: 0.002601 S: 0.072368 T: 0.092184 V: 0.075345 W: 0.010280 Y: 0.070167");
-  RLE[ 9] = ep->parse("\
-    A: 0.026047 C: 0.010128 D: 0.043112 E: 0.142809 F: 0.020407 G: 0.022169 H: 0.021753\n\
-    I: 0.040243 K: 0.095314 L: 0.080063 M: 0.011154 N: 0.158453 P: 0.002068 Q: 0.121355\n\
-    R: 0.024760 S: 0.102939 T: 0.005256 V: 0.012464 W: 0.000383 Y: 0.059126");
-  RLE[10] = ep->parse("\
-    A: 0.054834 C: 0.000533 D: 0.129472 E: 0.066039 F: 0.049196 G: 0.022168 H: 0.021752\n\
-    I: 0.030652 K: 0.172076 L: 0.041685 M: 0.001559 N: 0.100878 P: 0.030855 Q: 0.006203\n\
-    R: 0.015161 S: 0.141321 T: 0.053234 V: 0.060448 W: 0.000383 Y: 0.001552");
-
-#else
-
-#if VERSION == 1
-  RLE[0] = ep->parse("A: 1 C: 6 D: 2 E: 2 F: 11 G: 7 H: 3 I: 15 K: 23 L: 6 M: 1 N: 15 P: 1 Q: 3 R: 6 S: 38 T: 5 V: 3 W: 1 Y: 6");
-  RLE[1] = ep->parse("K: 3 R: 152");
-  // RLE[2] = ep->parse("I: 28 K: 11 L: 15 N: 32 S: 26 T: 9");
-  RLE[2] = ep->parse("A: 2 C: 6 E: 1 F: 4 H: 3 I: 28 K: 11 L: 15 M: 2 N: 32 Q: 3 R: 3 S: 26 T: 9 V: 6 W: 1 Y: 3");
-  // RLE[3] = ep->parse("L: 151");
-  RLE[3] = ep->parse("F: 1 I: 2 L: 151 N: 1");
-  // RLE[4] = ep->parse("A: 35 S: 48 T: 18 Y: 15 C: 9");
-  RLE[4] = ep->parse("A: 35 C: 9 E: 2 F: 2 G: 5 H: 1 I: 2 K: 1 L: 3 N: 7 S: 48 T: 18 V: 7 Y: 15");
-  // RLE[5] = ep->parse("D: 11 E: 109 Q: 21");
-  RLE[5] = ep->parse("C: 2 D: 11 E: 109 G: 2 H: 1 K: 1 Q: 21 S: 4 T: 3 Y: 1");
-  RLE[6] = ep->parse("A: 1 C: 4 D: 1 E: 6 F: 5 G: 6 H: 7 I: 5 K: 10 L: 14 M: 3 N: 15 P: 9 Q: 3 R: 5 S: 10 T: 17 V: 18 Y: 16");
-#endif
-
-#if VERSION == 2
-  RLE[0] = ep->parse("M: 1 P: 1 W: 1 A: 2 D: 2 E: 2 H: 3 Q: 3 V: 4 T: 5 C: 6 Y: 6 G: 7 L: 7 R: 7 F: 13 I: 15 N: 15 K: 26 S: 40");
-  RLE[1] = ep->parse("K: 7 R: 159");
-  RLE[2] = ep->parse("W: 1 A: 2 E: 2 M: 2 H: 3 R: 3 Q: 4 Y: 4 F: 5 V: 6 C: 7 T: 9 K: 12 L: 16 S: 28 I: 29 N: 33");
-  RLE[3] = ep->parse("N: 1 F: 2 I: 2 L: 161");
-  RLE[4] = ep->parse("E: 1 H: 1 F: 2 I: 2 K: 3 L: 3 G: 4 N: 8 V: 8 C: 10 Y: 17 T: 18 A: 37 S: 52");
-  RLE[5] = ep->parse("H: 1 K: 1 Y: 1 C: 2 G: 3 T: 3 S: 5 D: 15 Q: 21 E: 114");
-  RLE[6] = ep->parse("D: 1 A: 3 M: 3 Q: 3 C: 4 F: 5 R: 5 G: 6 I: 6 E: 7 H: 8 P: 9 K: 10 S: 11 L: 15 N: 17 T: 17 Y: 17 V: 19");
-#endif
-
-#endif
-
-  KLD[0] = ep->parse("A: 69 L: 1 P: 1 V: 8");
-  KLD[1] = ep->parse("K: 58 R: 20");
-  KLD[2] = ep->parse("D: 12 E: 10 G: 1 H: 35 N: 19 Y: 2");
-  KLD[3] = ep->parse("A: 5 I: 4 L: 29 M: 11 V: 30");
-  KLD[4] = ep->parse("F: 17 L: 62");
-  KLD[5] = ep->parse("D: 56 E: 23");
-  KLD[6] = ep->parse("D: 3 E: 13 G: 3 I: 1 K: 9 L: 1 M: 7 N: 7 Q: 2 R: 20 S: 13");
-
-  a_tail_length = new GHMM::LENGTH::Geometric(364);
-
-#if VERSION == 1
-  b_spacer_length = new GHMM::LENGTH::Geometric(350);
-  b_tail_length = new GHMM::LENGTH::Geometric(1845);
-#else
-  b_spacer_length = new GHMM::LENGTH::Geometric(1693);
-  b_tail_length = new GHMM::LENGTH::Geometric(437);
-#endif
-
-  c_tail_length = new GHMM::LENGTH::Geometric(755);
-
-  GHMM::StateBase::Ptr a_met = GHMM::UTIL::makeState(NULL, met);
-  GHMM::StateBase::Ptr a_spacer = GHMM::UTIL::makeState(a_spacer_length, background);
-  GHMM::StateBase::Ptr a_RLE = GHMM::UTIL::makeMotifState(RLE);
-  GHMM::StateBase::Ptr a_tail = GHMM::UTIL::makeState(a_tail_length, background);
-
-  GHMM::StateBase::Ptr b_met = GHMM::UTIL::makeState(NULL, met);
-  GHMM::StateBase::Ptr b_leader = GHMM::UTIL::makeState(b_leader_length, background);
-  GHMM::StateBase::Ptr b_KLD = GHMM::UTIL::makeMotifState(KLD);
-  GHMM::StateBase::Ptr b_spacer = GHMM::UTIL::makeState(b_spacer_length, background);
-  GHMM::StateBase::Ptr b_hydrophobic = GHMM::UTIL::makeState(b_hydrophobic_length, b_hydrophobic_distrib);
-  GHMM::StateBase::Ptr b_tail = GHMM::UTIL::makeState(b_tail_length, background);
-
-  GHMM::StateBase::Ptr c_met = GHMM::UTIL::makeState(NULL, met);
-  GHMM::StateBase::Ptr c_tail = GHMM::UTIL::makeState(c_tail_length, background);
-
-  GHMM::ModelBuilder mb;
-
-  std::pair<std::string, std::string> makeSignalPModel(GHMM::ModelBuilder &mb, GHMM::UTIL::Alphabet::Ptr &alphabet);
-  std::pair<std::string, std::string> makeSSModel(GHMM::ModelBuilder &mb, GHMM::UTIL::Alphabet::Ptr &alphabet);
-
-#ifdef SIGNALP_MODEL
-  std::pair<std::string, std::string> ss_states = makeSignalPModel(mb, alphabet);
-#else
-  std::pair<std::string, std::string> ss_states = makeSSModel(mb, alphabet);
-#endif
-
-#ifdef RLE_PATTERN
-  mb.addState("a-met",         a_met);
-  mb.addState("a-spacer",      a_spacer);
-  mb.addState("a-RLE",         a_RLE);
-  mb.addState("a-tail",        a_tail);
-#endif
-
-#ifdef KLD_PATTERN
-  mb.addState("b-met",         b_met);
-  mb.addState("b-leader",      b_leader);
-  mb.addState("b-KLD",         b_KLD);
-  mb.addState("b-spacer",      b_spacer);
-  mb.addState("b-hydrophobic", b_hydrophobic);
-  mb.addState("b-tail",        b_tail);
-#endif
-
-  mb.addState("c-met",         c_met);
-  mb.addState("c-tail",        c_tail);
-
-#ifdef RLE_PATTERN
-  mb.addStateTransition(GHMM::Model::BEGIN, "a-met", 400);
-#endif
-
-#ifdef KLD_PATTERN
-  mb.addStateTransition(GHMM::Model::BEGIN, "b-met", 100);
-#endif
-
-  mb.addStateTransition(GHMM::Model::BEGIN, "c-met", 4909);
-
-#ifdef RLE_PATTERN
-  mb.addStateTransition("a-met",            ss_states.first,  1);
-  mb.addStateTransition(ss_states.second,   "a-spacer",       1);
-  mb.addStateTransition("a-spacer",         "a-RLE",          1);
-  mb.addStateTransition("a-RLE",            "a-tail",         1);
-  mb.addStateTransition("a-tail",           GHMM::Model::END, 1);
-
-  mb.addState("d-tail", c_tail);
-  mb.addStateTransition(ss_states.second,   "d-tail",         0.01);
-  mb.addStateTransition("d-tail",           GHMM::Model::END, 1);
-#endif
-
-#ifdef KLD_PATTERN
-  mb.addStateTransition("b-met",            "b-leader",       1);
-  mb.addStateTransition("b-leader",         "b-KLD",          1);
-  mb.addStateTransition("b-KLD",            "b-spacer",       1);
-  mb.addStateTransition("b-spacer",         "b-hydrophobic",  1);
-  mb.addStateTransition("b-hydrophobic",    "b-tail",         1);
-  mb.addStateTransition("b-tail",           GHMM::Model::END, 1);
-#endif
-
-  mb.addStateTransition("c-met",            "c-tail",         1);
-  mb.addStateTransition("c-tail",           GHMM::Model::END, 1);
-
-  return mb.make();
+// one line per state, costliest first. states are only timed in
+// some columns (see GHMM::StateProfile), so a state's time is its
+// time per timed cell over all its cells. time is summed over the
+// threads that evaluated the state, so with --column-threads it can
+// exceed the run's wall clock time. perf, if given, names the
+// hardware events counted: per residue and per cell for whole parses,
+// and per cell for each state.
+static double cellNanoseconds(const GHMM::StateProfile &sp) {
+  return sp.timed ? (double)sp.nanoseconds / sp.timed : 0.0;
 }
 
-static const struct option options[] = {
-  { "input",             required_argument,          0,            'i' },
-  { "output",            required_argument,          0,            'o' },
-  { "RLE-threshold",     required_argument,          0,            'R' },
-  { "KLD-threshold",     required_argument,          0,            'K' },
-  { "no-RLD",            no_argument,                0,            'r' },
-  { "no-KLD",            no_argument,                0,            'k' },
-  { 0,                   0,                          0,            0   }
-};
+static void writeProfile(FILE *fp, const ModelVariant &v, const GHMM::Profile &profile, const PerfCounters *perf) {
+  const GHMM::Model &model(*v.model);
+  std::vector<std::pair<double, int> > order;
+  double total = 0.0;
+  for (int j = 1; j < (int)profile.states.size() - 1; j++) {
+    const GHMM::StateProfile &sp(profile.states[j]);
+    order.push_back(std::make_pair(cellNanoseconds(sp) * sp.cells, j));
+    total += order.back().first;
+  }
+  std::sort(order.rbegin(), order.rend());
+
+  fprintf(fp, "# %s: %llu sequences, %llu residues, %.3f s in states\n", v.label.c_str(),
+          (unsigned long long)profile.sequences, (unsigned long long)profile.residues, total * 1e-9);
+
+  int n_events = perf ? perf->count() : 0;
+  const GHMM::StateProfile &parses(profile.parses);
+  if (n_events && parses.counted) {
+    double residues = profile.residues;
+    fprintf(fp, "# parses:");
+    for (int i = 0; i < n_events; i++) {
+      fprintf(fp, "%s %.1f %s/residue", i ? "," : "", residues ? parses.events[i] / residues : 0.0, PerfCounters::name(perf->event(i)));
+    }
+    int cycles = perf->index(PerfCounters::CYCLES), instructions = perf->index(PerfCounters::INSTRUCTIONS);
+    if (cycles >= 0) fprintf(fp, ", %.2f cycles/cell", parses.cells ? (double)parses.events[cycles] / parses.cells : 0.0);
+    if (cycles >= 0 && instructions >= 0 && parses.events[cycles]) {
+      fprintf(fp, ", %.2f instructions/cycle", (double)parses.events[instructions] / parses.events[cycles]);
+    }
+    fprintf(fp, "\n");
+  }
 
-std::string genParse(const std::string &sequence, const GHMM::Model::Ptr &model, GHMM::Traceback::Ptr tbp) {
-  std::ostringstream out;
-  std::vector<std::string> parse;
-  std::string::size_type pos = sequence.size();
-  while (tbp != NULL) {
-    std::ostringstream o;
-    pos -= tbp->length;
-    o << "[" << model->stateName(tbp->state) << ":" << sequence.substr(pos, tbp->length) << "]";
-    parse.push_back(o.str());
-    tbp = tbp->prev;
+  fprintf(fp, "%-16s %12s %14s %14s %14s %12s %10s %6s %8s",
+          "state", "cells", "durations", "predecessors", "zero-durations", "zero-cells", "seconds", "%time", "ns/cell");
+  for (int i = 0; i < n_events; i++) {
+    fprintf(fp, " %18s", (std::string(PerfCounters::name(perf->event(i))) + "/cell").c_str());
+  }
+  fprintf(fp, "\n");
+  for (int k = 0; k < (int)order.size(); k++) {
+    const GHMM::StateProfile &sp(profile.states[order[k].second]);
+    fprintf(fp, "%-16s %12llu %14llu %14llu %14llu %12llu %10.3f %6.2f %8.1f",
+            model.stateName(order[k].second).c_str(),
+            (unsigned long long)sp.cells, (unsigned long long)sp.durations, (unsigned long long)sp.predecessors,
+            (unsigned long long)sp.zero_durations, (unsigned long long)sp.zero_cells,
+            order[k].first * 1e-9, total ? 100.0 * order[k].first / total : 0.0,
+            cellNanoseconds(sp));
+    // per state events are only read for cells not shared with a
+    // column team.
+    for (int i = 0; i < n_events; i++) {
+      if (sp.counted) {
+        fprintf(fp, " %18.1f", (double)sp.events[i] / sp.counted);
+      } else {
+        fprintf(fp, " %18s", "-");
+      }
+    }
+    fprintf(fp, "\n");
   }
-  std::copy(parse.rbegin(), parse.rend(), std::ostream_iterator<std::string>(out, ""));
-  return out.str();
 }
 
-void usage(const char *progname) {
-  std::cout << "Usage: " << progname << " [arguments]" << std::endl;
-  std::cout << "\
-\n\
---input=file            -i file        read sequences from file (-:stdin)\n\
---output=file           -o file        write results to file (-:stdout)\n\
---RLE-threshold=float   -R float       RLE threshold for positive prediction\n\
-                                       (default: 4.3)\n\
---KLD-threshold=float   -K float       KLD threshold for positive prediction\n\
-                                       (default: 0.0)\n\
---no-RLE                -r             turn off RLE prediction\n\
---no-KLD                -k             turn off KLD prediction\n\
-\n\
-";
+static void buildIndexes(const std::vector<std::string> &inputs) {
+  for (int f = 0; f < (int)inputs.size(); f++) {
+    FastaReader reader;
+    FastaIndex index;
+
+    if (inputs[f] == "-" || !reader.open(inputs[f].c_str()) || !reader.stable()) {
+      std::cerr << "can only index uncompressed regular files: " << inputs[f] << std::endl;
+      exit(1);
+    }
+    index.build(reader);
+    if (reader.failed() || !index.write(FastaIndex::indexPath(inputs[f]))) {
+      std::cerr << "could not write " << FastaIndex::indexPath(inputs[f]) << std::endl;
+      exit(1);
+    }
+    std::cerr << index.entries.size() << " sequences indexed in " << inputs[f] << std::endl;
+  }
+}
+
+// combine the output of shard runs. scores are taken as printed, so
+// hits whose scores print identically are ordered by their text.
+static void mergeResults(const std::vector<std::string> &inputs, const std::vector<PEXELModelOptions> &model_opts, bool p_values, HitWriter &writer) {
+  bool label_variants = model_opts.size() > 1;
+
+  for (int f = 0; f < (int)inputs.size(); f++) {
+    std::ifstream file;
+    if (inputs[f] != "-") {
+      file.open(inputs[f].c_str());
+      if (!file) {
+        std::cerr << "could not open " << inputs[f] << std::endl;
+        exit(1);
+      }
+    }
+    std::istream &in(inputs[f] == "-" ? std::cin : file);
+    std::string line;
+    int n_read = 0;
+
+    while (std::getline(in, line)) {
+      // name<tab>[variant<tab>]class<tab>score<tab>[p<tab>]parse; the
+      // name may itself hold tabs, so fields are found from the right.
+      size_t t_parse = line.rfind('\t');
+      if (p_values && t_parse != std::string::npos) t_parse = t_parse ? line.rfind('\t', t_parse - 1) : std::string::npos;
+      size_t t_score = t_parse != std::string::npos && t_parse ? line.rfind('\t', t_parse - 1) : std::string::npos;
+      size_t t_class = t_score != std::string::npos && t_score ? line.rfind('\t', t_score - 1) : std::string::npos;
+      if (t_class == std::string::npos) {
+        std::cerr << "bad result line in " << inputs[f] << ": " << line << std::endl;
+        exit(1);
+      }
+
+      std::string cls = line.substr(t_class + 1, t_score - t_class - 1);
+      double score = strtod(line.c_str() + t_score + 1, NULL);
+      int variant = 0;
+
+      if (label_variants) {
+        size_t t_variant = t_class ? line.rfind('\t', t_class - 1) : std::string::npos;
+        std::string label = t_variant == std::string::npos ? "" : line.substr(t_variant + 1, t_class - t_variant - 1);
+        for (variant = 0; variant < (int)model_opts.size(); variant++) {
+          if (model_opts[variant].name() == label) break;
+        }
+      }
+      if (variant == (int)model_opts.size() || (cls != "RLE" && cls != "KLD")) {
+        std::cerr << "result line does not match the given models in " << inputs[f] << ": " << line << std::endl;
+        exit(1);
+      }
+
+      writer.add(2 * variant + (cls == "KLD" ? 1 : 0), score, line.data(), line.size());
+      n_read++;
+    }
+
+    std::cerr << n_read << " results read from " << (inputs[f] == "-" ? "stdin" : inputs[f]) << std::endl;
+  }
 }
 
 int main(int argc, char **argv) {
@@ -480,26 +1108,42 @@ int main(int argc, char **argv) {
   double KLD_threshold = 0.0;
   bool do_RLE = true;
   bool do_KLD = false;
-
-  std::list<std::pair<std::string, std::string> > seq_list;
+  int n_threads = 1;
+  int queue_depth = 0;
+  HitWriter::Mode sort_mode = HitWriter::SORTED;
+  size_t top_n = 0;
+  size_t sort_memory = 256;
+  bool index_only = false;
+  bool merge = false;
+  int shard_i = 0, shard_n = 0;
+  int column_threads = 1;
+  size_t column_min = 2000;
+  uint64_t sim_count = 0;
+  uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+  bool seed_given = false;
+  std::string calibrate_path, null_path;
+  PredictSettings::NullModel null_model = PredictSettings::SHUFFLE;
+  int null_samples = 1;
+  double db_size = 0;
+  bool profile = false;
+  std::string profile_path = "-";
+  bool perf = false;
+  double progress_interval = 0;
+  bool summary = false;
+  std::string summary_path = "-";
+  double start_time = PhaseClock::now();
+  PhaseClock clock;
+
+  std::vector<std::string> inputs;
+  std::vector<PEXELModelOptions> model_opts;
   std::string output = "-";
 
   int ch;
 
-  while ((ch = getopt_long(argc, argv, "i:o:R:K:hkr", options, NULL)) != -1) {
+  while ((ch = getopt_long(argc, argv, "i:o:R:K:m:t:Q:uT:S:Is:MC:L:g:e:c:B:n:p:z:P::Hv::J::hkr", options, NULL)) != -1) {
     switch (ch) {
     case 'i': {
-      if (!strcmp(optarg, "-")) {
-        std::ifstream in(optarg);
-        int old_sz = seq_list.size();
-        readFasta(std::cin, std::inserter(seq_list, seq_list.begin()), NULL);
-        std::cerr << seq_list.size() - old_sz << " sequences read from stdin" << std::endl;
-      } else {
-        std::ifstream in(optarg);
-        int old_sz = seq_list.size();
-        readFasta(in, std::inserter(seq_list, seq_list.begin()), NULL);
-        std::cerr << seq_list.size() - old_sz << " sequences read from " << optarg << std::endl;
-      }
+      inputs.push_back(optarg);
       break;
     }
     case 'o': {
@@ -522,6 +1166,114 @@ int main(int argc, char **argv) {
       do_KLD = false;
       break;
     }
+    case 'm': {
+      PEXELModelOptions opts;
+      if (!opts.parse(optarg)) {
+        std::cerr << "bad model spec: " << optarg << std::endl;
+        exit(1);
+      }
+      model_opts.push_back(opts);
+      break;
+    }
+    case 't': {
+      n_threads = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'Q': {
+      queue_depth = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'u': {
+      sort_mode = HitWriter::UNSORTED;
+      break;
+    }
+    case 'T': {
+      sort_mode = HitWriter::TOP;
+      top_n = std::max(0, atoi(optarg));
+      break;
+    }
+    case 'S': {
+      sort_memory = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'I': {
+      index_only = true;
+      break;
+    }
+    case 's': {
+      if (sscanf(optarg, "%d/%d", &shard_i, &shard_n) != 2 || shard_n < 1 || shard_i < 0 || shard_i >= shard_n) {
+        std::cerr << "bad shard spec: " << optarg << " (expected i/N, 0 <= i < N)" << std::endl;
+        exit(1);
+      }
+      break;
+    }
+    case 'M': {
+      merge = true;
+      break;
+    }
+    case 'C': {
+      column_threads = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'L': {
+      column_min = std::max(0, atoi(optarg));
+      break;
+    }
+    case 'g': {
+      sim_count = strtoull(optarg, NULL, 10);
+      break;
+    }
+    case 'e': {
+      seed = strtoull(optarg, NULL, 10);
+      seed_given = true;
+      break;
+    }
+    case 'c': {
+      calibrate_path = optarg;
+      break;
+    }
+    case 'B': {
+      if (!strcmp(optarg, "shuffle")) {
+        null_model = PredictSettings::SHUFFLE;
+      } else if (!strcmp(optarg, "background")) {
+        null_model = PredictSettings::BACKGROUND;
+      } else {
+        std::cerr << "bad null model: " << optarg << " (expected shuffle or background)" << std::endl;
+        exit(1);
+      }
+      break;
+    }
+    case 'n': {
+      null_samples = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'p': {
+      null_path = optarg;
+      break;
+    }
+    case 'z': {
+      db_size = strtod(optarg, NULL);
+      break;
+    }
+    case 'P': {
+      profile = true;
+      if (optarg) profile_path = optarg;
+      break;
+    }
+    case 'H': {
+      perf = true;
+      break;
+    }
+    case 'v': {
+      progress_interval = optarg ? strtod(optarg, NULL) : 10.0;
+      if (progress_interval <= 0) progress_interval = 10.0;
+      break;
+    }
+    case 'J': {
+      summary = true;
+      if (optarg) summary_path = optarg;
+      break;
+    }
     case 'h':
     case '?': {
       usage(argv[0]);
@@ -530,78 +1282,230 @@ int main(int argc, char **argv) {
     }
   }
 
-  GHMM::Model::Ptr model = makePEXELmodel();
+  if (!model_opts.size()) {
+    model_opts.push_back(PEXELModelOptions());
+  }
+  if (!queue_depth) {
+    queue_depth = 2 * n_threads;
+  }
 
-  std::list<std::pair<std::string, std::string> >::iterator i, e;
+  if (index_only) {
+    buildIndexes(inputs);
+    exit(0);
+  }
 
-  std::vector<std::pair<double, std::string> > rle_out, kld_out;
+  FILE *out = stdout;
+  if (output != "-") {
+    out = fopen(output.c_str(), "w");
+    if (out == NULL) {
+      std::cerr << "could not open " << output << std::endl;
+      exit(1);
+    }
+  }
 
-  for (i = seq_list.begin(), e = seq_list.end(); i != e; ++i) {
-    std::string &name((*i).first);
-    std::string &sequence((*i).second);
-    int *seq_raw = new int[sequence.size()];
+  // hits are bucketed by variant and class: RLE then KLD for each.
+  HitWriter writer(out, 2 * model_opts.size(), sort_mode, top_n, sort_memory * 1024 * 1024);
+  std::vector<std::string> bucket_names;
+  for (int m = 0; m < (int)model_opts.size(); m++) {
+    bucket_names.push_back(model_opts[m].name() + " RLE");
+    bucket_names.push_back(model_opts[m].name() + " KLD");
+  }
 
-    for (int j = 0; j < (int)sequence.size(); j++) {
-      if (isalpha(sequence[j])) {
-        seq_raw[j] = toupper(sequence[j]) - 'A';
-      } else {
-        seq_raw[j] = 'X' - 'A';
-      }
+  NullTable null_table;
+  if (null_path.size()) {
+    std::string err;
+    if (!null_table.read(null_path, bucket_names, err)) {
+      std::cerr << err << std::endl;
+      exit(1);
     }
+  }
 
-    GHMM::Parse::Ptr parse = new GHMM::Parse();
-    parse->parse(model, seq_raw, seq_raw + sequence.size());
+  if (merge) {
+    mergeResults(inputs, model_opts, null_path.size() != 0, writer);
+    writer.finish();
+    exit(0);
+  }
 
-    double alpha_rle, alpha_kld, alpha_bkg;
-    alpha_rle = parse->alpha(model->stateNumber("a-tail"), 0);
-    alpha_kld = parse->alpha(model->stateNumber("b-tail"), 0);
-    alpha_bkg = parse->alpha(model->stateNumber("c-tail"), 0);
-#if 0
-    std::cerr << name
-              << " alpha_rle:" << alpha_rle
-              << " alpha_kld:" << alpha_kld
-              << " alpha_bkg:" << alpha_bkg
-              << " alpha_ssonly=" << parse->alpha(model->stateNumber("d-tail"), 0) << std::endl;
-#endif
+  if (summary) {
+    clock.enable();
+    AllocationCounts::enable();
+  }
+  clock.enter(PhaseClock::BUILD);
+  std::vector<ModelVariant *> variants;
+  for (int m = 0; m < (int)model_opts.size(); m++) {
+    variants.push_back(new ModelVariant(model_opts[m]));
+  }
 
-    if (alpha_rle - alpha_bkg > RLE_threshold) {
-      std::ostringstream out;
-      out << name << "\t"
-          << "RLE" << "\t"
-          << alpha_rle - alpha_bkg << "\t"
-          << genParse(sequence, model, parse->psi(model->stateNumber("a-tail"), 0));
-      rle_out.push_back(std::make_pair(alpha_rle - alpha_bkg, out.str()));
+  // sequences are encoded once for all variants, and hits print one
+  // residue per symbol.
+  for (int m = 0; m < (int)variants.size(); m++) {
+    const GHMM::Model &model(*variants[m]->model);
+    if (model.alphabet() == NULL || *model.alphabet() != *variants[0]->model->alphabet() || !model.alphabet()->singleChar()) {
+      std::cerr << variants[m]->label << ": the model variants must share an alphabet of single characters" << std::endl;
+      exit(1);
     }
+  }
+  const GHMM::UTIL::Alphabet &alphabet(*variants[0]->model->alphabet());
+
+  // reader -> predictors -> writer (this thread). models are shared,
+  // read only, by all predictors; each predictor has its own parse
+  // workspace.
+  SignalSimulator *simulator = NULL;
+  if (sim_count) {
+    if (alphabet != FastaReader::residueAlphabet()) {
+      std::cerr << "simulated sequences are residue codes, which the model does not use" << std::endl;
+      exit(1);
+    }
+    simulator = new SignalSimulator(model_opts[0], seed);
+  }
+  if ((sim_count || calibrate_path.size()) && !seed_given) {
+    std::cerr << "seed: " << (unsigned long long)seed << std::endl;
+  }
+  if (calibrate_path.size() && null_model == PredictSettings::BACKGROUND &&
+      (variants[0]->c_met_emit == NULL || variants[0]->c_tail_emit == NULL)) {
+    std::cerr << variants[0]->label << ": background null sequences need c-met and c-tail states with position independent emissions" << std::endl;
+    exit(1);
+  }
 
-    if (alpha_kld - alpha_bkg > KLD_threshold) {
-      std::ostringstream out;
-      out << name << "\t"
-          << "KLD" << "\t"
-          << alpha_kld - alpha_bkg << "\t"
-          << genParse(sequence, model, parse->psi(model->stateNumber("b-tail"), 0));
-      kld_out.push_back(std::make_pair(alpha_kld - alpha_bkg, out.str()));
+  PredictSettings settings;
+  settings.RLE_threshold = RLE_threshold;
+  settings.KLD_threshold = KLD_threshold;
+  settings.column_threads = column_threads;
+  settings.column_min = column_min;
+  settings.null_table = null_path.size() ? &null_table : NULL;
+  settings.db_size = db_size;
+  settings.calibrate = calibrate_path.size() != 0;
+  settings.null_model = null_model;
+  settings.null_samples = null_samples;
+  settings.seed = seed;
+  settings.profile = profile;
+  settings.perf = NULL;
+  PerfCounters perf_events;
+  if (profile && perf) {
+    if (perf_events.open()) {
+      settings.perf = &perf_events;
+    } else {
+      std::cerr << "hardware counters not available (" << perf_events.error() << "); profiling without them" << std::endl;
+    }
+  }
+  settings.summary = summary;
+  clock.enter(PhaseClock::IDLE);
+
+  TaskQueue tasks(n_threads);
+  Semaphore in_flight(queue_depth);
+  HitQueue to_write(queue_depth, n_threads);
+
+  ReadStage read_stage(inputs, alphabet, n_threads, shard_i, shard_n, tasks, in_flight, simulator, sim_count);
+  std::vector<PredictStage *> predict_stages;
+  Thread<ReadStage> read_thread;
+  std::vector<Thread<PredictStage> *> predict_threads;
+
+  if (summary) read_stage.clock.enable();
+  if (!read_thread.start(&read_stage)) {
+    std::cerr << "could not start reader thread" << std::endl;
+    exit(1);
+  }
+  for (int t = 0; t < n_threads; t++) {
+    predict_stages.push_back(new PredictStage(variants, settings, t, tasks, in_flight, to_write));
+    if (settings.calibrate) predict_stages.back()->null_scores.setBuckets(bucket_names);
+    predict_threads.push_back(new Thread<PredictStage>);
+    if (!predict_stages.back()->startTeam() || !predict_threads.back()->start(predict_stages.back())) {
+      std::cerr << "could not start predictor thread" << std::endl;
+      exit(1);
     }
   }
 
-  std::sort(rle_out.begin(), rle_out.end());
-  std::sort(kld_out.begin(), kld_out.end());
+  ProgressStage progress(read_stage, predict_stages, progress_interval);
+  Thread<ProgressStage> progress_thread;
+  if (progress_interval > 0 && !progress_thread.start(&progress)) {
+    std::cerr << "could not start progress thread" << std::endl;
+    exit(1);
+  }
 
-  if (output == "-") {
-    for (std::vector<std::pair<double, std::string> >::reverse_iterator i = rle_out.rbegin(); i != rle_out.rend(); ++i) {
-      std::cout << (*i).second << std::endl;
+  if (summary) writer.setClock(&clock);
+  HitBatch *batch;
+  while (to_write.pop(batch)) {
+    clock.enter(PhaseClock::SORT);
+    for (size_t h = 0; h < batch->hits.size(); h++) {
+      const Hit &hit(batch->hits[h]);
+      writer.add(2 * hit.variant + (hit.kld ? 1 : 0), hit.score, batch->hit_text.data() + hit.begin, hit.length);
     }
-    for (std::vector<std::pair<double, std::string> >::reverse_iterator i = kld_out.rbegin(); i != kld_out.rend(); ++i) {
-      std::cout << (*i).second << std::endl;
+    delete batch;
+    clock.enter(PhaseClock::IDLE);
+  }
+  progress.stop();
+  progress_thread.join();
+
+  read_thread.join();
+  NullTable null_scores;
+  if (settings.calibrate) null_scores.setBuckets(bucket_names);
+  std::vector<GHMM::Profile> profiles(variants.size());
+  bool perf_multiplexed = false;
+  RunSummary run_summary;
+  run_summary.threads = n_threads;
+  run_summary.phases.merge(read_stage.clock);
+  run_summary.allocations.merge(read_stage.allocations);
+  for (int t = 0; t < n_threads; t++) {
+    predict_threads[t]->join();
+    null_scores.merge(predict_stages[t]->null_scores);
+    for (int m = 0; m < (int)variants.size(); m++) {
+      profiles[m].merge(predict_stages[t]->profiles[m]);
     }
-  } else {
-    std::ofstream out;
-    out.open(output.c_str());
+    perf_multiplexed = perf_multiplexed || predict_stages[t]->perf_multiplexed;
+    run_summary.sequences += predict_stages[t]->done.sequences;
+    run_summary.residues += predict_stages[t]->done.residues;
+    run_summary.phases.merge(predict_stages[t]->clock);
+    run_summary.allocations.merge(predict_stages[t]->allocations);
+    run_summary.slowest.merge(predict_stages[t]->slowest);
+    delete predict_threads[t];
+    delete predict_stages[t];
+  }
 
-    for (std::vector<std::pair<double, std::string> >::reverse_iterator i = rle_out.rbegin(); i != rle_out.rend(); ++i) {
-      out << (*i).second << std::endl;
+  if (settings.calibrate) {
+    if (!null_scores.write(calibrate_path)) {
+      std::cerr << "could not write " << calibrate_path << std::endl;
+      exit(1);
     }
-    for (std::vector<std::pair<double, std::string> >::reverse_iterator i = kld_out.rbegin(); i != kld_out.rend(); ++i) {
-      out << (*i).second << std::endl;
+    for (int k = 0; k < null_scores.buckets(); k++) {
+      std::cerr << null_scores.samples(k) << " null scores for " << bucket_names[k] << std::endl;
+    }
+  }
+
+  clock.enter(PhaseClock::SORT);
+  writer.finish();
+  if (out != stdout) fclose(out);
+  clock.enter(PhaseClock::IDLE);
+
+  if (settings.profile) {
+    FILE *fp = stderr;
+    if (profile_path != "-") {
+      fp = fopen(profile_path.c_str(), "w");
+      if (fp == NULL) {
+        std::cerr << "could not open " << profile_path << std::endl;
+        exit(1);
+      }
+    }
+    if (perf_multiplexed) {
+      fprintf(fp, "# hardware counters were shared, and only counted part of the time\n");
+    }
+    for (int m = 0; m < (int)variants.size(); m++) {
+      writeProfile(fp, *variants[m], profiles[m], settings.perf);
+    }
+    if (fp != stderr) fclose(fp);
+  }
+
+  for (int m = 0; m < (int)variants.size(); m++) {
+    delete variants[m];
+  }
+  delete simulator;
+
+  if (summary) {
+    run_summary.wall_seconds = PhaseClock::now() - start_time;
+    run_summary.phases.merge(clock);
+    run_summary.allocations.merge(AllocationCounts::thisThread());
+    if (!run_summary.write(summary_path)) {
+      std::cerr << "could not write " << summary_path << std::endl;
+      exit(1);
     }
   }
 }
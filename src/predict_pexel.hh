@@ -1,21 +1,100 @@
 #ifndef PREDICT_PEXEL_HH_INCLUDED
 #define PREDICT_PEXEL_HH_INCLUDED
 
+#include <stdio.h>
+#include <stdlib.h>
 #include <string>
 #include <utility>
 #include <GHMM/ghmm.hh>
+#include <GHMM/string_funcs.hh>
 
-#define RLE_PATTERN
-#define KLD_PATTERN
+#define ARRAYLEN(x) (sizeof(x) / sizeof(x[0]))
+#define ENDOF(x) ((x) + ARRAYLEN(x))
 
+// Model variant selection. These used to be the compile time
+// VERSION, SIGNALP_MODEL, HALDAR_MOTIF, RLE_PATTERN and KLD_PATTERN
+// switches. A variant may instead come from a model file (see
+// model_file.hh), as written by exportpred-train; version and
+// signalp_model then only select the signal sequence model used for
+// simulation.
+struct PEXELModelOptions {
+  int version;
+  bool signalp_model;
+  bool haldar_motif;
+  bool rle_pattern;
+  bool kld_pattern;
+  std::string model_file;
+  // approximations of the histogram state lengths, to make the parse
+  // cheaper (see ModelFile::truncateLengths() and splitLengthTails()):
+  // drop the longest lengths with at most trim_mass probability, and
+  // give states a head of tail_head lengths and a geometric tail. 0
+  // leaves the lengths alone.
+  double trim_mass;
+  int tail_head;
 
-// #define VERSION 1
-#define VERSION 2
+  PEXELModelOptions() : version(2), signalp_model(false), haldar_motif(false), rle_pattern(true), kld_pattern(true), model_file(), trim_mass(0.0), tail_head(0) {
+  }
 
-// #define SIGNALP_MODEL
-// #define HALDAR_MOTIF
+  // parse a comma separated variant spec, eg. "v1,signalp,no-kld",
+  // "file=trained.model" or "v2,trim=1e-4,tail=20".
+  bool parse(const std::string &spec) {
+    std::vector<std::string> toks = string::split(spec, ',');
+    for (int i = 0; i < (int)toks.size(); i++) {
+      std::string t = string::strip(toks[i]);
+      if      (t == "" || t == "default") { }
+      else if (t.compare(0, 5, "file=") == 0 && t.size() > 5) { model_file = t.substr(5); }
+      else if (t == "v1")                 { version = 1; }
+      else if (t == "v2")                 { version = 2; }
+      else if (t == "signalp")            { signalp_model = true; }
+      else if (t == "ss")                 { signalp_model = false; }
+      else if (t == "haldar")             { haldar_motif = true; }
+      else if (t == "rle")                { rle_pattern = true; }
+      else if (t == "no-rle")             { rle_pattern = false; }
+      else if (t == "kld")                { kld_pattern = true; }
+      else if (t == "no-kld")             { kld_pattern = false; }
+      else if (t.compare(0, 5, "trim=") == 0) {
+        char *end;
+        trim_mass = strtod(t.c_str() + 5, &end);
+        if (*end || !(trim_mass >= 0.0 && trim_mass < 1.0)) return false;
+      }
+      else if (t.compare(0, 5, "tail=") == 0) {
+        char *end;
+        tail_head = strtol(t.c_str() + 5, &end, 10);
+        if (*end || tail_head < 0) return false;
+      }
+      else return false;
+    }
+    return true;
+  }
 
-#define ARRAYLEN(x) (sizeof(x) / sizeof(x[0]))
-#define ENDOF(x) ((x) + ARRAYLEN(x))
+  std::string name() const {
+    std::string result;
+    if (model_file.size()) {
+      result = "file=" + model_file;
+    } else {
+      result = version == 1 ? "v1" : "v2";
+      if (signalp_model) result += ",signalp";
+      if (haldar_motif)  result += ",haldar";
+      if (!rle_pattern)  result += ",no-rle";
+      if (!kld_pattern)  result += ",no-kld";
+    }
+    if (trim_mass > 0.0) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), ",trim=%g", trim_mass);
+      result += buf;
+    }
+    if (tail_head > 0) {
+      char buf[32];
+      snprintf(buf, sizeof(buf), ",tail=%d", tail_head);
+      result += buf;
+    }
+    return result;
+  }
+};
+
+GHMM::Model::Ptr makePEXELmodel(const PEXELModelOptions &opts);
+
+std::pair<std::string, std::string> makeSignalPModel(GHMM::ModelBuilder &mb, GHMM::UTIL::Alphabet::Ptr &alphabet);
+std::pair<std::string, std::string> makeSSModel(GHMM::ModelBuilder &mb, GHMM::UTIL::Alphabet::Ptr &alphabet, int version);
 
 #endif
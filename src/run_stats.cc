@@ -0,0 +1,317 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include "run_stats.hh"
+
+#include <algorithm>
+#include <new>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <sys/time.h>
+#include <sys/resource.h>
+
+#if defined(__GNUC__)
+#define THREAD_LOCAL __thread
+#endif
+
+#if __cplusplus >= 201103L
+#define NEW_THROWS
+#define NO_THROW noexcept
+#else
+#define NEW_THROWS throw(std::bad_alloc)
+#define NO_THROW throw()
+#endif
+
+PhaseClock::PhaseClock() : enabled(false), started(false), phase(IDLE), wall_start(0.0), cpu_start(0.0) {
+  std::fill(wall_total, wall_total + PHASES, 0.0);
+  std::fill(cpu_total, cpu_total + PHASES, 0.0);
+}
+
+PhaseClock::Phase PhaseClock::enter(Phase p) {
+  Phase prev = phase;
+  if (!enabled || p == phase) return prev;
+
+  double wall = now(), cpu = threadCPU();
+  if (started) {
+    wall_total[phase] += wall - wall_start;
+    cpu_total[phase] += cpu - cpu_start;
+  }
+  started = true;
+  wall_start = wall;
+  cpu_start = cpu;
+  phase = p;
+  return prev;
+}
+
+void PhaseClock::merge(const PhaseClock &o) {
+  for (int p = 0; p < PHASES; p++) {
+    wall_total[p] += o.wall_total[p];
+    cpu_total[p] += o.cpu_total[p];
+  }
+}
+
+const char *PhaseClock::name(Phase p) {
+  static const char *names[PHASES] = { "idle", "read", "build", "parse", "traceback", "sort", "write" };
+  return names[p];
+}
+
+double PhaseClock::now() {
+  struct timespec ts;
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+double PhaseClock::threadCPU() {
+  struct timespec ts;
+  if (clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts) != 0) return 0.0;
+  return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+#ifdef THREAD_LOCAL
+static THREAD_LOCAL uint64_t thread_allocations, thread_allocated_bytes;
+// set by enable() before any other thread starts, and only read after.
+static bool counting = false;
+
+static inline void countAllocation(size_t n) {
+  if (!counting) return;
+  thread_allocations++;
+  thread_allocated_bytes += n;
+}
+
+static void *allocate(size_t n, size_t align) {
+  countAllocation(n);
+  if (n == 0) n = 1;
+  while (1) {
+    void *p = NULL;
+    if (align <= sizeof(void *)) {
+      p = malloc(n);
+    } else if (posix_memalign(&p, align, n) != 0) {
+      p = NULL;
+    }
+    if (p != NULL) return p;
+    std::new_handler h = std::set_new_handler(0);
+    std::set_new_handler(h);
+    if (h == 0) throw std::bad_alloc();
+    h();
+  }
+}
+
+static void *allocateNoThrow(size_t n, size_t align) {
+  try {
+    return allocate(n, align);
+  } catch (const std::bad_alloc &) {
+    return NULL;
+  }
+}
+
+// every replaceable form of operator new and delete, so that all of
+// them agree on malloc() and free(); counted per thread once enable()
+// has been called.
+void *operator new(size_t n) NEW_THROWS {
+  return allocate(n, 0);
+}
+void *operator new[](size_t n) NEW_THROWS {
+  return allocate(n, 0);
+}
+void *operator new(size_t n, const std::nothrow_t &) NO_THROW {
+  return allocateNoThrow(n, 0);
+}
+void *operator new[](size_t n, const std::nothrow_t &) NO_THROW {
+  return allocateNoThrow(n, 0);
+}
+void operator delete(void *p) NO_THROW {
+  free(p);
+}
+void operator delete[](void *p) NO_THROW {
+  free(p);
+}
+void operator delete(void *p, const std::nothrow_t &) NO_THROW {
+  free(p);
+}
+void operator delete[](void *p, const std::nothrow_t &) NO_THROW {
+  free(p);
+}
+
+#if __cplusplus >= 201402L
+void operator delete(void *p, size_t) NO_THROW {
+  free(p);
+}
+void operator delete[](void *p, size_t) NO_THROW {
+  free(p);
+}
+#endif
+
+#if __cplusplus >= 201703L
+void *operator new(size_t n, std::align_val_t a) {
+  return allocate(n, (size_t)a);
+}
+void *operator new[](size_t n, std::align_val_t a) {
+  return allocate(n, (size_t)a);
+}
+void *operator new(size_t n, std::align_val_t a, const std::nothrow_t &) NO_THROW {
+  return allocateNoThrow(n, (size_t)a);
+}
+void *operator new[](size_t n, std::align_val_t a, const std::nothrow_t &) NO_THROW {
+  return allocateNoThrow(n, (size_t)a);
+}
+void operator delete(void *p, std::align_val_t) NO_THROW {
+  free(p);
+}
+void operator delete[](void *p, std::align_val_t) NO_THROW {
+  free(p);
+}
+void operator delete(void *p, size_t, std::align_val_t) NO_THROW {
+  free(p);
+}
+void operator delete[](void *p, size_t, std::align_val_t) NO_THROW {
+  free(p);
+}
+void operator delete(void *p, std::align_val_t, const std::nothrow_t &) NO_THROW {
+  free(p);
+}
+void operator delete[](void *p, std::align_val_t, const std::nothrow_t &) NO_THROW {
+  free(p);
+}
+#endif
+
+void AllocationCounts::enable() {
+  counting = true;
+}
+
+bool AllocationCounts::available() {
+  return true;
+}
+
+AllocationCounts AllocationCounts::thisThread() {
+  AllocationCounts result;
+  result.count = thread_allocations;
+  result.bytes = thread_allocated_bytes;
+  return result;
+}
+#else
+void AllocationCounts::enable() {
+}
+
+bool AllocationCounts::available() {
+  return false;
+}
+
+AllocationCounts AllocationCounts::thisThread() {
+  return AllocationCounts();
+}
+#endif
+
+void SlowSequences::add(double seconds, const char *name, size_t name_len, uint64_t residues) {
+  if (!wants(seconds)) return;
+  if (heap.size() == n) {
+    std::pop_heap(heap.begin(), heap.end());
+    heap.pop_back();
+  }
+  Entry e;
+  e.seconds = seconds;
+  e.name.assign(name, name_len);
+  e.residues = residues;
+  heap.push_back(e);
+  std::push_heap(heap.begin(), heap.end());
+}
+
+void SlowSequences::merge(const SlowSequences &o) {
+  for (size_t i = 0; i < o.heap.size(); i++) {
+    const Entry &e(o.heap[i]);
+    add(e.seconds, e.name.data(), e.name.size(), e.residues);
+  }
+}
+
+std::vector<SlowSequences::Entry> SlowSequences::sorted() const {
+  std::vector<Entry> result(heap);
+  std::sort(result.begin(), result.end());
+  return result;
+}
+
+// the sequence name as a JSON string. names are only cut at the end
+// of the header line, so anything but a newline may turn up.
+static void writeString(FILE *fp, const std::string &s) {
+  fputc('"', fp);
+  for (size_t i = 0; i < s.size(); i++) {
+    unsigned char c = s[i];
+    if (c == '"' || c == '\\') {
+      fprintf(fp, "\\%c", c);
+    } else if (c < 0x20) {
+      fprintf(fp, "\\u%04x", c);
+    } else {
+      fputc(c, fp);
+    }
+  }
+  fputc('"', fp);
+}
+
+bool RunSummary::write(const std::string &path) const {
+  FILE *fp = stderr;
+  if (path != "-") {
+    fp = fopen(path.c_str(), "w");
+    if (fp == NULL) return false;
+  }
+
+  struct rusage usage;
+  getrusage(RUSAGE_SELF, &usage);
+  double user = usage.ru_utime.tv_sec + usage.ru_utime.tv_usec * 1e-6;
+  double sys = usage.ru_stime.tv_sec + usage.ru_stime.tv_usec * 1e-6;
+
+  fprintf(fp, "{\n  \"threads\": %d,\n  \"sequences\": %llu,\n  \"residues\": %llu,\n", threads,
+          (unsigned long long)sequences, (unsigned long long)residues);
+  fprintf(fp, "  \"wall_seconds\": %.3f,\n  \"user_seconds\": %.3f,\n  \"system_seconds\": %.3f,\n", wall_seconds, user, sys);
+  fprintf(fp, "  \"residues_per_sec\": %.1f,\n", wall_seconds > 0 ? residues / wall_seconds : 0.0);
+
+  fprintf(fp, "  \"phases\": {\n");
+  for (int p = PhaseClock::READ; p < PhaseClock::PHASES; p++) {
+    PhaseClock::Phase ph = (PhaseClock::Phase)p;
+    fprintf(fp, "    \"%s\": { \"wall_seconds\": %.3f, \"cpu_seconds\": %.3f }%s\n", PhaseClock::name(ph),
+            phases.wall(ph), phases.cpu(ph), p < PhaseClock::PHASES - 1 ? "," : "");
+  }
+  fprintf(fp, "  },\n");
+
+  // ru_maxrss is in kilobytes on Linux.
+  fprintf(fp, "  \"peak_rss_bytes\": %llu,\n", (unsigned long long)usage.ru_maxrss * 1024);
+  if (AllocationCounts::available()) {
+    fprintf(fp, "  \"allocations\": { \"count\": %llu, \"bytes\": %llu },\n",
+            (unsigned long long)allocations.count, (unsigned long long)allocations.bytes);
+  } else {
+    fprintf(fp, "  \"allocations\": null,\n");
+  }
+
+  std::vector<SlowSequences::Entry> slow(slowest.sorted());
+  fprintf(fp, "  \"slowest\": [\n");
+  for (size_t i = 0; i < slow.size(); i++) {
+    fprintf(fp, "    { \"name\": ");
+    writeString(fp, slow[i].name);
+    fprintf(fp, ", \"residues\": %llu, \"seconds\": %.6f }%s\n", (unsigned long long)slow[i].residues,
+            slow[i].seconds, i + 1 < slow.size() ? "," : "");
+  }
+  fprintf(fp, "  ]\n}\n");
+
+  bool ok = !ferror(fp);
+  if (fp != stderr) ok = fclose(fp) == 0 && ok;
+  return ok;
+}
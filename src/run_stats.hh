@@ -0,0 +1,124 @@
+#ifndef RUN_STATS_HH_INCLUDED
+#define RUN_STATS_HH_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// Where the time of a run goes, for exportpred --summary. Each thread
+// keeps its own clock and switches it from phase to phase as it
+// works; time spent waiting for other threads is charged to IDLE,
+// which is not reported. Wall clock time is summed over threads, so a
+// phase run by n threads at once counts n seconds per second. A clock
+// that has not been enabled costs a test per switch; once enabled, it
+// must only be switched by one thread.
+class PhaseClock {
+public:
+  enum Phase { IDLE, READ, BUILD, PARSE, TRACEBACK, SORT, WRITE, PHASES };
+
+protected:
+  bool enabled, started;
+  Phase phase;
+  double wall_start, cpu_start;
+  double wall_total[PHASES], cpu_total[PHASES];
+
+public:
+  PhaseClock();
+
+  // time from the next switch on.
+  void enable() {
+    enabled = true;
+  }
+
+  // charge the time since the last switch to the current phase and
+  // move on to p. returns the phase left, so that callers can return
+  // to it.
+  Phase enter(Phase p);
+
+  void merge(const PhaseClock &o);
+
+  double wall(Phase p) const {
+    return wall_total[p];
+  }
+  double cpu(Phase p) const {
+    return cpu_total[p];
+  }
+  static const char *name(Phase p);
+
+  // monotonic wall clock, and the calling thread's CPU time, in
+  // seconds.
+  static double now();
+  static double threadCPU();
+};
+
+// operator new calls, and the bytes they asked for, made by the
+// calling thread since enable() was called. enable() must be called
+// before any other thread starts; until then operator new costs one
+// test. counting needs thread local variables; without them the
+// counts stay at 0 and available() is false.
+struct AllocationCounts {
+  uint64_t count, bytes;
+
+  AllocationCounts() : count(0), bytes(0) {
+  }
+
+  static void enable();
+  static bool available();
+  static AllocationCounts thisThread();
+
+  void merge(const AllocationCounts &o) {
+    count += o.count;
+    bytes += o.bytes;
+  }
+};
+
+// The n slowest sequences seen. names are only copied for sequences
+// that make the list.
+class SlowSequences {
+public:
+  struct Entry {
+    double seconds;
+    std::string name;
+    uint64_t residues;
+
+    bool operator<(const Entry &o) const {
+      return seconds > o.seconds;
+    }
+  };
+
+protected:
+  size_t n;
+  // a min-heap on seconds, so the fastest kept is at the front.
+  std::vector<Entry> heap;
+
+public:
+  SlowSequences(size_t keep = 10) : n(keep), heap() {
+  }
+
+  bool wants(double seconds) const {
+    return heap.size() < n || (n && seconds > heap.front().seconds);
+  }
+  void add(double seconds, const char *name, size_t name_len, uint64_t residues);
+  void merge(const SlowSequences &o);
+
+  // slowest first.
+  std::vector<Entry> sorted() const;
+};
+
+struct RunSummary {
+  int threads;
+  uint64_t sequences, residues;
+  double wall_seconds;
+  PhaseClock phases;
+  AllocationCounts allocations;
+  SlowSequences slowest;
+
+  RunSummary() : threads(1), sequences(0), residues(0), wall_seconds(0.0), phases(), allocations(), slowest() {
+  }
+
+  // write the summary, with the process's CPU time and peak memory
+  // use, as a JSON object to path ("-" means stderr).
+  bool write(const std::string &path) const;
+};
+
+#endif
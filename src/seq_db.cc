@@ -0,0 +1,271 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include "seq_db.hh"
+
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/stat.h>
+
+#if HAVE_MMAP && HAVE_SYS_MMAN_H
+#include <sys/mman.h>
+#define USE_MMAP 1
+#endif
+
+const char SeqDB::MAGIC[8] = { 'E', 'P', 'S', 'E', 'Q', 'D', 'B', '\0' };
+
+SeqDB::SeqDB() : map_base(NULL), map_len(0), buf(), header(NULL), res(NULL), seq_offsets(NULL), name_offsets(NULL), names(NULL), hashes(NULL), texts(NULL), err() {
+}
+
+SeqDB::~SeqDB() {
+  close();
+}
+
+bool SeqDB::probe(const char *path) {
+  char m[sizeof(MAGIC)];
+  int fd = ::open(path, O_RDONLY);
+  if (fd == -1) return false;
+  bool result = ::read(fd, m, sizeof(m)) == sizeof(m) && !memcmp(m, MAGIC, sizeof(m));
+  ::close(fd);
+  return result;
+}
+
+uint64_t SeqDB::hash(const unsigned char *codes, const char *text, size_t len) {
+  uint64_t h = 14695981039346656037ULL;
+  for (size_t i = 0; i < len; i++) {
+    h ^= codes[i];
+    h *= 1099511628211ULL;
+  }
+  for (size_t i = 0; i < len; i++) {
+    h ^= (unsigned char)text[i];
+    h *= 1099511628211ULL;
+  }
+  return h;
+}
+
+bool SeqDB::open(const char *path) {
+  close();
+
+  int fd = ::open(path, O_RDONLY);
+  struct stat st;
+  if (fd == -1 || fstat(fd, &st) == -1) {
+    err = strerror(errno);
+    if (fd != -1) ::close(fd);
+    return false;
+  }
+  size_t len = st.st_size;
+  const char *data = NULL;
+
+#ifdef USE_MMAP
+  if (len) {
+    void *m = mmap(NULL, len, PROT_READ, MAP_PRIVATE, fd, 0);
+    if (m != MAP_FAILED) {
+      map_base = (char *)m;
+      map_len = len;
+      data = map_base;
+    }
+  }
+#endif
+
+  if (data == NULL) {
+    buf.resize(len + 1);
+    size_t got = 0;
+    while (got < len) {
+      ssize_t r = ::read(fd, &buf[got], len - got);
+      if (r == -1 && errno == EINTR) continue;
+      if (r <= 0) break;
+      got += r;
+    }
+    len = got;
+    data = &buf[0];
+  }
+  ::close(fd);
+
+  if (len < sizeof(SeqDBHeader)) {
+    err = "not a sequence database";
+    close();
+    return false;
+  }
+
+  header = (const SeqDBHeader *)data;
+  if (!check(len)) {
+    close();
+    return false;
+  }
+
+  res          = (const unsigned char *)(data + header->residues_offset);
+  seq_offsets  = (const uint64_t *)(data + header->seq_offsets_offset);
+  name_offsets = (const uint64_t *)(data + header->name_offsets_offset);
+  names        = data + header->names_offset;
+  hashes       = (const uint64_t *)(data + header->hashes_offset);
+  texts        = data + header->text_offset;
+
+  bool ok = seq_offsets[size()] == header->residues_size && name_offsets[size()] == header->names_size;
+  for (size_t i = 0; ok && i < size(); i++) {
+    ok = seq_offsets[i] <= seq_offsets[i + 1] && name_offsets[i] <= name_offsets[i + 1];
+  }
+  if (!ok) {
+    err = "corrupt sequence database";
+    close();
+    return false;
+  }
+  return true;
+}
+
+static bool fits(uint64_t offset, uint64_t size, uint64_t len) {
+  return offset <= len && size <= len - offset && offset % 8 == 0;
+}
+
+bool SeqDB::check(size_t len) {
+  if (memcmp(header->magic, MAGIC, sizeof(MAGIC))) {
+    err = "not a sequence database";
+    return false;
+  }
+  if (header->byte_order != ORDER_MARK) {
+    err = "sequence database was written with a different byte order";
+    return false;
+  }
+  if (header->version != FORMAT_VERSION) {
+    err = "unsupported sequence database version";
+    return false;
+  }
+
+  uint64_t table = 8 * (header->n_records + 1);
+  if (header->n_records > len / 8 ||
+      !fits(header->residues_offset, header->residues_size, len) ||
+      !fits(header->seq_offsets_offset, table, len) ||
+      !fits(header->name_offsets_offset, table, len) ||
+      !fits(header->names_offset, header->names_size, len) ||
+      !fits(header->hashes_offset, table - 8, len) ||
+      !fits(header->text_offset, header->residues_size, len)) {
+    err = "truncated sequence database";
+    return false;
+  }
+  return true;
+}
+
+void SeqDB::close() {
+#ifdef USE_MMAP
+  if (map_base) munmap(map_base, map_len);
+#endif
+  map_base = NULL;
+  map_len = 0;
+  std::vector<char>().swap(buf);
+  header = NULL;
+  res = NULL;
+  seq_offsets = name_offsets = hashes = NULL;
+  names = texts = NULL;
+}
+
+void SeqDB::shard(int i, int n, size_t &first, size_t &last) const {
+  uint64_t total = size() ? seq_offsets[size()] : 0;
+
+  first = last = size();
+  for (size_t r = 0; r < size(); r++) {
+    int s = total ? (int)(seq_offsets[r] * n / total) : 0;
+    if (s >= i && first == size()) first = r;
+    if (s >= i + 1) {
+      last = r;
+      break;
+    }
+  }
+  if (first > last) first = last;
+}
+
+SeqDBWriter::SeqDBWriter() : fp(NULL), text_fp(NULL), header(), seq_offsets(), name_offsets(), hashes(), names() {
+}
+
+SeqDBWriter::~SeqDBWriter() {
+  if (fp) fclose(fp);
+  if (text_fp) fclose(text_fp);
+}
+
+bool SeqDBWriter::open(const char *path) {
+  fp = fopen(path, "wb");
+  if (fp == NULL) return false;
+  text_fp = tmpfile();
+  if (text_fp == NULL) return false;
+
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, SeqDB::MAGIC, sizeof(header.magic));
+  header.version = SeqDB::FORMAT_VERSION;
+  header.byte_order = SeqDB::ORDER_MARK;
+  header.residues_offset = sizeof(header);
+
+  // the header is rewritten by finish().
+  seq_offsets.assign(1, 0);
+  name_offsets.assign(1, 0);
+  return fwrite(&header, sizeof(header), 1, fp) == 1;
+}
+
+bool SeqDBWriter::add(const char *name, size_t name_len, const unsigned char *codes, const char *text, size_t len) {
+  if (len && fwrite(codes, 1, len, fp) != len) return false;
+  if (len && fwrite(text, 1, len, text_fp) != len) return false;
+  seq_offsets.push_back(seq_offsets.back() + len);
+  names.append(name, name_len);
+  name_offsets.push_back(names.size());
+  hashes.push_back(SeqDB::hash(codes, text, len));
+  return true;
+}
+
+bool SeqDBWriter::pad() {
+  static const char zeros[8] = { 0 };
+  long at = ftell(fp);
+  return at >= 0 && (at % 8 == 0 || fwrite(zeros, 1, 8 - at % 8, fp) == (size_t)(8 - at % 8));
+}
+
+bool SeqDBWriter::finish() {
+  if (fp == NULL) return false;
+
+  header.n_records = hashes.size();
+  header.residues_size = seq_offsets.back();
+
+  bool ok = pad();
+  header.seq_offsets_offset = ftell(fp);
+  ok = ok && fwrite(&seq_offsets[0], sizeof(uint64_t), seq_offsets.size(), fp) == seq_offsets.size();
+  header.name_offsets_offset = ftell(fp);
+  ok = ok && fwrite(&name_offsets[0], sizeof(uint64_t), name_offsets.size(), fp) == name_offsets.size();
+  header.names_offset = ftell(fp);
+  header.names_size = names.size();
+  ok = ok && fwrite(names.data(), 1, names.size(), fp) == names.size();
+  ok = ok && pad();
+  header.text_offset = ftell(fp);
+  ok = ok && fflush(text_fp) == 0 && fseek(text_fp, 0, SEEK_SET) == 0;
+  char buf[65536];
+  size_t n;
+  while (ok && (n = fread(buf, 1, sizeof(buf), text_fp)) > 0) ok = fwrite(buf, 1, n, fp) == n;
+  ok = ok && !ferror(text_fp) && (uint64_t)ftell(fp) == header.text_offset + header.residues_size;
+  fclose(text_fp);
+  text_fp = NULL;
+  ok = ok && pad();
+  header.hashes_offset = ftell(fp);
+  ok = ok && (!hashes.size() || fwrite(&hashes[0], sizeof(uint64_t), hashes.size(), fp) == hashes.size());
+
+  ok = ok && fseek(fp, 0, SEEK_SET) == 0 && fwrite(&header, sizeof(header), 1, fp) == 1;
+  ok = (fclose(fp) == 0) && ok;
+  fp = NULL;
+  return ok;
+}
@@ -0,0 +1,127 @@
+#ifndef SEQ_DB_HH_INCLUDED
+#define SEQ_DB_HH_INCLUDED
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string>
+#include <vector>
+
+// A packed sequence database, as written by exportpred-pack. Residues
+// are stored already encoded (one byte each, in the codes of
+// FastaReader::residueAlphabet()), followed by tables of sequence
+// offsets, name offsets, the names themselves, the residue text each
+// sequence was packed from (as FastaReader::strip() leaves it, so hits
+// show the residues as the FASTA input had them), and a 64 bit FNV-1a
+// hash of each encoded sequence and its text, which verify() checks a
+// record against. All sections are 8 byte aligned, so the file can be
+// mapped and used in place.
+struct SeqDBHeader {
+  char magic[8];
+  uint32_t version;
+  uint32_t byte_order;
+  uint64_t n_records;
+  uint64_t residues_offset, residues_size;
+  uint64_t seq_offsets_offset;
+  uint64_t name_offsets_offset;
+  uint64_t names_offset, names_size;
+  uint64_t hashes_offset;
+  uint64_t text_offset;
+};
+
+class SeqDB {
+  SeqDB(const SeqDB &);
+  SeqDB &operator=(const SeqDB &);
+
+protected:
+  char *map_base;
+  size_t map_len;
+  std::vector<char> buf;
+
+  const SeqDBHeader *header;
+  const unsigned char *res;
+  const uint64_t *seq_offsets;
+  const uint64_t *name_offsets;
+  const char *names;
+  const uint64_t *hashes;
+  const char *texts;
+  std::string err;
+
+  bool check(size_t len);
+
+public:
+  static const char MAGIC[8];
+  static const uint32_t FORMAT_VERSION = 2;
+  static const uint32_t ORDER_MARK = 0x01020304;
+
+  SeqDB();
+  ~SeqDB();
+
+  // true if path starts with the database magic number.
+  static bool probe(const char *path);
+
+  static uint64_t hash(const unsigned char *codes, const char *text, size_t len);
+
+  bool open(const char *path);
+  void close();
+
+  const std::string &error() const {
+    return err;
+  }
+
+  size_t size() const {
+    return header ? header->n_records : 0;
+  }
+  const char *name(size_t i, size_t &len) const {
+    len = name_offsets[i + 1] - name_offsets[i];
+    return names + name_offsets[i];
+  }
+  const unsigned char *residues(size_t i, size_t &len) const {
+    len = seq_offsets[i + 1] - seq_offsets[i];
+    return res + seq_offsets[i];
+  }
+  // the text of record i's residues, one byte per residue.
+  const char *text(size_t i, size_t &len) const {
+    len = seq_offsets[i + 1] - seq_offsets[i];
+    return texts + seq_offsets[i];
+  }
+  uint64_t hash(size_t i) const {
+    return hashes[i];
+  }
+  // false if record i's residues or their text no longer match its
+  // hash.
+  bool verify(size_t i) const {
+    size_t len;
+    const unsigned char *codes = residues(i, len);
+    return hash(codes, texts + seq_offsets[i], len) == hashes[i];
+  }
+
+  // split the records into n contiguous shards with about the same
+  // number of residues, as FastaIndex::shard does.
+  void shard(int i, int n, size_t &first, size_t &last) const;
+};
+
+class SeqDBWriter {
+  SeqDBWriter(const SeqDBWriter &);
+  SeqDBWriter &operator=(const SeqDBWriter &);
+
+protected:
+  FILE *fp;
+  // residue text, until finish() copies it after the names.
+  FILE *text_fp;
+  SeqDBHeader header;
+  std::vector<uint64_t> seq_offsets, name_offsets, hashes;
+  std::string names;
+
+  bool pad();
+
+public:
+  SeqDBWriter();
+  ~SeqDBWriter();
+
+  bool open(const char *path);
+  // codes are the len residues of text, encoded.
+  bool add(const char *name, size_t name_len, const unsigned char *codes, const char *text, size_t len);
+  bool finish();
+};
+
+#endif
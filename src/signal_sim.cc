@@ -0,0 +1,83 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include "signal_sim.hh"
+
+#include <stdio.h>
+
+SignalSimulator::SignalSimulator(const PEXELModelOptions &opts, uint64_t s) : model(), seed(s) {
+  GHMM::UTIL::Alphabet::Ptr alphabet = new GHMM::UTIL::Alphabet();
+  alphabet->addCharTokenRange('A','Z');
+  GHMM::ModelBuilder mb;
+
+  GHMM::UTIL::EmissionDistributionParser::Ptr ep = new GHMM::UTIL::EmissionDistributionParser(alphabet);
+  GHMM::StateBase::Ptr a_met = GHMM::UTIL::makeState(NULL, new GHMM::EMISSION::Stateless(ep->parse("M: 1")));
+  mb.addState("met", a_met);
+  mb.addStateTransition(GHMM::Model::BEGIN, "met", 1);
+
+  std::pair<std::string, std::string> ss_states;
+
+  if (opts.signalp_model) {
+    ss_states = makeSignalPModel(mb, alphabet);
+  } else {
+    ss_states = makeSSModel(mb, alphabet, opts.version);
+  }
+
+  mb.addStateTransition("met", ss_states.first, 1);
+  mb.addStateTransition(ss_states.second, GHMM::Model::END, 1);
+
+  model = mb.make();
+  model->freeze();
+}
+
+SignalSimulator::~SignalSimulator() {
+  model->thaw();
+}
+
+void SignalSimulator::generate(uint64_t i, std::vector<unsigned char> &codes) const {
+  MATH::Random rng(seed, i);
+  std::vector<int> seq = model->generate(rng);
+
+  codes.resize(seq.size());
+  for (size_t j = 0; j < seq.size(); j++) {
+    codes[j] = seq[j];
+  }
+}
+
+void SignalSimulator::appendName(OutputBuffer &out, uint64_t i) {
+  char tmp[32];
+  int n = snprintf(tmp, sizeof(tmp), "sim%llu", (unsigned long long)i);
+  out.append(tmp, n);
+}
+
+void SignalSimulator::append(OutputBuffer &out, uint64_t i, bool fasta, std::vector<unsigned char> &scratch) const {
+  generate(i, scratch);
+  if (fasta) {
+    out.append('>');
+    appendName(out, i);
+    out.append('\n');
+  }
+
+  char *text = out.extend(scratch.size());
+  for (size_t j = 0; j < scratch.size(); j++) {
+    text[j] = 'A' + scratch[j];
+  }
+  out.append('\n');
+}
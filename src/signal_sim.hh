@@ -0,0 +1,39 @@
+#ifndef SIGNAL_SIM_HH_INCLUDED
+#define SIGNAL_SIM_HH_INCLUDED
+
+#include <stdint.h>
+#include <string>
+#include <vector>
+#include <GHMM/ghmm.hh>
+
+#include "predict_pexel.hh"
+#include "output_buffer.hh"
+
+// Generates sequences from the signal sequence part of a PEXEL model
+// variant: an initial Met followed by the signal sequence states.
+// Sequence i is drawn from stream i of the seed, so a simulated set
+// is the same however its generation is split between threads or
+// processes.
+class SignalSimulator {
+  SignalSimulator(const SignalSimulator &);
+  SignalSimulator &operator=(const SignalSimulator &);
+
+  GHMM::Model::Ptr model;
+  uint64_t seed;
+
+public:
+  SignalSimulator(const PEXELModelOptions &opts, uint64_t seed);
+  ~SignalSimulator();
+
+  // residue codes of sequence i, in FastaReader::residueAlphabet().
+  void generate(uint64_t i, std::vector<unsigned char> &codes) const;
+
+  // the name sequence i is given in FASTA output.
+  static void appendName(OutputBuffer &out, uint64_t i);
+
+  // append sequence i to out, as a single line of residues or as a
+  // FASTA record.
+  void append(OutputBuffer &out, uint64_t i, bool fasta, std::vector<unsigned char> &scratch) const;
+};
+
+#endif
@@ -83,22 +83,23 @@ std::pair<std::string, std::string> makeSignalPModel(GHMM::ModelBuilder &mb, GHM
     M:0.0128499 N:0.0274769 P:0.00634449 Q:0.111559 R:0.0426487\n\
     S:0.0832117 T:0.0493584 V:0.0492212 W:0.00964942 Y:0.0202909"));
 
+  static const double h1_lengths[] = {
+    6.54977e-16,
+    3.7347e-12,
+    1.71429e-05,
+    0.00274341,
+    0.000951411,
+    0.00769368,
+    0.231647,
+    0.220435,
+    0.155337,
+    0.157697,
+    0.222918,
+    0.000560533,
+    1.92736e-08
+  };
   MATH::DPDF::Ptr h1_dpdf = new MATH::DPDF();
-  h1_dpdf->setDistrib(6, 19, (double[]){
-                        6.54977e-16,
-                          3.7347e-12,
-                          1.71429e-05,
-                          0.00274341,
-                          0.000951411,
-                          0.00769368,
-                          0.231647,
-                          0.220435,
-                          0.155337,
-                          0.157697,
-                          0.222918,
-                          0.000560533,
-                          1.92736e-08
-                          });
+  h1_dpdf->setDistrib(6, 19, h1_lengths);
 
   GHMM::LENGTH::Discrete::Ptr h1_length = new GHMM::LENGTH::Discrete(h1_dpdf);
 
@@ -154,6 +155,8 @@ std::pair<std::string, std::string> makeSignalPModel(GHMM::ModelBuilder &mb, GHM
   mb.addStateTransition("c2",            "c1",           1);
   mb.addStateTransition("c1",            "cut",          1);
 
-  // need to add non-emitting states.
+  // h1 enters the c region at each state directly. a GHMM::Silent
+  // state between them would not save any work, as each c state would
+  // still have two predecessors.
   return std::make_pair(std::string("a1"), std::string("cut"));
 }
@@ -19,52 +19,178 @@
 // CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
 // WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <iostream>
-#include <sstream>
 #include <vector>
-#include <list>
-#include <fstream>
+#include <string>
+#include <algorithm>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
 
-#include <GHMM/string_funcs.hh>
-#include <GHMM/ghmm.hh>
+#include "predict_pexel.hh"
+#include "signal_sim.hh"
+#include "output_buffer.hh"
+#include "pipeline.hh"
 
-std::pair<std::string, std::string> makeSignalPModel(GHMM::ModelBuilder &mb, GHMM::UTIL::Alphabet::Ptr &alphabet);
-std::pair<std::string, std::string> makeSSModel(GHMM::ModelBuilder &mb, GHMM::UTIL::Alphabet::Ptr &alphabet);
+// sequences per output block; blocks are dealt to the threads in turn
+// and written in order.
+#define BLOCK_SEQS 4096
+
+static const struct option options[] = {
+  { "seed",              required_argument,          0,            's' },
+  { "threads",           required_argument,          0,            't' },
+  { "fasta",             no_argument,                0,            'f' },
+  { "output",            required_argument,          0,            'o' },
+  { "model",             required_argument,          0,            'm' },
+  { 0,                   0,                          0,            0   }
+};
+
+void usage(const char *progname) {
+  std::cout << "Usage: " << progname << " [arguments] count [spec]" << std::endl;
+  std::cout << "\
+\n\
+Simulate count signal sequences, one per line.\n\
+\n\
+--seed=n                -s n           seed; a seed and count always give\n\
+                                       the same sequences, whatever the\n\
+                                       number of threads (default: taken\n\
+                                       from the time, and reported)\n\
+--threads=n             -t n           number of threads (default: 1)\n\
+--fasta                 -f             write FASTA records named sim<i>,\n\
+                                       as exportpred --simulate names them\n\
+--output=file           -o file        write to file (-:stdout)\n\
+--model=spec            -m spec        model variant, as accepted by\n\
+                                       exportpred --model; only the signal\n\
+                                       sequence part is used. may also be\n\
+                                       given as the second argument\n\
+\n\
+";
+}
+
+class SimulateStage {
+  const SignalSimulator &sim;
+  bool fasta;
+  uint64_t count;
+  int worker, workers;
+
+public:
+  BoundedQueue<OutputBuffer *> blocks;
+
+  SimulateStage(const SignalSimulator &s, bool f, uint64_t n, int w, int ws) :
+    sim(s), fasta(f), count(n), worker(w), workers(ws), blocks(2) {
+  }
+
+  void run() {
+    std::vector<unsigned char> scratch;
+    for (uint64_t b = worker; b * BLOCK_SEQS < count; b += workers) {
+      OutputBuffer *block = new OutputBuffer(1024 * 1024);
+      for (uint64_t i = b * BLOCK_SEQS; i < count && i < (b + 1) * BLOCK_SEQS; i++) {
+        sim.append(*block, i, fasta, scratch);
+      }
+      blocks.push(block);
+    }
+    blocks.done();
+  }
+};
 
 int main(int argc, char **argv) {
-  GHMM::UTIL::Alphabet::Ptr alphabet = new GHMM::UTIL::Alphabet();
-  alphabet->addCharTokenRange('A','Z');
-  GHMM::ModelBuilder mb;
-
-  GHMM::UTIL::EmissionDistributionParser::Ptr ep = new GHMM::UTIL::EmissionDistributionParser(alphabet);
-  GHMM::StateBase::Ptr a_met = GHMM::UTIL::makeState(NULL, new GHMM::EMISSION::Stateless(ep->parse("M: 1")));
-  mb.addState("met", a_met);
-  mb.addStateTransition(GHMM::Model::BEGIN, "met", 1);
-
-  std::pair<std::string, std::string> ss_states;
-
-#ifdef SIGNALP_MODEL
-  ss_states = makeSignalPModel(mb, alphabet);
-#else
-  ss_states = makeSSModel(mb, alphabet);
-#endif
-
-  mb.addStateTransition("met", ss_states.first, 1);
-  mb.addStateTransition(ss_states.second, GHMM::Model::END, 1);
-
-  GHMM::Model::Ptr model = mb.make();
-
-  // XXX: handle this with autoconf
-#if defined(__APPLE__)
-  srandomdev();
-#else
-  srandom(time(NULL));
-#endif
-
-  for (int i = 0, l = strtoul(argv[1], NULL, 10); i < l; i++) {
-    std::vector<int> temp = model->generate();
-    for (int j = 0; j < (int)temp.size(); j++) {
-      std::cout << (char)('A' + temp[j]);
+  PEXELModelOptions opts;
+  uint64_t seed = (uint64_t)time(NULL) ^ ((uint64_t)getpid() << 32);
+  bool seed_given = false;
+  int n_threads = 1;
+  bool fasta = false;
+  std::string output = "-";
+
+  int ch;
+
+  while ((ch = getopt_long(argc, argv, "s:t:fo:m:h", options, NULL)) != -1) {
+    switch (ch) {
+    case 's': {
+      seed = strtoull(optarg, NULL, 10);
+      seed_given = true;
+      break;
+    }
+    case 't': {
+      n_threads = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'f': {
+      fasta = true;
+      break;
+    }
+    case 'o': {
+      output = optarg;
+      break;
+    }
+    case 'm': {
+      if (!opts.parse(optarg)) {
+        std::cerr << "bad model spec: " << optarg << std::endl;
+        exit(1);
+      }
+      break;
+    }
+    case 'h':
+    case '?': {
+      usage(argv[0]);
+      exit(0);
+    }
     }
-    std::cout << std::endl;
+  }
+
+  if (optind >= argc) {
+    usage(argv[0]);
+    exit(1);
+  }
+  uint64_t count = strtoull(argv[optind], NULL, 10);
+  if (optind + 1 < argc && !opts.parse(argv[optind + 1])) {
+    std::cerr << "bad model spec: " << argv[optind + 1] << std::endl;
+    exit(1);
+  }
+  if (!seed_given) {
+    std::cerr << "seed: " << (unsigned long long)seed << std::endl;
+  }
+
+  FILE *out = stdout;
+  if (output != "-") {
+    out = fopen(output.c_str(), "w");
+    if (out == NULL) {
+      std::cerr << "could not open " << output << std::endl;
+      exit(1);
+    }
+  }
+
+  SignalSimulator sim(opts, seed);
+  std::vector<SimulateStage *> stages;
+  std::vector<Thread<SimulateStage> *> threads;
+
+  for (int t = 0; t < n_threads; t++) {
+    stages.push_back(new SimulateStage(sim, fasta, count, t, n_threads));
+    threads.push_back(new Thread<SimulateStage>);
+    if (!threads.back()->start(stages.back())) {
+      std::cerr << "could not start simulator thread" << std::endl;
+      exit(1);
+    }
+  }
+
+  for (uint64_t b = 0; b * BLOCK_SEQS < count; b++) {
+    OutputBuffer *block;
+    if (!stages[b % n_threads]->blocks.pop(block)) break;
+    if (!block->write(out)) {
+      std::cerr << "could not write output" << std::endl;
+      exit(1);
+    }
+    delete block;
+  }
+
+  for (int t = 0; t < n_threads; t++) {
+    threads[t]->join();
+    delete threads[t];
+    delete stages[t];
+  }
+
+  if (fflush(out) != 0 || (out != stdout && fclose(out) != 0)) {
+    std::cerr << "could not write output" << std::endl;
+    exit(1);
   }
 }
@@ -0,0 +1,1544 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#ifdef HAVE_CONFIG_H
+#include <GHMM/config.h>
+#endif
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <sys/wait.h>
+#include <algorithm>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include "predict_pexel.hh"
+#include "length_tables.hh"
+#include "fasta_reader.hh"
+#include "fasta_index.hh"
+#include "seq_db.hh"
+#include "pipeline.hh"
+#include "column_team.hh"
+#include "hit_writer.hh"
+#include "output_buffer.hh"
+#include "input_source.hh"
+#include "signal_sim.hh"
+#include "null_table.hh"
+#include "model_file.hh"
+#include "run_stats.hh"
+#include "perf_counters.hh"
+
+#if HAVE_LIBZ && HAVE_ZLIB_H
+#include <zlib.h>
+#define USE_ZLIB 1
+#endif
+
+// Checks run by make check. Each test reports the checks that fail;
+// the exit status is 1 if any check fails. A test name as the only
+// argument runs just that test.
+
+static int failures = 0;
+
+static void check(bool ok, const char *what, const char *file, int line) {
+  if (ok) return;
+  fprintf(stderr, "%s:%d: check failed: %s\n", file, line, what);
+  failures++;
+}
+#define CHECK(x) check((x), #x, __FILE__, __LINE__)
+
+static bool near(double a, double b, double tol = 1e-9) {
+  if (a == b) return true;
+  return fabs(a - b) <= tol * std::max(1.0, std::max(fabs(a), fabs(b)));
+}
+
+static std::string tmp_dir;
+
+static std::string tmpPath(const std::string &name) {
+  return tmp_dir + "/" + name;
+}
+
+static bool writeFile(const std::string &path, const std::string &text) {
+  FILE *fp = fopen(path.c_str(), "wb");
+  if (fp == NULL) return false;
+  bool ok = fwrite(text.data(), 1, text.size(), fp) == text.size();
+  return (fclose(fp) == 0) && ok;
+}
+
+// the read end of a pipe that a child process writes text into.
+static int pipeFrom(const std::string &text, pid_t &child) {
+  int fds[2];
+  if (pipe(fds) != 0) return -1;
+  child = fork();
+  if (child == 0) {
+    close(fds[0]);
+    size_t done = 0;
+    while (done < text.size()) {
+      ssize_t w = write(fds[1], text.data() + done, text.size() - done);
+      if (w <= 0) _exit(1);
+      done += w;
+    }
+    _exit(0);
+  }
+  close(fds[1]);
+  if (child == -1) {
+    close(fds[0]);
+    return -1;
+  }
+  return fds[0];
+}
+
+static void testVariantSpec() {
+  PEXELModelOptions opts;
+  CHECK(opts.name() == "v2");
+  CHECK(opts.parse("v1, signalp,no-kld"));
+  CHECK(opts.version == 1 && opts.signalp_model && !opts.haldar_motif && opts.rle_pattern && !opts.kld_pattern);
+  CHECK(opts.name() == "v1,signalp,no-kld");
+
+  // later tokens override earlier ones, and default changes nothing.
+  CHECK(opts.parse("ss,kld,default,v2"));
+  CHECK(opts.name() == "v2");
+
+  // every variant's name parses back to the same options.
+  for (int i = 0; i < 32; i++) {
+    PEXELModelOptions a, b;
+    a.version = i & 1 ? 1 : 2;
+    a.signalp_model = (i & 2) != 0;
+    a.haldar_motif = (i & 4) != 0;
+    a.rle_pattern = (i & 8) != 0;
+    a.kld_pattern = (i & 16) != 0;
+    CHECK(b.parse(a.name()));
+    CHECK(b.name() == a.name());
+    CHECK(b.version == a.version && b.signalp_model == a.signalp_model && b.haldar_motif == a.haldar_motif);
+    CHECK(b.rle_pattern == a.rle_pattern && b.kld_pattern == a.kld_pattern);
+  }
+
+  PEXELModelOptions bad;
+  CHECK(!bad.parse("v3"));
+  CHECK(!bad.parse("v1,signalp,frobnicate"));
+}
+
+static void testLengthTables() {
+  const LengthTable *tables[] = {
+    &a_spacer_lengths_v1, &a_spacer_lengths_v2, &b_leader_lengths, &b_hydrophobic_lengths_v2,
+    &leader_lengths_v1, &leader_lengths_v2, &hydrophobic_lengths_v2,
+  };
+  for (size_t i = 0; i < sizeof(tables) / sizeof(tables[0]); i++) {
+    const LengthTable &t(*tables[i]);
+    double sum = 0.0;
+    CHECK(t.min_d < t.max_d);
+    for (int l = 0; l < t.max_d - t.min_d; l++) {
+      sum += t.p[l];
+      CHECK(near(t.logp[l], MATH::logClip(t.p[l])));
+    }
+    CHECK(near(sum, 1.0));
+
+    GHMM::LENGTH::Discrete::Ptr length = t.make();
+    CHECK(length->minLength() == t.min_d && length->maxLength() == t.max_d);
+    for (int l = t.min_d; l < t.max_d; l++) CHECK(length->logpLength(l) == t.logp[l - t.min_d]);
+  }
+
+  // copies share static tables until they are modified.
+  static const double sp[] = { 0.25, 0.75 };
+  const double slp[] = { log(0.25), log(0.75) };
+  MATH::DPDF s;
+  s.setStaticDistrib(1, 3, sp, slp);
+  MATH::DPDF c(s);
+  c.setp(1, 0.5);
+  CHECK(sp[0] == 0.25 && s.p(1) == 0.25 && c.p(1) == 0.5);
+  CHECK(c.normalize() && near(c.p(2), 0.6) && s.p(2) == 0.75);
+}
+
+struct ReadRecord {
+  std::string name, seq;
+  off_t offset;
+};
+
+static std::vector<ReadRecord> readAll(FastaReader &reader) {
+  std::vector<ReadRecord> result;
+  FastaRecord rec;
+  while (reader.next(rec)) {
+    ReadRecord r;
+    std::vector<char> text(rec.seq_len + 1);
+    r.name = rec.nameString();
+    r.seq.assign(&text[0], FastaReader::strip(rec.seq, rec.seq_len, &text[0]));
+    r.offset = rec.offset;
+    result.push_back(r);
+  }
+  return result;
+}
+
+static void testFastaReader() {
+  std::string fa = tmpPath("reader.fa");
+  std::string text = "junk before\n>one first\nACD\r\nef\n\n>empty\n \n>two\nGH>IK\n>three\nLM";
+  CHECK(writeFile(fa, text));
+
+  // mmap()ed, and read through a pipe in blocks.
+  for (int piped = 0; piped < 2; piped++) {
+    FastaReader reader;
+    pid_t child = -1;
+    if (piped) {
+      int fd = pipeFrom(text, child);
+      CHECK(fd != -1 && reader.open(fd, true));
+      CHECK(!reader.stable());
+    } else {
+      CHECK(reader.open(fa.c_str()) && reader.stable());
+    }
+    std::vector<ReadRecord> recs = readAll(reader);
+    if (child > 0) waitpid(child, NULL, 0);
+
+    // records without residues are skipped; a > inside a line does
+    // not start one.
+    CHECK(recs.size() == 3);
+    if (recs.size() != 3) continue;
+    CHECK(recs[0].name == "one first" && recs[0].seq == "ACDef");
+    CHECK(recs[1].name == "two" && recs[1].seq == "GH>IK");
+    CHECK(recs[2].name == "three" && recs[2].seq == "LM");
+    CHECK(recs[0].offset == 12 && text[recs[1].offset] == '>' && text.compare(recs[2].offset, 6, ">three") == 0);
+  }
+
+  unsigned char codes[8];
+  static const unsigned char expect[] = { 0, 2, 3, 4, 5, 23 };
+  CHECK(FastaReader::residueAlphabet().encode("ac D\tef*\n", 9, codes) == 6);
+  CHECK(std::equal(expect, expect + 6, codes));
+
+  // records longer than the read buffer, through a pipe.
+  std::string big;
+  for (int i = 0; i < 2; i++) {
+    big += i ? ">second\n" : ">first\n";
+    for (int line = 0; line < 150000; line++) big += "ACDEFGHIKLMNPQRSTVWYACDEFGHIKLMNPQRSTVWYACDEFGHIKLMNPQRSTVWY\n";
+  }
+  FastaReader reader;
+  pid_t child = -1;
+  int fd = pipeFrom(big, child);
+  CHECK(fd != -1 && reader.open(fd, true));
+  std::vector<ReadRecord> recs = readAll(reader);
+  if (child > 0) waitpid(child, NULL, 0);
+  CHECK(recs.size() == 2);
+  for (size_t i = 0; i < recs.size(); i++) {
+    CHECK(recs[i].seq.size() == 150000 * 60);
+    CHECK(recs[i].seq.compare(recs[i].seq.size() - 20, 20, "ACDEFGHIKLMNPQRSTVWY") == 0);
+  }
+  if (recs.size() == 2) CHECK(recs[0].name == "first" && recs[1].name == "second" && recs[1].offset == (off_t)(big.size() / 2));
+}
+
+// a producer and consumer count for BoundedQueue, and a task tree for
+// WorkStealingQueue.
+struct Producer {
+  BoundedQueue<int> *queue;
+  int first, count;
+
+  void run() {
+    for (int i = first; i < first + count; i++) queue->push(i);
+    queue->done();
+  }
+};
+
+struct Consumer {
+  BoundedQueue<int> *queue;
+  long sum;
+  int count;
+
+  void run() {
+    int i;
+    while (queue->pop(i)) {
+      sum += i;
+      count++;
+    }
+  }
+};
+
+struct Splitter {
+  WorkStealingQueue<int> *queue;
+  int worker;
+  int *leaves;
+
+  // each task n > 1 pushes two halves; the leaves add up to the root.
+  void run() {
+    int n;
+    while (queue->pop(worker, n)) {
+      if (n > 1) {
+        queue->push(worker, n / 2);
+        queue->push(worker, n - n / 2);
+      } else {
+        atomicAdd(leaves, n);
+      }
+      queue->finish();
+    }
+  }
+};
+
+static void testQueues() {
+  const int producers = 3, consumers = 4, per_producer = 20000;
+  BoundedQueue<int> queue(8, producers);
+  Producer p[producers];
+  Consumer c[consumers];
+  {
+    Thread<Producer> pt[producers];
+    Thread<Consumer> ct[consumers];
+    for (int i = 0; i < consumers; i++) {
+      c[i].queue = &queue;
+      c[i].sum = 0;
+      c[i].count = 0;
+      CHECK(ct[i].start(&c[i]));
+    }
+    for (int i = 0; i < producers; i++) {
+      p[i].queue = &queue;
+      p[i].first = i * per_producer;
+      p[i].count = per_producer;
+      CHECK(pt[i].start(&p[i]));
+    }
+  }
+  long sum = 0, n = producers * per_producer;
+  int count = 0;
+  for (int i = 0; i < consumers; i++) {
+    sum += c[i].sum;
+    count += c[i].count;
+  }
+  CHECK(count == n);
+  CHECK(sum == n * (n - 1) / 2);
+
+  const int workers = 4, root = 100000;
+  int leaves = 0;
+  WorkStealingQueue<int> tasks(workers);
+  Splitter s[workers];
+  tasks.push(0, root);
+  {
+    Thread<Splitter> st[workers];
+    for (int i = 0; i < workers; i++) {
+      s[i].queue = &tasks;
+      s[i].worker = i;
+      s[i].leaves = &leaves;
+      CHECK(st[i].start(&s[i]));
+    }
+    tasks.close();
+  }
+  CHECK(leaves == root);
+}
+
+// hits for two buckets, with repeated scores, and what each mode
+// should write for them.
+static void makeHits(std::vector<std::pair<int, HitWriter::Hit> > &hits) {
+  hits.clear();
+  for (int i = 0; i < 2000; i++) {
+    char line[32];
+    snprintf(line, sizeof(line), "hit%d", (i * 7919) % 2000);
+    hits.push_back(std::make_pair(i % 3 == 0, HitWriter::Hit((i * 37) % 101 / 4.0, line)));
+  }
+}
+
+static std::string expectHits(const std::vector<std::pair<int, HitWriter::Hit> > &hits, HitWriter::Mode mode, size_t top_n) {
+  std::string result;
+  if (mode == HitWriter::UNSORTED) {
+    for (size_t i = 0; i < hits.size(); i++) result += hits[i].second.second + "\n";
+    return result;
+  }
+  for (int b = 0; b < 2; b++) {
+    std::vector<HitWriter::Hit> sorted;
+    for (size_t i = 0; i < hits.size(); i++) {
+      if (hits[i].first == b) sorted.push_back(hits[i].second);
+    }
+    std::sort(sorted.begin(), sorted.end(), std::greater<HitWriter::Hit>());
+    if (mode == HitWriter::TOP && sorted.size() > top_n) sorted.resize(top_n);
+    for (size_t i = 0; i < sorted.size(); i++) result += sorted[i].second + "\n";
+  }
+  return result;
+}
+
+static void testHitWriter() {
+  std::vector<std::pair<int, HitWriter::Hit> > hits;
+  makeHits(hits);
+
+  // sorted in memory, sorted through spilled runs, top-N and unsorted.
+  const HitWriter::Mode modes[] = { HitWriter::SORTED, HitWriter::SORTED, HitWriter::TOP, HitWriter::UNSORTED };
+  const size_t limits[] = { 0, 4096, 0, 0 };
+  for (int m = 0; m < 4; m++) {
+    FILE *out = tmpfile();
+    CHECK(out != NULL);
+    if (out == NULL) continue;
+    {
+      HitWriter writer(out, 2, modes[m], 25, limits[m]);
+      for (size_t i = 0; i < hits.size(); i++) {
+        const std::string &line(hits[i].second.second);
+        writer.add(hits[i].first, hits[i].second.first, line.data(), line.size());
+      }
+      writer.finish();
+    }
+    std::string text;
+    char buf[4096];
+    size_t r;
+    rewind(out);
+    while ((r = fread(buf, 1, sizeof(buf), out)) > 0) text.append(buf, r);
+    fclose(out);
+    CHECK(text == expectHits(hits, modes[m], 25));
+  }
+}
+
+static void testOutputBuffer() {
+  static const double values[] = { 0.0, -1.5, 12.345678, 1e-7, 123456789.0, 16.0699, -0.000125 };
+  OutputBuffer buf(4);
+  std::ostringstream expect;
+  for (size_t i = 0; i < sizeof(values) / sizeof(values[0]); i++) {
+    buf.append(values[i]);
+    buf.append('\t');
+    buf.append(std::string("x"));
+    buf.append("yz\n", 3);
+    expect << values[i] << '\t' << "x" << "yz\n";
+  }
+  CHECK(std::string(buf.data(), buf.size()) == expect.str());
+  buf.clear();
+  CHECK(buf.size() == 0 && *buf.data() == '\0');
+}
+
+#ifdef USE_ZLIB
+static void put16(std::string &s, unsigned v) {
+  s += (char)(v & 0xff);
+  s += (char)((v >> 8) & 0xff);
+}
+
+static void put32(std::string &s, unsigned long v) {
+  put16(s, v & 0xffff);
+  put16(s, (v >> 16) & 0xffff);
+}
+
+// text as one gzip member, or as a BGZF block, which is a gzip member
+// with the block size in a "BC" extra field.
+static std::string gzipMember(const std::string &text, bool bgzf) {
+  std::vector<unsigned char> out(compressBound(text.size()) + 64);
+  z_stream zs;
+  memset(&zs, 0, sizeof(zs));
+  deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -15, 8, Z_DEFAULT_STRATEGY);
+  zs.next_in = (Bytef *)text.data();
+  zs.avail_in = text.size();
+  zs.next_out = &out[0];
+  zs.avail_out = out.size();
+  deflate(&zs, Z_FINISH);
+  size_t n = zs.total_out;
+  deflateEnd(&zs);
+
+  std::string m("\x1f\x8b\x08", 3);
+  m += (char)(bgzf ? 4 : 0);
+  put32(m, 0);
+  m += '\0';
+  m += '\xff';
+  if (bgzf) {
+    put16(m, 6);
+    m += "BC";
+    put16(m, 2);
+    put16(m, 18 + n + 8 - 1);
+  }
+  m.append((const char *)&out[0], n);
+  put32(m, crc32(crc32(0, NULL, 0), (const Bytef *)text.data(), text.size()));
+  put32(m, text.size());
+  return m;
+}
+
+static void testCompressed() {
+  std::string text;
+  for (int i = 0; i < 300; i++) {
+    char rec[64];
+    snprintf(rec, sizeof(rec), ">seq%d\nMKLVACDEFG\nHIKLMN%d\n", i, i);
+    text += rec;
+  }
+
+  // two gzip members, and BGZF blocks split mid record with the empty
+  // end of file block.
+  std::string gz = gzipMember(text.substr(0, 1000), false) + gzipMember(text.substr(1000), false);
+  std::string bgzf;
+  for (size_t at = 0; at < text.size(); at += 777) bgzf += gzipMember(text.substr(at, 777), true);
+  bgzf += gzipMember("", true);
+
+  FastaReader plain;
+  CHECK(writeFile(tmpPath("plain.fa"), text) && plain.open(tmpPath("plain.fa").c_str()));
+  std::vector<ReadRecord> expect = readAll(plain);
+  CHECK(expect.size() == 300);
+
+  const std::string *inputs[] = { &gz, &bgzf, &bgzf };
+  const int threads[] = { 2, 0, 3 };
+  for (int i = 0; i < 3; i++) {
+    for (int piped = 0; piped < 2; piped++) {
+      FastaReader reader;
+      pid_t child = -1;
+      reader.setThreads(threads[i]);
+      if (piped) {
+        int fd = pipeFrom(*inputs[i], child);
+        CHECK(fd != -1 && reader.open(fd, true));
+      } else {
+        CHECK(writeFile(tmpPath("input.gz"), *inputs[i]) && reader.open(tmpPath("input.gz").c_str()));
+      }
+      std::vector<ReadRecord> recs = readAll(reader);
+      if (child > 0) waitpid(child, NULL, 0);
+      CHECK(!reader.failed());
+      CHECK(recs.size() == expect.size());
+      for (size_t r = 0; r < recs.size() && r < expect.size(); r++) {
+        CHECK(recs[r].name == expect[r].name && recs[r].seq == expect[r].seq);
+      }
+    }
+  }
+
+  // truncated and corrupt input are read errors.
+  for (int threaded = 0; threaded < 2; threaded++) {
+    FastaReader reader;
+    reader.setThreads(threaded);
+    CHECK(writeFile(tmpPath("short.gz"), gz.substr(0, gz.size() - 20)) && reader.open(tmpPath("short.gz").c_str()));
+    readAll(reader);
+    CHECK(reader.failed());
+
+    std::string bad = bgzf;
+    bad[30] ^= 0x55;
+    CHECK(writeFile(tmpPath("bad.gz"), bad) && reader.open(tmpPath("bad.gz").c_str()));
+    readAll(reader);
+    CHECK(reader.failed());
+
+    // a block claiming to inflate to 2 GiB is refused; threaded, before
+    // anything is allocated for it.
+    size_t bsize = ((unsigned char)bgzf[16] | ((unsigned char)bgzf[17] << 8)) + 1;
+    bad = bgzf;
+    bad[bsize - 1] = 0x7f;
+    CHECK(writeFile(tmpPath("huge.gz"), bad) && reader.open(tmpPath("huge.gz").c_str()));
+    readAll(reader);
+    CHECK(reader.failed());
+    if (threaded) CHECK(reader.error().find("64 KiB") != std::string::npos);
+  }
+}
+#else
+static void testCompressed() {
+  // without zlib, compressed input is refused with a message.
+  FastaReader reader;
+  CHECK(writeFile(tmpPath("input.gz"), std::string("\x1f\x8b\x08\0\0\0\0\0\0\xff", 10)));
+  CHECK(!reader.open(tmpPath("input.gz").c_str()) && reader.failed());
+}
+#endif
+
+static void testFastaIndex() {
+  std::string fa = tmpPath("index.fa");
+  std::string text = ">one first\nACDEF\nGHIK\n>two\nLMNPQRST\nVW\n>three x y\nACGT\n";
+  CHECK(writeFile(fa, text));
+
+  FastaReader reader;
+  FastaIndex built, loaded;
+  CHECK(reader.open(fa.c_str()) && reader.stable());
+  built.build(reader);
+  CHECK(!reader.failed());
+  CHECK(built.entries.size() == 3);
+  CHECK(built.write(FastaIndex::indexPath(fa)));
+  CHECK(loaded.read(FastaIndex::indexPath(fa)));
+  CHECK(loaded.entries.size() == built.entries.size());
+  if (loaded.entries.size() != 3) return;
+
+  static const char *names[] = { "one", "two", "three" };
+  static const size_t length[] = { 9, 10, 4 };
+  static const char first_residue[] = "ALA";
+  for (int i = 0; i < 3; i++) {
+    const FastaIndexEntry &a(built.entries[i]), &b(loaded.entries[i]);
+    CHECK(a.name == names[i] && b.name == a.name);
+    CHECK(a.length == length[i] && b.length == a.length);
+    CHECK(b.offset == a.offset && b.line_bases == a.line_bases && b.line_width == a.line_width);
+    CHECK(a.offset > 0 && (size_t)a.offset < text.size() && text[a.offset] == first_residue[i]);
+    CHECK(reader.recordStart(a.offset) != -1);
+  }
+  CHECK(built.entries[0].line_bases == 5 && built.entries[0].line_width == 6);
+  CHECK(built.entries[1].line_bases == 8 && built.entries[1].line_width == 9);
+
+  // shards are contiguous and cover every record once.
+  size_t first, last;
+  built.shard(0, 1, first, last);
+  CHECK(first == 0 && last == 3);
+  size_t next = 0;
+  for (int i = 0; i < 3; i++) {
+    built.shard(i, 3, first, last);
+    CHECK(first == next && last >= first);
+    next = last;
+  }
+  CHECK(next == 3);
+}
+
+static std::string upper(const char *s) {
+  std::string result(s);
+  for (size_t i = 0; i < result.size(); i++) result[i] = toupper(result[i]);
+  return result;
+}
+
+static void testSeqDB() {
+  std::string path = tmpPath("seqs.db");
+  static const char *names[] = { "alpha", "beta desc", "", "gamma" };
+  static const char *seqs[] = { "MKLV", "", "acdEFGHIKLMNPQRSTVWy", "W" };
+  const int n = 4;
+
+  SeqDBWriter writer;
+  CHECK(writer.open(path.c_str()));
+  for (int i = 0; i < n; i++) {
+    std::vector<unsigned char> codes(strlen(seqs[i]) + 1);
+    size_t len = FastaReader::residueAlphabet().encode(seqs[i], strlen(seqs[i]), &codes[0]);
+    CHECK(writer.add(names[i], strlen(names[i]), &codes[0], seqs[i], len));
+  }
+  CHECK(writer.finish());
+
+  CHECK(SeqDB::probe(path.c_str()));
+  SeqDB db;
+  CHECK(db.open(path.c_str()));
+  CHECK(db.size() == (size_t)n);
+  for (size_t i = 0; i < db.size(); i++) {
+    size_t name_len, len;
+    const char *name = db.name(i, name_len);
+    const unsigned char *codes = db.residues(i, len);
+    std::vector<char> decoded(len + 1);
+    FastaReader::decode(codes, len, &decoded[0]);
+    CHECK(std::string(name, name_len) == names[i]);
+    CHECK(std::string(&decoded[0], len) == upper(seqs[i]));
+    size_t text_len;
+    const char *text = db.text(i, text_len);
+    CHECK(text_len == len && std::string(text, len) == seqs[i]);
+    CHECK(db.hash(i) == SeqDB::hash(codes, text, len));
+    CHECK(db.verify(i));
+  }
+  db.close();
+
+  FILE *fp = fopen(path.c_str(), "rb");
+  std::string bytes;
+  char buf[4096];
+  size_t r;
+  while (fp && (r = fread(buf, 1, sizeof(buf), fp)) > 0) bytes.append(buf, r);
+  if (fp) fclose(fp);
+
+  // a changed residue fails its hash.
+  std::string bad = bytes;
+  bad[((const SeqDBHeader *)bytes.data())->residues_offset + 1] ^= 1;
+  CHECK(writeFile(path, bad));
+  CHECK(db.open(path.c_str()));
+  CHECK(!db.verify(0) && db.verify(1) && db.verify(2) && db.verify(3));
+  db.close();
+
+  // so does a changed residue of the text.
+  bad = bytes;
+  bad[((const SeqDBHeader *)bytes.data())->text_offset + 6] ^= 0x20;
+  CHECK(writeFile(path, bad));
+  CHECK(db.open(path.c_str()));
+  CHECK(db.verify(0) && db.verify(1) && !db.verify(2) && db.verify(3));
+  db.close();
+
+  // truncated files, bad offsets and other formats are refused.
+  CHECK(writeFile(path, bytes.substr(0, bytes.size() - 8)));
+  CHECK(!db.open(path.c_str()));
+  bad = bytes;
+  ((SeqDBHeader *)&bad[0])->names_size += 1000;
+  CHECK(writeFile(path, bad));
+  CHECK(!db.open(path.c_str()));
+  bad = bytes;
+  ((SeqDBHeader *)&bad[0])->version += 1;
+  CHECK(writeFile(path, bad));
+  CHECK(!db.open(path.c_str()));
+  CHECK(writeFile(path, ">not a database\nACDE\n"));
+  CHECK(!SeqDB::probe(path.c_str()) && !db.open(path.c_str()));
+}
+
+static GHMM::EMISSION::Base::Ptr emission(double a, double b, double c, double d) {
+  const double f[] = { a, b, c, d };
+  MATH::DPDF::Ptr dpdf = new MATH::DPDF();
+  dpdf->setDistrib(0, 4, f);
+  return new GHMM::EMISSION::Stateless(dpdf);
+}
+
+// copies and drops references to one object.
+struct RefUser {
+  MATH::DPDF::Ptr shared;
+
+  void run() {
+    for (int i = 0; i < 200000; i++) {
+      MATH::DPDF::Ptr copy(shared);
+      copy = NULL;
+    }
+  }
+};
+
+static void testSharedRefs() {
+  MATH::DPDF::Ptr d = new MATH::DPDF();
+  const int users = 4;
+  RefUser u[users];
+  {
+    Thread<RefUser> t[users];
+    for (int i = 0; i < users; i++) {
+      u[i].shared = d;
+      CHECK(t[i].start(&u[i]));
+    }
+  }
+  CHECK(d->refcount() == users + 1);
+  for (int i = 0; i < users; i++) u[i].shared = NULL;
+  CHECK(d->refcount() == 1);
+
+  // frozen objects are not counted.
+  d->freeze();
+  {
+    MATH::DPDF::Ptr copy(d);
+    CHECK(d->refcount() == 1 && d->frozen());
+  }
+  d->thaw();
+  CHECK(d->refcount() == 1 && !d->frozen());
+
+  GHMM::ModelBuilder mb;
+  mb.addState("s", GHMM::UTIL::makeState(new GHMM::LENGTH::Fixed(1), emission(0.5, 0.5, 0.0, 0.0)));
+  mb.addStateTransition(GHMM::Model::BEGIN, "s", 1.0);
+  mb.addStateTransition("s", GHMM::Model::END, 1.0);
+  GHMM::Model::Ptr model = mb.make();
+  model->freeze();
+  CHECK(model->frozen() && model->state(1)->frozen());
+  model->thaw();
+  CHECK(!model->frozen() && !model->state(1)->frozen());
+}
+
+static GHMM::LENGTH::Base::Ptr lengths(int a, double p0, double p1, double p2) {
+  const double f[] = { p0, p1, p2 };
+  MATH::DPDF::Ptr dpdf = new MATH::DPDF();
+  dpdf->setDistrib(a, a + 3, f);
+  return new GHMM::LENGTH::Discrete(dpdf);
+}
+
+// two states fanning out to three, and back. with silent, the fan
+// out goes through two silent states in a row and the way out through
+// a third, which gives the same distribution over parses.
+static GHMM::Model::Ptr fanModel(bool silent) {
+  static const double out[] = { 0.2, 0.5, 0.3 };
+  const char *s[] = { "s1", "s2" }, *t[] = { "t1", "t2", "t3" };
+  GHMM::ModelBuilder mb;
+
+  mb.addState("s1", GHMM::UTIL::makeState(new GHMM::LENGTH::Geometric(3.0), emission(0.4, 0.3, 0.2, 0.1)));
+  mb.addState("s2", GHMM::UTIL::makeState(lengths(1, 0.5, 0.3, 0.2), emission(0.1, 0.2, 0.3, 0.4)));
+  mb.addState("t1", GHMM::UTIL::makeState(new GHMM::LENGTH::Fixed(2), emission(0.25, 0.25, 0.4, 0.1)));
+  mb.addState("t2", GHMM::UTIL::makeState(new GHMM::LENGTH::Geometric(2.0), emission(0.7, 0.1, 0.1, 0.1)));
+  mb.addState("t3", GHMM::UTIL::makeState(lengths(2, 0.2, 0.6, 0.2), emission(0.1, 0.1, 0.1, 0.7)));
+  if (silent) {
+    // added first: the model orders them after the others, and hub0
+    // before hub.
+    mb.addState("hub", new GHMM::Silent());
+    mb.addState("hub0", new GHMM::Silent());
+    mb.addState("out", new GHMM::Silent());
+  }
+
+  mb.addStateTransition(GHMM::Model::BEGIN, "s1", 0.6);
+  mb.addStateTransition(GHMM::Model::BEGIN, "s2", 0.4);
+  for (int i = 0; i < 2; i++) {
+    if (silent) {
+      mb.addStateTransition(s[i], "hub0", 1.0);
+    } else {
+      for (int j = 0; j < 3; j++) mb.addStateTransition(s[i], t[j], out[j]);
+    }
+  }
+  if (silent) {
+    mb.addStateTransition("hub0", "hub", 1.0);
+    for (int j = 0; j < 3; j++) mb.addStateTransition("hub", t[j], out[j]);
+    mb.addStateTransition("out", GHMM::Model::END, 1.0);
+  }
+  for (int j = 0; j < 3; j++) {
+    mb.addStateTransition(t[j], "s1", 0.5);
+    mb.addStateTransition(t[j], silent ? "out" : GHMM::Model::END, 0.5);
+  }
+  return mb.make();
+}
+
+static std::vector<std::pair<int, int> > tracePath(const GHMM::Traceback *tb) {
+  std::vector<std::pair<int, int> > path;
+  for (; tb != NULL; tb = tb->prev.ptr()) path.push_back(std::make_pair(tb->state, (int)tb->length));
+  return path;
+}
+
+static void testColumnTeam() {
+  ThreadedColumnTeam team(3);
+  CHECK(team.start());
+
+  GHMM::Parse alone, shared;
+  unsigned seed = 11;
+  // odd rounds parse with silent states as well.
+  for (int n = 0; n < 30; n++) {
+    GHMM::Model::Ptr model = fanModel(n & 1);
+    std::vector<int> codes(10 + 17 * n);
+    for (size_t i = 0; i < codes.size(); i++) {
+      seed = seed * 1103515245 + 12345;
+      codes[i] = (seed >> 16) % 4;
+    }
+    alone.parse(model, codes.begin(), codes.end());
+    shared.parse(model, codes.begin(), codes.end(), &team);
+    for (int j = 1; j < model->stateCount() - 1; j++) {
+      CHECK(alone.delta(j, 0) == shared.delta(j, 0));
+      CHECK(alone.alpha(j, 0) == shared.alpha(j, 0));
+      CHECK(tracePath(alone.psi(j, 0).ptr()) == tracePath(shared.psi(j, 0).ptr()));
+    }
+  }
+}
+
+static void testAliasTable() {
+  static const double p[] = { 0.1, 0.0, 0.4, 0.2, 0.3 };
+  const int n = sizeof(p) / sizeof(p[0]), draws = 200000;
+  MATH::AliasTable table(p, n);
+  MATH::Random rng(17);
+  std::vector<int> counts(n, 0);
+
+  CHECK(table.size() == n);
+  for (int i = 0; i < draws; i++) counts[table.sample(rng)]++;
+  for (int i = 0; i < n; i++) {
+    double f = (double)counts[i] / draws;
+    // five standard deviations.
+    CHECK(fabs(f - p[i]) <= 5.0 * sqrt(p[i] * (1.0 - p[i]) / draws));
+  }
+  CHECK(counts[1] == 0);
+
+  static const double zeros[] = { 0.0, 0.0, 0.0 };
+  MATH::AliasTable none(zeros, 3);
+  bool last = true;
+  for (int i = 0; i < 100; i++) last = last && none.sample(rng) == 2;
+  CHECK(last);
+
+  // the same seed and stream generate the same sequences.
+  GHMM::Model::Ptr model = fanModel(false);
+  MATH::Random a(5, 1), b(5, 1), c(5, 2);
+  bool same = true, differ = false;
+  for (int i = 0; i < 20; i++) {
+    std::vector<int> x = model->generate(a), y = model->generate(b), z = model->generate(c);
+    same = same && x == y;
+    differ = differ || x != z;
+  }
+  CHECK(same);
+  CHECK(differ);
+}
+
+static void testSignalSim() {
+  static const char *variants[] = { "v1", "v2", "signalp" };
+  for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+    PEXELModelOptions opts;
+    CHECK(opts.parse(variants[v]));
+    SignalSimulator a(opts, 42), b(opts, 42), c(opts, 43);
+    const int n = 12;
+    std::vector<std::vector<unsigned char> > forward(n), backward(n);
+    std::vector<unsigned char> other;
+    bool differ = false;
+
+    // a sequence depends on its index, not on what was drawn before.
+    for (int i = 0; i < n; i++) a.generate(i, forward[i]);
+    for (int i = n - 1; i >= 0; i--) b.generate(i, backward[i]);
+    for (int i = 0; i < n; i++) {
+      CHECK(forward[i] == backward[i]);
+      CHECK(!forward[i].empty() && forward[i][0] == 'M' - 'A');
+      c.generate(i, other);
+      differ = differ || other != forward[i];
+    }
+    CHECK(differ);
+
+    OutputBuffer out;
+    std::string expect = ">sim3\n";
+    for (size_t j = 0; j < forward[3].size(); j++) expect += (char)('A' + forward[3][j]);
+    a.append(out, 3, true, other);
+    CHECK(std::string(out.data(), out.size()) == expect + "\n");
+  }
+}
+
+static void testNullTable() {
+  CHECK(NullTable::lengthBin(0) == 0 && NullTable::lengthBin(63) == 0);
+  CHECK(NullTable::lengthBin(64) == 1 && NullTable::lengthBin(127) == 1 && NullTable::lengthBin(128) == 2);
+  CHECK(NullTable::lengthBin(1000000000) == NullTable::LENGTH_BINS - 1);
+
+  std::vector<std::string> names;
+  names.push_back("v2 all");
+  names.push_back("v1 all");
+  NullTable a, b;
+  a.setBuckets(names);
+  b.setBuckets(names);
+  // bucket 0 gets 3000 scores from -5 to 25 at length 200, split
+  // between the two tables; bucket 1 a few at length 10.
+  for (int i = 0; i < 3000; i++) (i & 1 ? a : b).add(0, 200, -5.0 + i * 0.01);
+  for (int i = 0; i < 5; i++) b.add(1, 10, i);
+  a.merge(b);
+  CHECK(a.samples(0) == 3000 && a.samples(1) == 5);
+
+  std::string path = tmpPath("null.tab"), err;
+  CHECK(a.write(path));
+
+  // buckets are numbered as asked for, whatever the file order.
+  std::vector<std::string> want;
+  want.push_back("v1 all");
+  want.push_back("v2 all");
+  NullTable t;
+  CHECK(t.read(path, want, err));
+  CHECK(t.buckets() == 2 && t.samples(0) == 5 && t.samples(1) == 3000);
+
+  CHECK(near(t.pValue(1, 200, -50.0), 1.0));
+  CHECK(near(t.pValue(1, 200, 10.0), 1500.0 / 3001.0, 1e-3));
+  bool falling = true;
+  double last = 1.0;
+  for (double x = -10.0; x < 60.0; x += 0.37) {
+    double p = t.pValue(1, 200, x);
+    falling = falling && p <= last && p > 0.0;
+    last = p;
+  }
+  CHECK(falling);
+  // the exponential tail keeps grading scores above the largest seen.
+  CHECK(t.pValue(1, 200, 40.0) < t.pValue(1, 200, 30.0));
+  // lengths without scores use the nearest bin that has some.
+  CHECK(t.pValue(1, 10, 3.0) == t.pValue(1, 200, 3.0));
+  CHECK(t.pValue(1, 100000, 3.0) == t.pValue(1, 200, 3.0));
+
+  want.push_back("v1 pexel");
+  CHECK(!t.read(path, want, err));
+  CHECK(writeFile(path, "exportpred-null 2\n"));
+  CHECK(!t.read(path, names, err));
+  CHECK(!t.read(tmpPath("missing.tab"), names, err));
+}
+
+// log probability of codes under model, by the forward algorithm.
+static double forward(GHMM::Parse &parse, const GHMM::Model::Ptr &model, const std::vector<int> &codes) {
+  const GHMM::Model &m(*model);
+  int end = m.stateCount() - 1;
+  const std::vector<int> &last(m.predStates(end));
+  double z = MATH::LOG_ZERO;
+
+  parse.parse(model, codes.begin(), codes.end());
+  for (size_t i = 0; i < last.size(); i++) {
+    double a = parse.alpha(last[i], 0);
+    if (last[i] != 0 && a != MATH::LOG_ZERO) z = MATH::logAdd(a + m.logp(last[i], end), z);
+  }
+  return z;
+}
+
+// the same states and transitions, up to rounding.
+static bool sameModel(const ModelFile &a, const ModelFile &b) {
+  if (a.states.size() != b.states.size() || a.transitions.size() != b.transitions.size()) return false;
+  for (size_t i = 0; i < a.states.size(); i++) {
+    const ModelFile::State &s(a.states[i]), &t(b.states[i]);
+    if (s.name != t.name || s.length_kind != t.length_kind) return false;
+    // a state with columns is as long as its columns.
+    if (!s.position_specific && s.length_min != t.length_min) return false;
+    if (!near(s.p_self, t.p_self, 1e-12) || s.lengths.size() != t.lengths.size()) return false;
+    if (s.position_specific != t.position_specific || s.emit.size() != t.emit.size()) return false;
+    for (size_t l = 0; l < s.lengths.size(); l++) {
+      if (!near(s.lengths[l], t.lengths[l], 1e-12)) return false;
+    }
+    for (size_t k = 0; k < s.emit.size(); k++) {
+      for (size_t c = 0; c < s.emit[k].size(); c++) {
+        if (!near(s.emit[k][c], t.emit[k][c], 1e-12)) return false;
+      }
+    }
+  }
+  for (size_t i = 0; i < a.transitions.size(); i++) {
+    const ModelFile::Transition &s(a.transitions[i]), &t(b.transitions[i]);
+    if (s.from != t.from || s.to != t.to || !near(s.weight, t.weight, 1e-12)) return false;
+  }
+  return true;
+}
+
+static void testModelFile() {
+  static const char *variants[] = { "v1", "v2", "v1,haldar" };
+  static const char *seqs[] = {
+    "MKLLSKIFLFCVIASVVLSQHNIVYAKRNLAEIQDSSKKENLPKHVTE",
+    "MNFRKLLFVSLFLLCNLAFYESRLSEELEKGNAQRSKILEEVEKTSEGHAKEEIHQLFGAK",
+  };
+  std::string path = tmpPath("pexel.model"), err;
+
+  for (size_t v = 0; v < sizeof(variants) / sizeof(variants[0]); v++) {
+    PEXELModelOptions opts;
+    CHECK(opts.parse(variants[v]));
+    GHMM::Model::Ptr model = makePEXELmodel(opts);
+
+    ModelFile described, loaded;
+    CHECK(described.describe(*model, err));
+    CHECK(described.write(path));
+    CHECK(loaded.read(path, err));
+    CHECK(sameModel(described, loaded));
+
+    // a model read back scores sequences as the original does, and
+    // describes itself as the original did.
+    GHMM::Model::Ptr remade = loaded.make(err);
+    CHECK(remade->stateCount() == model->stateCount());
+    GHMM::Parse parse;
+    for (size_t i = 0; i < sizeof(seqs) / sizeof(seqs[0]); i++) {
+      std::vector<int> codes;
+      for (const char *c = seqs[i]; *c; c++) codes.push_back(*c - 'A');
+      double a = forward(parse, model, codes), b = forward(parse, remade, codes);
+      CHECK(a > MATH::LOG_ZERO && near(a, b, 1e-9 * fabs(a)));
+    }
+    ModelFile again;
+    CHECK(again.describe(*remade, err));
+    CHECK(sameModel(described, again));
+  }
+
+  ModelFile bad;
+  CHECK(writeFile(path, "exportpred-model 1\nstate x\nlength sometimes 3\n"));
+  CHECK(!bad.read(path, err));
+  CHECK(writeFile(path, "exportpred-model 1\nstate x\nemit A:1\ntransition x nowhere 1\n"));
+  CHECK(!bad.read(path, err));
+  CHECK(!bad.read(tmpPath("missing.model"), err));
+}
+
+static void testProfile() {
+  GHMM::Model::Ptr model = fanModel(false);
+  std::vector<int> codes(50);
+  for (size_t i = 0; i < codes.size(); i++) codes[i] = (i * 7 + i / 3) % 4;
+
+  GHMM::Parse plain, counted;
+  GHMM::Profile profile, twice;
+  plain.parse(model, codes.begin(), codes.end());
+  counted.setProfile(&profile);
+  counted.parse(model, codes.begin(), codes.end());
+  CHECK(profile.sequences == 1 && profile.residues == codes.size());
+  CHECK((int)profile.states.size() == model->stateCount());
+
+  // counting changes nothing, every emitting state is visited once
+  // per position, and timed in one column of every SAMPLE_COLUMNS.
+  const uint64_t every = GHMM::Profile::SAMPLE_COLUMNS;
+  for (int j = 1; j < model->stateCount() - 1; j++) {
+    const GHMM::StateProfile &sp(profile.states[j]);
+    CHECK(plain.delta(j, 0) == counted.delta(j, 0));
+    CHECK(sp.cells == codes.size());
+    CHECK(sp.timed >= sp.cells / every && sp.timed <= (sp.cells + every - 1) / every);
+    CHECK(sp.zero_durations <= sp.durations && sp.zero_cells <= sp.cells);
+    CHECK(sp.predecessors == (sp.durations - sp.zero_durations) * model->predStates(j).size());
+  }
+
+  twice.merge(profile);
+  twice.merge(profile);
+  CHECK(twice.sequences == 2 && twice.residues == 2 * codes.size());
+  CHECK(twice.states[2].durations == 2 * profile.states[2].durations);
+  CHECK(twice.states[2].timed == 2 * profile.states[2].timed);
+
+  counted.setProfile(NULL);
+  counted.parse(model, codes.begin(), codes.end());
+  CHECK(profile.sequences == 1);
+}
+
+static std::string readFile(const std::string &path) {
+  std::string text;
+  FILE *fp = fopen(path.c_str(), "r");
+  if (fp == NULL) return text;
+  char buf[4096];
+  size_t n;
+  while ((n = fread(buf, 1, sizeof(buf), fp)) > 0) text.append(buf, n);
+  fclose(fp);
+  return text;
+}
+
+static void testRunStats() {
+  SlowSequences slow(3), other(3);
+  for (int i = 0; i < 10; i++) {
+    int k = (i * 7) % 10;
+    std::string name(1, 'a' + k);
+    slow.add(k * 0.1, name.data(), name.size(), k * 100);
+  }
+  CHECK(!slow.wants(0.05) && slow.wants(0.75));
+  std::vector<SlowSequences::Entry> top = slow.sorted();
+  CHECK(top.size() == 3);
+  if (top.size() == 3) {
+    CHECK(top[0].name == "j" && top[1].name == "i" && top[2].name == "h");
+    CHECK(near(top[0].seconds, 0.9) && top[0].residues == 900);
+  }
+  other.add(2.0, "a\"b\tc", 5, 7);
+  slow.merge(other);
+  top = slow.sorted();
+  CHECK(top.size() == 3 && top[0].seconds == 2.0 && top[1].name == "j");
+
+  // a clock not enabled charges nothing.
+  PhaseClock idle, clock;
+  idle.enter(PhaseClock::READ);
+  idle.enter(PhaseClock::PARSE);
+  CHECK(idle.wall(PhaseClock::READ) == 0.0);
+
+  clock.enable();
+  CHECK(clock.enter(PhaseClock::READ) == PhaseClock::IDLE);
+  double start = PhaseClock::now();
+  while (PhaseClock::now() - start < 0.002) {
+  }
+  CHECK(clock.enter(PhaseClock::PARSE) == PhaseClock::READ);
+  clock.enter(PhaseClock::IDLE);
+  CHECK(clock.wall(PhaseClock::READ) >= 0.002 && clock.cpu(PhaseClock::READ) > 0.0);
+  CHECK(clock.wall(PhaseClock::PARSE) < clock.wall(PhaseClock::READ));
+  idle.merge(clock);
+  idle.merge(clock);
+  CHECK(near(idle.wall(PhaseClock::READ), 2 * clock.wall(PhaseClock::READ)));
+
+  // allocations are only counted once enabled.
+  AllocationCounts before = AllocationCounts::thisThread();
+  delete new std::vector<char>(1000);
+  CHECK(AllocationCounts::thisThread().count == before.count);
+  AllocationCounts::enable();
+  if (AllocationCounts::available()) {
+    before = AllocationCounts::thisThread();
+    std::vector<char> *v = new std::vector<char>(1000);
+    AllocationCounts after = AllocationCounts::thisThread();
+    delete v;
+    CHECK(after.count >= before.count + 2 && after.bytes >= before.bytes + 1000);
+  }
+
+  RunSummary summary;
+  summary.threads = 2;
+  summary.sequences = 7;
+  summary.residues = 700;
+  summary.wall_seconds = 1.5;
+  summary.slowest = slow;
+  std::string path = tmpPath("summary.json");
+  CHECK(summary.write(path));
+  std::string json = readFile(path);
+  CHECK(json.find("\"threads\": 2,") != std::string::npos);
+  CHECK(json.find("\"sequences\": 7,") != std::string::npos);
+  CHECK(json.find("\"residues_per_sec\": 466.7,") != std::string::npos);
+  // names are escaped.
+  CHECK(json.find("\"name\": \"a\\\"b\\u0009c\"") != std::string::npos);
+  CHECK(json.size() > 1 && json[0] == '{' && json.substr(json.size() - 2) == "}\n");
+}
+
+// counts reads: the first event goes up by one, the second by three.
+struct TickCounter : public GHMM::EventCounter {
+  uint64_t ticks;
+
+  TickCounter() : ticks(0) {
+  }
+  int count() const {
+    return 2;
+  }
+  void read(uint64_t *values) {
+    ticks++;
+    values[0] = ticks;
+    values[1] = 3 * ticks;
+  }
+};
+
+static void testEventCounter() {
+  GHMM::Model::Ptr model = fanModel(false);
+  std::vector<int> codes(40);
+  for (size_t i = 0; i < codes.size(); i++) codes[i] = (i * 5 + i / 7) % 4;
+
+  TickCounter ticks;
+  GHMM::Profile profile;
+  profile.counter = &ticks;
+  GHMM::Parse parse;
+  parse.setProfile(&profile);
+  parse.parse(model, codes.begin(), codes.end());
+
+  // each state's kernel is read around once per sampled cell, and the
+  // parse around all of them.
+  uint64_t cells = 0, counted = 0;
+  for (int j = 1; j < model->stateCount() - 1; j++) {
+    const GHMM::StateProfile &sp(profile.states[j]);
+    CHECK(sp.counted == sp.timed && sp.timed > 0 && sp.timed < sp.cells);
+    CHECK(sp.events[0] == sp.counted && sp.events[1] == 3 * sp.counted);
+    cells += sp.cells;
+    counted += sp.counted;
+  }
+  CHECK(profile.parses.counted == 1);
+  CHECK(profile.parses.events[0] == 2 * counted + 1 && profile.parses.events[1] == 3 * profile.parses.events[0]);
+  CHECK(profile.parses.cells == cells);
+
+  // with a column team only the parse as a whole is counted.
+  GHMM::Profile shared;
+  shared.counter = &ticks;
+  ThreadedColumnTeam team(2);
+  CHECK(team.start());
+  parse.setProfile(&shared);
+  parse.parse(model, codes.begin(), codes.end(), &team);
+  CHECK(shared.parses.counted == 1);
+  for (int j = 1; j < model->stateCount() - 1; j++) CHECK(shared.states[j].counted == 0);
+
+  // without hardware counters open() says why, and reads give zeros.
+  PerfCounters perf;
+  uint64_t values[GHMM::EventCounter::MAX_EVENTS];
+  if (perf.open()) {
+    CHECK(perf.count() > 0 && perf.index(perf.event(0)) == 0);
+    perf.read(values);
+  } else {
+    CHECK(perf.count() == 0 && !perf.error().empty());
+  }
+}
+
+static void testDPDF() {
+  static const double f[] = { 1.0, 3.0, 0.0, 4.0 };
+  MATH::DPDF d, raw, logs;
+  CHECK(d.setDistrib(2, 6, f));
+  CHECK(d.distribMin() == 2 && d.distribMax() == 6);
+  for (int l = 2; l < 6; l++) {
+    CHECK(near(d.p(l), f[l - 2] / 8.0));
+    CHECK(near(d.logp(l), MATH::logClip(f[l - 2] / 8.0)));
+  }
+  CHECK(d.p(1) == 0.0 && d.logp(6) == MATH::LOG_ZERO);
+
+  CHECK(raw.setDistrib(0, 4, f, false));
+  CHECK(raw.p(1) == 3.0 && near(raw.logp(3), log(4.0)));
+
+  const double lf[] = { log(0.5), log(0.25), log(0.25) };
+  CHECK(logs.setLogDistrib(1, 4, lf));
+  CHECK(near(logs.p(1), 0.5) && near(logs.p(3), 0.25) && logs.logp(2) == lf[1]);
+  CHECK(!logs.setLogDistrib(4, 4, lf));
+}
+
+static void testDPDFPadding() {
+  static const double f[] = { 1.0, 2.0, 3.0, 4.0 };
+  MATH::DPDF d;
+  d.setDistrib(2, 6, f);
+  d.pad(0, 10);
+  CHECK(d.padMin() == 0 && d.padMax() == 10);
+  CHECK(d.distribMin() == 2 && d.distribMax() == 6);
+  for (int l = 0; l < 10; l++) {
+    CHECK(d.pPadded(l) == d.p(l));
+    CHECK(d.logpPadded(l) == d.logp(l));
+  }
+  CHECK(near(d.p(5), 0.4));
+
+  // padding survives setp() and copying.
+  d.setp(3, 0.0);
+  MATH::DPDF e(d);
+  CHECK(e.padMin() == 0 && e.padMax() == 10);
+  for (int l = 0; l < 10; l++) CHECK(e.logpPadded(l) == d.logp(l));
+
+  // static tables are copied by pad(), and left alone.
+  static const double sp[] = { 0.25, 0.75 };
+  const double slp[] = { log(0.25), log(0.75) };
+  MATH::DPDF s;
+  s.setStaticDistrib(1, 3, sp, slp);
+  s.pad(0, 5);
+  for (int l = 0; l < 5; l++) CHECK(s.logpPadded(l) == s.logp(l));
+  s.setp(1, 0.5);
+  CHECK(sp[0] == 0.25 && s.p(1) == 0.5);
+}
+
+static void testTruncate() {
+  static const double f[] = { 0.5, 0.3, 0.1, 0.06, 0.03, 0.01 };
+  MATH::DPDF::Ptr d = new MATH::DPDF();
+  d->setDistrib(3, 9, f);
+  GHMM::LENGTH::Discrete length(d);
+
+  CHECK(length.truncate(0.0) == 0.0);
+  CHECK(length.maxLength() == 9);
+
+  // drops 0.01 and 0.03, but not 0.06 as well.
+  double dropped = length.truncate(0.05);
+  CHECK(near(dropped, 0.04));
+  CHECK(length.minLength() == 3 && length.maxLength() == 7);
+  for (int l = 3; l < 7; l++) CHECK(near(length.pLength(l), f[l - 3] / 0.96));
+
+  // at least one length is kept.
+  length.truncate(1.0);
+  CHECK(length.minLength() == 3 && length.maxLength() == 4);
+  CHECK(near(length.pLength(3), 1.0));
+}
+
+// a model with a single state x of the given lengths, emitting only
+// A, as a model file.
+static ModelFile lengthModel(int length_min, const std::vector<double> &lengths) {
+  ModelFile mf;
+  ModelFile::State s;
+  s.name = "x";
+  s.length_kind = ModelFile::DISCRETE;
+  s.length_min = length_min;
+  s.lengths = lengths;
+  s.emit.assign(1, std::vector<double>(ModelFile::SYMBOLS, 0.0));
+  s.emit[0][0] = 1.0;
+  mf.states.push_back(s);
+
+  ModelFile::Transition t;
+  t.from = GHMM::Model::BEGIN;
+  t.to = "x";
+  t.weight = 1.0;
+  mf.transitions.push_back(t);
+  t.from = "x";
+  t.to = GHMM::Model::END;
+  mf.transitions.push_back(t);
+  return mf;
+}
+
+static void testLengthTails() {
+  static const double f[] = { 0.05, 0.1, 0.2, 0.15, 0.1, 0.1, 0.08, 0.07, 0.05, 0.04, 0.03, 0.02, 0.01 };
+  const int n = sizeof(f) / sizeof(f[0]), length_min = 2, head = 4;
+  std::vector<double> lengths(f, f + n);
+
+  ModelFile exact = lengthModel(length_min, lengths), split = exact;
+  std::vector<ModelFile::LengthChange> changes = split.splitLengthTails(head);
+  CHECK(changes.size() == 1);
+  CHECK(split.states.size() == 3);
+  if (changes.size() != 1 || split.states.size() != 3) return;
+  CHECK(split.states[0].lengths.size() == (size_t)head);
+  CHECK(split.states[1].name == "x~long" && split.states[2].name == "x~tail");
+  CHECK(changes[0].durations_before == n && changes[0].durations_after == head + 2);
+
+  // the tail is geometric past the head, with the tail's mass and
+  // mean.
+  int h = length_min + head - 1;
+  double tail = 0.0, mean = 0.0;
+  for (int k = head; k < n; k++) {
+    tail += f[k];
+    mean += f[k] * (length_min + k - h);
+  }
+  mean /= tail;
+  double p_self = 1.0 - 1.0 / mean;
+
+  std::string err;
+  GHMM::Model::Ptr exact_model = exact.make(err), split_model = split.make(err);
+  GHMM::Parse parse;
+  double tv = 0.0, split_mean = 0.0;
+  for (int l = 1; l < 200; l++) {
+    std::vector<int> codes(l, 0);
+    double p = l >= length_min && l < length_min + n ? f[l - length_min] : 0.0;
+    double q = l < length_min ? 0.0 : l <= h ? f[l - length_min] : tail * (1.0 - p_self) * pow(p_self, l - h - 1);
+
+    CHECK(near(exp(forward(parse, exact_model, codes)), p, 1e-9));
+    CHECK(near(exp(forward(parse, split_model, codes)), q, 1e-9));
+    tv += fabs(p - q);
+    if (l > h) split_mean += q * (l - h);
+  }
+  CHECK(near(split_mean / tail, mean, 1e-6));
+  CHECK(near(changes[0].error, tv / 2.0, 1e-6));
+
+  // truncation is reported the same way.
+  ModelFile trimmed = exact;
+  changes = trimmed.truncateLengths(0.03);
+  CHECK(changes.size() == 1 && near(changes[0].error, 0.03));
+  CHECK(trimmed.states[0].lengths.size() == (size_t)n - 2);
+}
+
+struct ViterbiResult {
+  double score;
+  std::vector<std::pair<std::string, int> > path;
+};
+
+static ViterbiResult viterbi(GHMM::Parse &parse, const GHMM::Model::Ptr &model, const std::vector<int> &codes) {
+  const GHMM::Model &m(*model);
+  int end = m.stateCount() - 1;
+  const std::vector<int> &last(m.predStates(end));
+  ViterbiResult r;
+  int best = -1;
+
+  r.score = MATH::LOG_ZERO;
+  parse.parse(model, codes.begin(), codes.end());
+  for (int i = last.size() - 1; i >= 0; --i) {
+    double d = parse.delta(last[i], 0) + m.logp(last[i], end);
+    if (last[i] != 0 && d >= r.score) {
+      r.score = d;
+      best = last[i];
+    }
+  }
+  if (best < 0) return r;
+  for (const GHMM::Traceback *tb = parse.psi(best, 0).ptr(); tb != NULL; tb = tb->prev.ptr()) {
+    r.path.insert(r.path.begin(), std::make_pair(m.stateName(tb->state), (int)tb->length));
+  }
+  return r;
+}
+
+// log probability of codes by the backward algorithm.
+static double backward(GHMM::Parse &parse, const GHMM::Model::Ptr &model, const std::vector<int> &codes) {
+  const GHMM::Model &m(*model);
+  const std::vector<int> &first(m.succStates(0));
+  double z = MATH::LOG_ZERO;
+
+  parse.parse(model, codes.begin(), codes.end());
+  parse.backward(model, codes.begin(), codes.end());
+  for (size_t i = 0; i < first.size(); i++) {
+    double b = parse.beta(first[i], 0);
+    if (b != MATH::LOG_ZERO) z = MATH::logAdd(m.logp(0, first[i]) + b, z);
+  }
+  return z;
+}
+
+static void testSilentStates() {
+  GHMM::Model::Ptr explicit_model = fanModel(false), silent_model = fanModel(true);
+  const GHMM::Model &sm(*silent_model);
+
+  CHECK(explicit_model->firstSilent() == explicit_model->stateCount() - 1);
+  CHECK(sm.firstSilent() == 6 && sm.stateCount() == 10);
+  CHECK(sm.stateNumber("hub0") < sm.stateNumber("hub"));
+  for (int j = 1; j < sm.stateCount() - 1; j++) CHECK(sm.state(j)->silent() == (j >= sm.firstSilent()));
+
+  MATH::Random rng(5);
+  GHMM::Parse parse;
+  for (int n = 0; n < 50; n++) {
+    std::vector<int> codes = explicit_model->generate(rng);
+    if (codes.empty()) continue;
+
+    double z = forward(parse, explicit_model, codes);
+    CHECK(z != MATH::LOG_ZERO);
+    CHECK(near(forward(parse, silent_model, codes), z));
+    CHECK(near(backward(parse, explicit_model, codes), z));
+    CHECK(near(backward(parse, silent_model, codes), z));
+
+    ViterbiResult a = viterbi(parse, explicit_model, codes), b = viterbi(parse, silent_model, codes);
+    CHECK(near(a.score, b.score));
+    CHECK(a.path == b.path);
+  }
+
+  // a loop of silent states makes no model, and says which states.
+  ModelFile loop = lengthModel(1, std::vector<double>(1, 1.0));
+  ModelFile::State q;
+  q.length_kind = ModelFile::SILENT;
+  q.name = "q0";
+  loop.states.push_back(q);
+  q.name = "q1";
+  loop.states.push_back(q);
+  static const char *edges[][2] = { { "x", "q0" }, { "q0", "q1" }, { "q1", "q0" }, { "q1", GHMM::Model::END.c_str() } };
+  for (size_t i = 0; i < sizeof(edges) / sizeof(edges[0]); i++) {
+    ModelFile::Transition t;
+    t.from = edges[i][0];
+    t.to = edges[i][1];
+    t.weight = 1.0;
+    loop.transitions.push_back(t);
+  }
+  std::string err;
+  CHECK(loop.make(err) == NULL);
+  CHECK(err == "model has a loop among the silent states: q0 q1");
+  loop.transitions[4].weight = 0.0;
+  err.clear();
+  CHECK(loop.make(err) != NULL && err.empty());
+}
+
+static std::vector<int> encode(const GHMM::UTIL::Alphabet &alphabet, const char *text) {
+  std::vector<unsigned char> codes(strlen(text) + 1);
+  codes.resize(alphabet.encode(text, strlen(text), &codes[0]));
+  return std::vector<int>(codes.begin(), codes.end());
+}
+
+static std::vector<int> ints(int n, const int *p) {
+  return std::vector<int>(p, p + n);
+}
+
+static void testAlphabet() {
+  const GHMM::UTIL::Alphabet &residues(FastaReader::residueAlphabet());
+  static const int r[] = { 0, 2, 3, 4, 23, 25 };
+  CHECK(residues.singleChar());
+  CHECK(encode(residues, "acD\n e*\tz\r\n") == ints(6, r));
+  CHECK(*ModelFile::alphabet() == residues);
+
+  // the same codes as the table the residue alphabet replaced.
+  bool same = true;
+  for (int c = 0; c < 256; c++) {
+    unsigned char expect = isspace(c) ? FastaReader::SKIP : isalpha(c) ? toupper(c) - 'A' : 'X' - 'A';
+    same = same && residues.codes()[c] == expect && FastaReader::residueCodes()[c] == expect;
+  }
+  CHECK(same);
+
+  // an exact token wins over the other case of another.
+  GHMM::UTIL::Alphabet cased;
+  cased.addToken("a");
+  cased.addToken("A");
+  cased.addToken("b");
+  static const int c[] = { 1, 0, 2, 2 };
+  CHECK(encode(cased, "Aab B") == ints(4, c));
+  CHECK(cased != residues);
+
+  // bytes in no token are skipped, or given the unknown code.
+  GHMM::UTIL::Alphabet flips;
+  flips.addToken("h");
+  flips.addToken("t");
+  static const int s[] = { 0, 1, 1, 0 };
+  CHECK(encode(flips, "h t x?T\nH") == ints(4, s));
+  flips.addToken("?");
+  flips.setUnknown(2);
+  static const int u[] = { 0, 1, 2, 2, 1, 0 };
+  CHECK(encode(flips, "h t x?T\nH") == ints(6, u));
+
+  // copies keep the table.
+  GHMM::UTIL::Alphabet copy(flips);
+  CHECK(encode(copy, "h t x?T\nH") == ints(6, u));
+  CHECK(copy == flips);
+
+  // longer tokens take the slow path, longest match first.
+  GHMM::UTIL::Alphabet::Ptr coin = new GHMM::UTIL::Alphabet();
+  coin->addToken("heads");
+  coin->addToken("tails");
+  coin->addToken("h");
+  CHECK(!coin->singleChar());
+  static const int h[] = { 0, 1, 1, 0, 2, 0, 2 };
+  CHECK(encode(*coin, "heads tails\ntailsheads hheads H") == ints(7, h));
+  static const int x[] = { 0, 3, 3, 1, 2, 3, 3 };
+  coin->addToken("?");
+  coin->setUnknown(3);
+  CHECK(encode(*coin, "heads xy tails hea") == ints(7, x));
+
+  // a reader encodes with the alphabet it is given.
+  std::string fa = tmpPath("coin.fa");
+  CHECK(writeFile(fa, ">flips\nheads tails\nheadsh\n"));
+  FastaReader reader;
+  FastaRecord rec;
+  reader.setAlphabet(*coin);
+  CHECK(reader.open(fa.c_str()) && reader.next(rec));
+  std::vector<unsigned char> codes(rec.seq_len);
+  codes.resize(reader.encode(rec.seq, rec.seq_len, &codes[0]));
+  static const int f[] = { 0, 1, 0, 2 };
+  CHECK(std::vector<int>(codes.begin(), codes.end()) == ints(4, f));
+
+  // models keep the alphabet they are built with.
+  GHMM::ModelBuilder mb;
+  mb.setAlphabet(coin);
+  mb.addState("s", GHMM::UTIL::makeState(new GHMM::LENGTH::Fixed(1), emission(0.5, 0.5, 0.0, 0.0)));
+  mb.addStateTransition(GHMM::Model::BEGIN, "s", 1.0);
+  mb.addStateTransition("s", GHMM::Model::END, 1.0);
+  CHECK(mb.make()->alphabet() == coin);
+  CHECK(fanModel(false)->alphabet() == NULL);
+  ModelFile mf = lengthModel(1, std::vector<double>(1, 1.0));
+  std::string err;
+  CHECK(mf.make(err)->alphabet() != NULL && *mf.make(err)->alphabet() == residues);
+}
+
+struct Test {
+  const char *name;
+  void (*run)();
+};
+
+static const Test tests[] = {
+  { "variant-spec",  testVariantSpec },
+  { "length-tables", testLengthTables },
+  { "fasta-reader",  testFastaReader },
+  { "queues",        testQueues },
+  { "hit-writer",    testHitWriter },
+  { "output-buffer", testOutputBuffer },
+  { "compressed",    testCompressed },
+  { "fasta-index",   testFastaIndex },
+  { "seq-db",        testSeqDB },
+  { "shared-refs",   testSharedRefs },
+  { "column-team",   testColumnTeam },
+  { "alias-table",   testAliasTable },
+  { "signal-sim",    testSignalSim },
+  { "null-table",    testNullTable },
+  { "model-file",    testModelFile },
+  { "profile",       testProfile },
+  { "run-stats",     testRunStats },
+  { "event-counter", testEventCounter },
+  { "alphabet",      testAlphabet },
+  { "dpdf",          testDPDF },
+  { "dpdf-padding",  testDPDFPadding },
+  { "truncate",      testTruncate },
+  { "length-tails",  testLengthTails },
+  { "silent-states", testSilentStates },
+};
+
+int main(int argc, char **argv) {
+  char dir[] = "/tmp/exportpred-test.XXXXXX";
+  if (mkdtemp(dir) == NULL) {
+    perror("mkdtemp");
+    return 1;
+  }
+  tmp_dir = dir;
+
+  for (size_t i = 0; i < sizeof(tests) / sizeof(tests[0]); i++) {
+    if (argc > 1 && strcmp(argv[1], tests[i].name)) continue;
+    int before = failures;
+    tests[i].run();
+    fprintf(stderr, "%s %s\n", failures == before ? "ok  " : "FAIL", tests[i].name);
+  }
+
+  std::string cmd = "rm -rf '" + tmp_dir + "'";
+  if (system(cmd.c_str()) != 0) fprintf(stderr, "could not remove %s\n", tmp_dir.c_str());
+  return failures ? 1 : 0;
+}
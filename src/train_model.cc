@@ -0,0 +1,681 @@
+// Copyright (c) 2005 The Walter and Eliza Hall Institute
+// 
+// Permission is hereby granted, free of charge, to any person obtaining
+// a copy of this software and associated documentation files (the
+// "Software"), to deal in the Software without restriction, including
+// without limitation the rights to use, copy, modify, merge, publish,
+// distribute, sublicense, and/or sell copies of the Software, and to
+// permit persons to whom the Software is furnished to do so, subject
+// to the following conditions:
+// 
+// The above copyright notice and this permission notice shall be
+// included in all copies or substantial portions of the Software.
+// 
+// THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND,
+// EXPRESS OR IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF
+// MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+// IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR
+// ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF
+// CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN CONNECTION
+// WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+#include <iostream>
+#include <vector>
+#include <string>
+#include <algorithm>
+#include <getopt.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#include "predict_pexel.hh"
+#include "model_file.hh"
+#include "fasta_reader.hh"
+#include "pipeline.hh"
+
+static const struct option options[] = {
+  { "input",             required_argument,          0,            'i' },
+  { "output",            required_argument,          0,            'o' },
+  { "model",             required_argument,          0,            'm' },
+  { "algorithm",         required_argument,          0,            'a' },
+  { "iterations",        required_argument,          0,            'n' },
+  { "prior",             required_argument,          0,            'w' },
+  { "threads",           required_argument,          0,            't' },
+  { 0,                   0,                          0,            0   }
+};
+
+void usage(const char *progname) {
+  std::cout << "Usage: " << progname << " [arguments]" << std::endl;
+  std::cout << "\
+\n\
+Re-estimate the emissions, length distributions and transitions of a\n\
+model from training sequences, and write it as a model file that\n\
+exportpred --model=file=path loads.\n\
+\n\
+A FASTA record is labeled if its header ends with the states that\n\
+produced it, as exportpred writes parses: [state:residues]... with the\n\
+residues spelling out the sequence. Labeled records are counted along\n\
+their labels, unlabeled ones along the model's parse of them.\n\
+\n\
+--input=file            -i file        read training sequences from file\n\
+                                       (-:stdin); may be given more than\n\
+                                       once\n\
+--output=file           -o file        write the model to file (-:stdout)\n\
+--model=spec            -m spec        starting model, as accepted by\n\
+                                       exportpred --model (default: v2)\n\
+--algorithm=a           -a a           viterbi (count along the best parse\n\
+                                       of each unlabeled sequence) or\n\
+                                       baum-welch (expected counts over all\n\
+                                       parses) (default: viterbi)\n\
+--iterations=n          -n n           rounds of re-estimation; 0 writes\n\
+                                       the starting model (default: 1)\n\
+--prior=w               -w w           weight of the current model in each\n\
+                                       re-estimated distribution, in\n\
+                                       observations (default: 1)\n\
+--threads=n             -t n           number of threads counting\n\
+                                       sequences (default: 1)\n\
+\n\
+";
+}
+
+struct TrainingSequence {
+  std::string name;
+  std::vector<GHMM::Symbol> codes;
+  // (state, residues) runs, first to last; empty if unlabeled.
+  std::vector<std::pair<int, int> > path;
+};
+
+// What the trainer needs of a state, whatever GHMM::State<> it is.
+struct StateView {
+  const GHMM::LENGTH::Fixed *fixed;
+  const GHMM::LENGTH::Geometric *geometric;
+  const GHMM::LENGTH::Discrete *discrete;
+  const GHMM::EMISSION::Stateless *stateless;
+  const GHMM::EMISSION::PositionSpecific *pssm;
+  int min_len, max_len;
+
+  StateView() : fixed(NULL), geometric(NULL), discrete(NULL), stateless(NULL), pssm(NULL), min_len(0), max_len(0) {
+  }
+  StateView(const GHMM::StateBase *s) :
+    fixed(dynamic_cast<const GHMM::LENGTH::Fixed *>(s)),
+    geometric(dynamic_cast<const GHMM::LENGTH::Geometric *>(s)),
+    discrete(dynamic_cast<const GHMM::LENGTH::Discrete *>(s)),
+    stateless(dynamic_cast<const GHMM::EMISSION::Stateless *>(s)),
+    pssm(dynamic_cast<const GHMM::EMISSION::PositionSpecific *>(s)),
+    min_len(0), max_len(0) {
+    if (fixed) {
+      min_len = fixed->minLength();
+      max_len = fixed->maxLength();
+    } else if (geometric) {
+      min_len = geometric->minLength();
+      max_len = geometric->maxLength();
+    } else if (discrete) {
+      min_len = discrete->minLength();
+      max_len = discrete->maxLength();
+    }
+  }
+
+  double logpLength(int d) const {
+    if (fixed) return fixed->logpLength(d);
+    if (geometric) return geometric->logpLength(d);
+    return discrete->logpLength(d);
+  }
+  // column k of the segment emits x.
+  double logpEmission(int k, GHMM::Symbol x) const {
+    if (stateless) return stateless->logEmissionProb(x);
+    const std::vector<MATH::DPDF::Ptr> &cols(pssm->emissionDistrib());
+    return cols[k % cols.size()]->logp(x);
+  }
+  int rows() const {
+    return stateless ? 1 : pssm->emissionDistrib().size();
+  }
+};
+
+// Counts for one re-estimation round, indexed by model state number.
+struct Counts {
+  int states;
+  std::vector<double> trans;
+  std::vector<std::vector<double> > emit;
+  std::vector<std::vector<double> > lengths;
+  double log_likelihood;
+  int used, failed;
+
+  Counts() : states(0), trans(), emit(), lengths(), log_likelihood(0.0), used(0), failed(0) {
+  }
+
+  void reset(const std::vector<StateView> &views) {
+    states = views.size();
+    trans.assign(states * states, 0.0);
+    emit.assign(states, std::vector<double>());
+    lengths.assign(states, std::vector<double>());
+    for (int j = 1; j < states - 1; j++) {
+      emit[j].assign(views[j].rows() * ModelFile::SYMBOLS, 0.0);
+      if (views[j].discrete) lengths[j].assign(views[j].max_len - views[j].min_len, 0.0);
+    }
+    log_likelihood = 0.0;
+    used = failed = 0;
+  }
+
+  void merge(const Counts &c) {
+    for (size_t i = 0; i < trans.size(); i++) trans[i] += c.trans[i];
+    for (int j = 0; j < states; j++) {
+      for (size_t i = 0; i < emit[j].size(); i++) emit[j][i] += c.emit[j][i];
+      for (size_t i = 0; i < lengths[j].size(); i++) lengths[j][i] += c.lengths[j][i];
+    }
+    log_likelihood += c.log_likelihood;
+    used += c.used;
+    failed += c.failed;
+  }
+};
+
+// The E-step of one thread: sequences worker, worker + workers, ...
+// are counted into a private Counts, so threads never share anything
+// they write. Taking every workers'th sequence rather than the next
+// free one keeps the sums, and so the trained model, the same from one
+// run to the next with the same number of threads.
+class CountStage {
+  const GHMM::Model::Ptr &model;
+  const std::vector<StateView> &views;
+  const std::vector<TrainingSequence> &seqs;
+  bool baum_welch;
+  int worker, workers;
+  GHMM::Parse::Ptr parse;
+  std::vector<double> b_out, cover;
+
+  double pathScore(const TrainingSequence &s, const std::vector<std::pair<int, int> > &path) const;
+  void countPath(const TrainingSequence &s, const std::vector<std::pair<int, int> > &path);
+  bool viterbiPath(const TrainingSequence &s, std::vector<std::pair<int, int> > &path);
+  bool expectedCounts(const TrainingSequence &s);
+
+public:
+  Counts counts;
+
+  CountStage(const GHMM::Model::Ptr &m, const std::vector<StateView> &v, const std::vector<TrainingSequence> &s, bool bw, int w, int ws) :
+    model(m), views(v), seqs(s), baum_welch(bw), worker(w), workers(ws), parse(new GHMM::Parse()), b_out(), cover(), counts() {
+  }
+
+  void run() {
+    std::vector<std::pair<int, int> > path;
+    counts.reset(views);
+    for (size_t i = worker; i < seqs.size(); i += workers) {
+      const TrainingSequence &s(seqs[i]);
+      if (s.path.size()) {
+        double score = pathScore(s, s.path);
+        if (score == MATH::LOG_ZERO) {
+          counts.failed++;
+          continue;
+        }
+        countPath(s, s.path);
+        counts.log_likelihood += score;
+        counts.used++;
+      } else if (baum_welch) {
+        expectedCounts(s);
+      } else if (viterbiPath(s, path)) {
+        counts.log_likelihood += pathScore(s, path);
+        countPath(s, path);
+        counts.used++;
+      } else {
+        counts.failed++;
+      }
+    }
+  }
+};
+
+// a run of one state may hold several of its segments: a geometric
+// state emits one residue per segment, and runs of a fixed length
+// state are split into segments of that length. anything else is one
+// segment.
+static int runSegments(const StateView &v, int length) {
+  if (v.geometric) return length;
+  if (v.fixed) return length % v.min_len ? 0 : length / v.min_len;
+  return 1;
+}
+
+// log probability of the model producing s along path, or LOG_ZERO.
+double CountStage::pathScore(const TrainingSequence &s, const std::vector<std::pair<int, int> > &path) const {
+  const GHMM::Model &m(*model);
+  int end = m.stateCount() - 1;
+  double score = 0.0;
+  int prev = 0, pos = 0;
+
+  for (size_t r = 0; r < path.size() && score != MATH::LOG_ZERO; r++) {
+    int j = path[r].first, length = path[r].second;
+    const StateView &v(views[j]);
+    int n = runSegments(v, length);
+    if (n == 0 || pos + length > (int)s.codes.size()) return MATH::LOG_ZERO;
+
+    score += m.logp(prev, j);
+    if (n > 1) score += (n - 1) * m.logp(j, j);
+    score += n * v.logpLength(length / n);
+    for (int k = 0; k < length; k++) score += v.logpEmission(k, s.codes[pos + k]);
+    prev = j;
+    pos += length;
+  }
+  if (pos != (int)s.codes.size()) return MATH::LOG_ZERO;
+  score += m.logp(prev, end);
+  return score == score ? score : MATH::LOG_ZERO;
+}
+
+void CountStage::countPath(const TrainingSequence &s, const std::vector<std::pair<int, int> > &path) {
+  int n_states = counts.states;
+  int prev = 0, pos = 0;
+
+  for (size_t r = 0; r < path.size(); r++) {
+    int j = path[r].first, length = path[r].second;
+    const StateView &v(views[j]);
+    int n = runSegments(v, length);
+
+    counts.trans[prev * n_states + j] += 1.0;
+    counts.trans[j * n_states + j] += n - 1;
+    if (v.discrete) counts.lengths[j][length - v.min_len] += 1.0;
+    for (int k = 0; k < length; k++) {
+      int row = v.stateless ? 0 : k % v.rows();
+      counts.emit[j][row * ModelFile::SYMBOLS + s.codes[pos + k]] += 1.0;
+    }
+    prev = j;
+    pos += length;
+  }
+  counts.trans[prev * n_states + n_states - 1] += 1.0;
+}
+
+bool CountStage::viterbiPath(const TrainingSequence &s, std::vector<std::pair<int, int> > &path) {
+  const GHMM::Model &m(*model);
+  int end = m.stateCount() - 1;
+
+  parse->parse(model, s.codes.begin(), s.codes.end());
+
+  const std::vector<int> &last(m.predStates(end));
+  double best = MATH::LOG_ZERO;
+  int best_state = -1;
+  for (size_t i = 0; i < last.size(); i++) {
+    double d = parse->delta(last[i], 0) + m.logp(last[i], end);
+    if (last[i] != 0 && d > best) {
+      best = d;
+      best_state = last[i];
+    }
+  }
+  if (best_state < 0) return false;
+
+  path.clear();
+  for (const GHMM::Traceback *tb = parse->psi(best_state, 0).ptr(); tb != NULL; tb = tb->prev.ptr()) {
+    path.push_back(std::make_pair((int)tb->state, (int)tb->length));
+  }
+  std::reverse(path.begin(), path.end());
+  return true;
+}
+
+// forward-backward: every segment (state j over residues [o, o + d))
+// is counted with its posterior probability.
+bool CountStage::expectedCounts(const TrainingSequence &s) {
+  const GHMM::Model &m(*model);
+  int n_states = m.stateCount(), end = n_states - 1;
+  int len = s.codes.size();
+  const GHMM::Symbol *x = &s.codes[0];
+
+  parse->parse(model, s.codes.begin(), s.codes.end());
+  parse->backward(model, s.codes.begin(), s.codes.end());
+  const GHMM::Parse &p(*parse);
+
+  double z = MATH::LOG_ZERO;
+  const std::vector<int> &last(m.predStates(end));
+  for (size_t i = 0; i < last.size(); i++) {
+    double a = p.alpha(last[i], len) + m.logp(last[i], end);
+    if (last[i] != 0 && a != MATH::LOG_ZERO) z = MATH::logAdd(a, z);
+  }
+  if (z == MATH::LOG_ZERO) {
+    counts.failed++;
+    return false;
+  }
+  counts.log_likelihood += z;
+  counts.used++;
+
+  for (int i = 0; i < end; i++) {
+    const std::vector<int> &succ(m.succStates(i));
+    for (size_t k = 0; k < succ.size(); k++) {
+      int j = succ[k];
+      double t = m.logp(i, j) - z;
+      double &c(counts.trans[i * n_states + j]);
+      if (j == end) {
+        if (i != 0 && p.alpha(i, len) != MATH::LOG_ZERO) c += exp(p.alpha(i, len) + t);
+        continue;
+      }
+      for (int o = 0; o < len; o++) {
+        double a = p.alpha(i, o), b = p.beta(j, o);
+        if (a != MATH::LOG_ZERO && b != MATH::LOG_ZERO) c += exp(a + t + b);
+      }
+    }
+  }
+
+  b_out.resize(len + 1);
+  cover.resize(len + 1);
+  for (int j = 1; j < end; j++) {
+    const StateView &v(views[j]);
+    const std::vector<int> &pred(m.predStates(j));
+    const std::vector<int> &succ(m.succStates(j));
+    std::vector<double> &emit(counts.emit[j]);
+
+    // log probability of the rest of the sequence after a segment of
+    // j ends at e.
+    for (int e = 1; e <= len; e++) {
+      double b = MATH::LOG_ZERO;
+      for (size_t k = 0; k < succ.size(); k++) {
+        double bk = p.beta(succ[k], e);
+        if (bk != MATH::LOG_ZERO) b = MATH::logAdd(m.logp(j, succ[k]) + bk, b);
+      }
+      b_out[e] = b;
+    }
+    std::fill(cover.begin(), cover.end(), 0.0);
+
+    for (int o = 0; o < len; o++) {
+      double a_in = MATH::LOG_ZERO;
+      for (size_t k = 0; k < pred.size(); k++) {
+        double ak = p.alpha(pred[k], o);
+        if (ak != MATH::LOG_ZERO) a_in = MATH::logAdd(m.logp(pred[k], j) + ak, a_in);
+      }
+      if (a_in == MATH::LOG_ZERO) continue;
+
+      int d_max = std::min(v.max_len - 1, len - o);
+      double e_sum = 0.0;
+      for (int d = 1; d <= d_max; d++) {
+        if (v.stateless) {
+          e_sum += v.logpEmission(0, x[o + d - 1]);
+          if (e_sum == MATH::LOG_ZERO) break;
+        } else {
+          if (d < v.min_len) continue;
+          for (int k = 0; k < d; k++) e_sum += v.logpEmission(k, x[o + k]);
+        }
+        if (d < v.min_len || b_out[o + d] == MATH::LOG_ZERO) continue;
+        double l = v.logpLength(d);
+        if (l == MATH::LOG_ZERO) continue;
+        double w = exp(a_in + l + e_sum + b_out[o + d] - z);
+        if (!(w > 0.0)) continue;
+
+        if (v.discrete) counts.lengths[j][d - v.min_len] += w;
+        if (v.stateless) {
+          // residues are counted once every segment is in, below.
+          cover[o] += w;
+          cover[o + d] -= w;
+        } else {
+          for (int k = 0; k < d; k++) emit[k * ModelFile::SYMBOLS + x[o + k]] += w;
+        }
+      }
+    }
+
+    if (v.stateless) {
+      double occupancy = 0.0;
+      for (int t = 0; t < len; t++) {
+        occupancy += cover[t];
+        if (occupancy > 0.0) emit[x[t]] += occupancy;
+      }
+    }
+  }
+  return true;
+}
+
+// mix counts with the current distribution p, weighted as prior
+// observations, and normalize. returns false (leaving p alone) if
+// there is nothing to go on.
+static bool reestimate(std::vector<double> &p, const double *counts, double prior) {
+  double p_sum = 0.0, sum = 0.0;
+  for (size_t i = 0; i < p.size(); i++) p_sum += p[i];
+  if (p_sum <= 0.0) return false;
+
+  std::vector<double> q(p.size());
+  for (size_t i = 0; i < p.size(); i++) {
+    q[i] = counts[i] + prior * p[i] / p_sum;
+    sum += q[i];
+  }
+  if (!(sum > 0.0)) return false;
+  for (size_t i = 0; i < p.size(); i++) p[i] = q[i] / sum;
+  return true;
+}
+
+static int stateIndex(const GHMM::Model &model, const std::string &name) {
+  if (name == GHMM::Model::BEGIN) return 0;
+  if (name == GHMM::Model::END) return model.stateCount() - 1;
+  return model.stateNumber(name);
+}
+
+static void maximize(ModelFile &mf, const GHMM::Model &model, const Counts &c, double prior) {
+  int n_states = model.stateCount();
+
+  for (int j = 1; j < n_states - 1; j++) {
+    ModelFile::State &s(mf.states[j - 1]);
+    for (size_t r = 0; r < s.emit.size(); r++) {
+      reestimate(s.emit[r], &c.emit[j][r * ModelFile::SYMBOLS], prior);
+    }
+    if (s.length_kind == ModelFile::DISCRETE) {
+      reestimate(s.lengths, &c.lengths[j][0], prior);
+    }
+    if (s.length_kind == ModelFile::GEOMETRIC) {
+      double stay = c.trans[j * n_states + j], leave = 0.0;
+      for (int t = 0; t < n_states; t++) {
+        if (t != j) leave += c.trans[j * n_states + t];
+      }
+      double p = (stay + prior * s.p_self) / (stay + leave + prior);
+      if (p > 0.0 && p < 1.0) s.p_self = p;
+    }
+  }
+
+  // the transitions out of each state, apart from geometric self
+  // transitions, are re-estimated together.
+  std::vector<std::vector<int> > from(n_states);
+  for (size_t i = 0; i < mf.transitions.size(); i++) {
+    from[stateIndex(model, mf.transitions[i].from)].push_back(i);
+  }
+  for (int s = 0; s < n_states - 1; s++) {
+    std::vector<double> p, counts;
+    for (size_t k = 0; k < from[s].size(); k++) {
+      const ModelFile::Transition &t(mf.transitions[from[s][k]]);
+      p.push_back(t.weight);
+      counts.push_back(c.trans[s * n_states + stateIndex(model, t.to)]);
+    }
+    if (!p.size() || !reestimate(p, &counts[0], prior)) continue;
+    for (size_t k = 0; k < from[s].size(); k++) {
+      mf.transitions[from[s][k]].weight = p[k];
+    }
+  }
+}
+
+// a label is the last word of the header if it is a run of
+// [state:residues] segments.
+static bool parseLabel(const std::string &header, const GHMM::Model &model, const unsigned char *lut, const std::vector<GHMM::Symbol> &codes, std::vector<std::pair<int, int> > &path, std::string &err) {
+  size_t start = header.find_last_of(" \t");
+  start = start == std::string::npos ? 0 : start + 1;
+  if (start >= header.size() || header[start] != '[') return true;
+
+  size_t pos = 0;
+  size_t i = start;
+  while (i < header.size()) {
+    size_t colon = header.find(':', i), close = header.find(']', i);
+    if (header[i] != '[' || colon == std::string::npos || close == std::string::npos || colon > close) {
+      err = "bad label";
+      return false;
+    }
+    std::string name = header.substr(i + 1, colon - i - 1);
+    int state = model.stateNumber(name);
+    if (state < 0) {
+      err = "unknown state " + name + " in label";
+      return false;
+    }
+    int length = close - colon - 1;
+    for (int k = 0; k < length; k++) {
+      if (pos + k >= codes.size() || lut[(unsigned char)header[colon + 1 + k]] != codes[pos + k]) {
+        err = "label does not match the sequence";
+        return false;
+      }
+    }
+    if (length) {
+      if (path.size() && path.back().first == state) {
+        path.back().second += length;
+      } else {
+        path.push_back(std::make_pair(state, length));
+      }
+    }
+    pos += length;
+    i = close + 1;
+  }
+  if (pos != codes.size()) {
+    err = "label does not match the sequence";
+    return false;
+  }
+  return true;
+}
+
+static void readSequences(const std::string &path, const GHMM::Model &model, std::vector<TrainingSequence> &seqs) {
+  FastaReader reader;
+  FastaRecord rec;
+
+  if (model.alphabet() != NULL) reader.setAlphabet(*model.alphabet());
+  if (!reader.open(path.c_str())) {
+    std::cerr << "could not open " << path << ": " << reader.error() << std::endl;
+    exit(1);
+  }
+  while (reader.next(rec)) {
+    TrainingSequence s;
+    std::string header = rec.nameString();
+    while (header.size() && isspace(header[header.size() - 1])) header.erase(header.size() - 1);
+    s.name = header.substr(0, header.find_first_of(" \t"));
+    s.codes.resize(rec.seq_len);
+    s.codes.resize(reader.encode(rec.seq, rec.seq_len, &s.codes[0]));
+
+    std::string err;
+    if (!parseLabel(header, model, reader.alphabet().codes(), s.codes, s.path, err)) {
+      std::cerr << path << ": " << s.name << ": " << err << std::endl;
+      exit(1);
+    }
+    seqs.push_back(s);
+  }
+  if (reader.failed()) {
+    std::cerr << "error reading " << path << ": " << reader.error() << std::endl;
+    exit(1);
+  }
+}
+
+int main(int argc, char **argv) {
+  PEXELModelOptions opts;
+  std::vector<std::string> inputs;
+  std::string output = "-";
+  bool baum_welch = false;
+  int iterations = 1;
+  double prior = 1.0;
+  int n_threads = 1;
+
+  int ch;
+
+  while ((ch = getopt_long(argc, argv, "i:o:m:a:n:w:t:h", options, NULL)) != -1) {
+    switch (ch) {
+    case 'i': {
+      inputs.push_back(optarg);
+      break;
+    }
+    case 'o': {
+      output = optarg;
+      break;
+    }
+    case 'm': {
+      if (!opts.parse(optarg)) {
+        std::cerr << "bad model spec: " << optarg << std::endl;
+        exit(1);
+      }
+      break;
+    }
+    case 'a': {
+      std::string a = optarg;
+      if (a == "viterbi") {
+        baum_welch = false;
+      } else if (a == "baum-welch") {
+        baum_welch = true;
+      } else {
+        std::cerr << "bad algorithm: " << optarg << std::endl;
+        exit(1);
+      }
+      break;
+    }
+    case 'n': {
+      iterations = std::max(0, atoi(optarg));
+      break;
+    }
+    case 'w': {
+      prior = std::max(0.0, atof(optarg));
+      break;
+    }
+    case 't': {
+      n_threads = std::max(1, atoi(optarg));
+      break;
+    }
+    case 'h':
+    case '?': {
+      usage(argv[0]);
+      exit(0);
+    }
+    }
+  }
+
+  if (iterations && !inputs.size()) {
+    usage(argv[0]);
+    exit(1);
+  }
+
+  GHMM::Model::Ptr model = makePEXELmodel(opts);
+  ModelFile mf;
+  std::string err;
+  if (!mf.describe(*model, err)) {
+    std::cerr << err << std::endl;
+    exit(1);
+  }
+  // segments are counted against the transitions between emitting
+  // states, which a path through a silent state does not take.
+  if (iterations && model->firstSilent() < model->stateCount() - 1) {
+    std::cerr << "models with silent states can not be re-estimated" << std::endl;
+    exit(1);
+  }
+
+  std::vector<TrainingSequence> seqs;
+  if (iterations) {
+    for (size_t i = 0; i < inputs.size(); i++) readSequences(inputs[i], *model, seqs);
+  }
+
+  for (int it = 1; it <= iterations; it++) {
+    std::vector<StateView> views(model->stateCount());
+    for (int j = 1; j < model->stateCount() - 1; j++) views[j] = StateView(model->state(j).ptr());
+
+    model->freeze();
+    std::vector<CountStage *> stages;
+    std::vector<Thread<CountStage> *> threads;
+    for (int t = 0; t < n_threads; t++) {
+      stages.push_back(new CountStage(model, views, seqs, baum_welch, t, n_threads));
+      threads.push_back(new Thread<CountStage>);
+      if (!threads.back()->start(stages.back())) {
+        std::cerr << "could not start counting thread" << std::endl;
+        exit(1);
+      }
+    }
+
+    Counts total;
+    total.reset(views);
+    for (int t = 0; t < n_threads; t++) {
+      threads[t]->join();
+      total.merge(stages[t]->counts);
+      delete threads[t];
+      delete stages[t];
+    }
+    model->thaw();
+
+    fprintf(stderr, "iteration %d: log likelihood %.6f over %d sequences", it, total.log_likelihood, total.used);
+    if (total.failed) fprintf(stderr, " (%d the model cannot produce, skipped)", total.failed);
+    fprintf(stderr, "\n");
+
+    maximize(mf, *model, total, prior);
+    model = mf.make(err);
+    if (model == NULL) {
+      std::cerr << err << std::endl;
+      exit(1);
+    }
+  }
+
+  if (!mf.write(output)) {
+    std::cerr << "could not write " << output << std::endl;
+    exit(1);
+  }
+}